@@ -26,10 +26,13 @@
 
 //Antioch
 #include "antioch/sigma_bin_converter.h"
+#include "antioch/metaprogramming_decl.h"
 
 //Planet
 
 //C++
+#include <vector>
+#include <utility>
 
 namespace Planet
 {
@@ -47,9 +50,19 @@ namespace Planet
 
         CrossSection();
         CrossSection(const CrossSection<VectorCoeffType> &rhs);
+        //! steals the vectors of rhs
+        CrossSection(CrossSection<VectorCoeffType> &&rhs) noexcept;
         CrossSection(const VectorCoeffType &x, const VectorCoeffType &y);
+        //! steals x and y
+        CrossSection(VectorCoeffType &&x, VectorCoeffType &&y);
+        //! copies rhs in the precision of VectorCoeffType
+        template<typename OtherVectorCoeffType>
+        explicit CrossSection(const CrossSection<OtherVectorCoeffType> &rhs);
         ~CrossSection();
 
+        CrossSection<VectorCoeffType> &operator=(const CrossSection<VectorCoeffType> &rhs);
+        CrossSection<VectorCoeffType> &operator=(CrossSection<VectorCoeffType> &&rhs) noexcept;
+
         //!sets the abscissa
         template<typename VectorStateType>
         void set_abscissa(const VectorStateType &x);
@@ -61,16 +74,30 @@ namespace Planet
         template<typename VectorStateType>
         void update_cross_section(const VectorStateType &custom_x);
 
+        /*! merges the bins of the custom grid \p custom_x the cross-section is on,
+         *  coarse node k being node bin_starts[k], the last one the last node.
+         *  The coarse values are the bin averages \f$\sum_l \sigma_l \Delta\lambda_l / \Delta\lambda_k\f$
+         */
+        template<typename VectorStateType>
+        void coarsen_cross_section(const std::vector<unsigned int> &bin_starts, const VectorStateType &custom_x);
+
         //!\return the abscissa
-        const VectorCoeffType abscissa()      const;
+        const VectorCoeffType &abscissa()      const;
 
         //!\return the cross-section
-        const VectorCoeffType cross_section() const;
+        const VectorCoeffType &cross_section() const;
 
         //!\return the cross-section on custom grid
         const VectorCoeffType &cross_section_on_custom_grid() const;
   };
 
+  template<typename VectorCoeffType>
+  inline
+  CrossSection<VectorCoeffType>::CrossSection()
+  {
+    return;
+  }
+
   template<typename VectorCoeffType>
   inline
   CrossSection<VectorCoeffType>::CrossSection(const VectorCoeffType &x, const VectorCoeffType &y):
@@ -80,6 +107,38 @@ namespace Planet
     return;
   }
 
+  template<typename VectorCoeffType>
+  inline
+  CrossSection<VectorCoeffType>::CrossSection(VectorCoeffType &&x, VectorCoeffType &&y):
+  _abscissa(std::move(x)),
+  _cross_section(std::move(y))
+  {
+    return;
+  }
+
+  template<typename VectorCoeffType>
+  template<typename OtherVectorCoeffType>
+  inline
+  CrossSection<VectorCoeffType>::CrossSection(const CrossSection<OtherVectorCoeffType> &rhs):
+  _abscissa(rhs.abscissa().size()),
+  _cross_section(rhs.cross_section().size()),
+  _cross_section_on_custom_grid(rhs.cross_section_on_custom_grid().size())
+  {
+    typedef typename Antioch::value_type<VectorCoeffType>::type Scalar;
+
+    for(unsigned int i = 0; i < _abscissa.size(); i++)
+    {
+       _abscissa[i]      = Scalar(rhs.abscissa()[i]);
+       _cross_section[i] = Scalar(rhs.cross_section()[i]);
+    }
+    for(unsigned int i = 0; i < _cross_section_on_custom_grid.size(); i++)
+    {
+       _cross_section_on_custom_grid[i] = Scalar(rhs.cross_section_on_custom_grid()[i]);
+    }
+
+    return;
+  }
+
   template<typename VectorCoeffType>
   inline
   CrossSection<VectorCoeffType>::~CrossSection()
@@ -90,12 +149,47 @@ namespace Planet
   template<typename VectorCoeffType>
   inline
   CrossSection<VectorCoeffType>::CrossSection(const CrossSection<VectorCoeffType> &rhs):
-  _abscissa(rhs.abscissa()),
-  _cross_section(rhs.cross_section())
+  _abscissa(rhs._abscissa),
+  _cross_section(rhs._cross_section),
+  _cross_section_on_custom_grid(rhs._cross_section_on_custom_grid)
   {
     return;
   }
 
+  template<typename VectorCoeffType>
+  inline
+  CrossSection<VectorCoeffType>::CrossSection(CrossSection<VectorCoeffType> &&rhs) noexcept:
+  _abscissa(std::move(rhs._abscissa)),
+  _cross_section(std::move(rhs._cross_section)),
+  _cross_section_on_custom_grid(std::move(rhs._cross_section_on_custom_grid))
+  {
+    return;
+  }
+
+  template<typename VectorCoeffType>
+  inline
+  CrossSection<VectorCoeffType> &CrossSection<VectorCoeffType>::operator=(const CrossSection<VectorCoeffType> &rhs)
+  {
+    if(this == &rhs)return *this;
+
+    _abscissa                     = rhs._abscissa;
+    _cross_section                = rhs._cross_section;
+    _cross_section_on_custom_grid = rhs._cross_section_on_custom_grid;
+
+    return *this;
+  }
+
+  template<typename VectorCoeffType>
+  inline
+  CrossSection<VectorCoeffType> &CrossSection<VectorCoeffType>::operator=(CrossSection<VectorCoeffType> &&rhs) noexcept
+  {
+    _abscissa                     = std::move(rhs._abscissa);
+    _cross_section                = std::move(rhs._cross_section);
+    _cross_section_on_custom_grid = std::move(rhs._cross_section_on_custom_grid);
+
+    return *this;
+  }
+
   template<typename VectorCoeffType>
   template<typename VectorStateType>
   inline
@@ -130,16 +224,43 @@ namespace Planet
      return;
   }
 
+  template<typename VectorCoeffType>
+  template<typename VectorStateType>
+  inline
+  void CrossSection<VectorCoeffType>::coarsen_cross_section(const std::vector<unsigned int> &bin_starts, const VectorStateType &custom_x)
+  {
+    antioch_assert_equal_to(custom_x.size(),_cross_section_on_custom_grid.size());
+    antioch_assert_greater(bin_starts.size(),1);
+    antioch_assert_equal_to(bin_starts.back(),custom_x.size() - 1);
+
+    typedef typename Antioch::value_type<VectorCoeffType>::type Scalar;
+
+    // in place, coarse node k is before fine node bin_starts[k]
+    for(unsigned int k = 0; k + 1 < bin_starts.size(); k++)
+    {
+       Scalar integral(0.L);
+       for(unsigned int l = bin_starts[k]; l < bin_starts[k + 1]; l++)
+       {
+          integral += _cross_section_on_custom_grid[l] * Scalar(custom_x[l + 1] - custom_x[l]);
+       }
+       _cross_section_on_custom_grid[k] = integral / Scalar(custom_x[bin_starts[k + 1]] - custom_x[bin_starts[k]]);
+    }
+    _cross_section_on_custom_grid[bin_starts.size() - 1] = _cross_section_on_custom_grid[bin_starts.back()];
+    _cross_section_on_custom_grid.resize(bin_starts.size());
+
+    return;
+  }
+
   template<typename VectorCoeffType>
   inline
-  const VectorCoeffType CrossSection<VectorCoeffType>::abscissa() const
+  const VectorCoeffType &CrossSection<VectorCoeffType>::abscissa() const
   {
      return _abscissa;
   }
 
   template<typename VectorCoeffType>
   inline
-  const VectorCoeffType CrossSection<VectorCoeffType>::cross_section() const
+  const VectorCoeffType &CrossSection<VectorCoeffType>::cross_section() const
   {
      return _cross_section;
   }
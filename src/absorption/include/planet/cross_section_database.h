@@ -0,0 +1,456 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// Planet - An atmospheric code for planetary bodies, adapted to Titan
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+
+#ifndef PLANET_CROSS_SECTION_DATABASE_H
+#define PLANET_CROSS_SECTION_DATABASE_H
+
+//Antioch
+#include "antioch/antioch_asserts.h"
+
+//POSIX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+//C++
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cstring>
+#include <stdint.h>
+
+namespace Planet
+{
+  /*!
+   * Binary store of the tabulated inputs (cross-sections, solar flux,
+   * photolysis branching), read-only memory mapped: loading is a mapping
+   * instead of a text parsing. The columns are copied by the readers in
+   * their own vectors (to be rebinned on the photon grid), each process
+   * keeps its copy of the tables, only the file itself is shared.
+   *
+   * The text files are converted once by convert(), each file becomes a
+   * table named after its path, keeping the header line and the columns.
+   * The paths are normalised (repeated '/' and "./" dropped), the tables
+   * are found whatever the spelling of the path.
+   * The layout is, all fields 8 bytes aligned:
+   *   - file header: magic, version, number of tables, checksum (FNV-1a 64
+   *     of everything after the file header)
+   *   - per table: name length, header length, number of columns, number of rows,
+   *     name and header line, then the columns as doubles, column after column.
+   */
+  class CrossSectionDatabase
+  {
+     private:
+        //! not copyable, owns the mapping
+        CrossSectionDatabase(const CrossSectionDatabase &);
+        CrossSectionDatabase &operator=(const CrossSectionDatabase &);
+
+        struct Table
+        {
+           std::string   header;
+           unsigned int  n_columns;
+           unsigned int  n_rows;
+           const double *data;
+        };
+
+        void         *_map;
+        std::size_t   _map_size;
+        std::vector<std::string>     _names;
+        std::map<std::string,Table>  _tables;
+
+        //! 8 bytes alignment
+        static std::size_t padded(std::size_t size);
+
+        //! FNV-1a 64
+        static uint64_t checksum(const char *data, std::size_t size);
+
+        //! error if \p size bytes from \p offset overflow the mapped file
+        void check_size(std::size_t offset, std::size_t size, const std::string &binary_file);
+
+        const Table &table(const std::string &name) const;
+
+     public:
+        CrossSectionDatabase();
+        ~CrossSectionDatabase();
+
+        //! "PLNTXSDB"
+        static const char *magic();
+
+        //! format version
+        static uint32_t version();
+
+        //!\return \p path without repeated '/' and "./", the name of its table
+        static std::string normalised_path(const std::string &path);
+
+        /*! parses the whitespace separated text files, first line being the header,
+         *  and writes them in \p binary_file. The number of columns is the number of
+         *  fields of the first data line, the parsing stops at the first incomplete line.
+         */
+        static void convert(const std::vector<std::string> &text_files, const std::string &binary_file);
+
+        //! maps \p binary_file read-only and checks it
+        void load(const std::string &binary_file);
+
+        //! unmaps the file
+        void clear();
+
+        //!\return true if a file is mapped
+        bool loaded() const;
+
+        //!\return true if the file \p name has been converted in the database
+        bool has_table(const std::string &name) const;
+
+        //!\return table names, in file order
+        const std::vector<std::string> &table_names() const;
+
+        //!\return header line of table \p name
+        const std::string &header(const std::string &name) const;
+
+        //!\return number of columns of table \p name
+        unsigned int n_columns(const std::string &name) const;
+
+        //!\return number of rows of table \p name
+        unsigned int n_rows(const std::string &name) const;
+
+        //!\return column \p c of table \p name, in the mapped file
+        const double *column(const std::string &name, unsigned int c) const;
+
+        //! copies column \p c of table \p name in \p values
+        template<typename VectorStateType>
+        void column(const std::string &name, unsigned int c, VectorStateType &values) const;
+  };
+
+  inline
+  CrossSectionDatabase::CrossSectionDatabase():
+     _map(NULL),
+     _map_size(0)
+  {
+     return;
+  }
+
+  inline
+  CrossSectionDatabase::~CrossSectionDatabase()
+  {
+     this->clear();
+     return;
+  }
+
+  inline
+  const char *CrossSectionDatabase::magic()
+  {
+     return "PLNTXSDB";
+  }
+
+  inline
+  uint32_t CrossSectionDatabase::version()
+  {
+     return 1;
+  }
+
+  inline
+  std::size_t CrossSectionDatabase::padded(std::size_t size)
+  {
+     return ((size + 7) / 8) * 8;
+  }
+
+  inline
+  uint64_t CrossSectionDatabase::checksum(const char *data, std::size_t size)
+  {
+     uint64_t hash(14695981039346656037ULL);
+     for(std::size_t i = 0; i < size; i++)
+     {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+     }
+
+     return hash;
+  }
+
+  inline
+  std::string CrossSectionDatabase::normalised_path(const std::string &path)
+  {
+     // ".." is kept, resolving it would need the file system
+     std::string normalised;
+     std::size_t start(0);
+     while(start <= path.size())
+     {
+        std::size_t end = path.find('/',start);
+        if(end == std::string::npos)end = path.size();
+        const std::string part = path.substr(start,end - start);
+        if(part.empty() || part == ".")
+        {
+           if(start == 0 && part.empty())normalised = "/"; // absolute path
+        }else
+        {
+           if(!normalised.empty() && normalised[normalised.size() - 1] != '/')normalised += '/';
+           normalised += part;
+        }
+        start = end + 1;
+     }
+     if(normalised.empty() && !path.empty())normalised = ".";
+
+     return normalised;
+  }
+
+  inline
+  void CrossSectionDatabase::check_size(std::size_t offset, std::size_t size, const std::string &binary_file)
+  {
+     if(offset > _map_size || size > _map_size - offset)
+     {
+        this->clear();
+        std::cerr << "Error: " << binary_file << " is truncated or corrupted" << std::endl;
+        antioch_error();
+     }
+
+     return;
+  }
+
+  inline
+  void CrossSectionDatabase::convert(const std::vector<std::string> &text_files, const std::string &binary_file)
+  {
+     // tables after the file header
+     std::string body;
+     for(unsigned int f = 0; f < text_files.size(); f++)
+     {
+        std::ifstream text(text_files[f].c_str());
+        if(!text)
+        {
+           std::cerr << "Could not open file " << text_files[f] << std::endl;
+           antioch_error();
+        }
+        std::string header;
+        getline(text,header);
+
+        std::vector<std::vector<double> > columns;
+        std::string line;
+        while(getline(text,line))
+        {
+           std::istringstream fields(line);
+           std::vector<double> row;
+           double value;
+           while(fields >> value)row.push_back(value);
+           if(columns.empty())
+           {
+              if(row.empty())continue;
+              columns.resize(row.size());
+           }
+           if(row.size() < columns.size())break;
+           for(unsigned int c = 0; c < columns.size(); c++)columns[c].push_back(row[c]);
+        }
+        text.close();
+
+        const std::string name = normalised_path(text_files[f]);
+        uint32_t sizes[4] = {static_cast<uint32_t>(name.size()), static_cast<uint32_t>(header.size()),
+                             static_cast<uint32_t>(columns.size()), static_cast<uint32_t>(columns.empty()?0:columns[0].size())};
+        body.append(reinterpret_cast<const char*>(sizes),sizeof(sizes));
+        std::string strings = name + header;
+        strings.resize(padded(strings.size()),'\0');
+        body.append(strings);
+        for(unsigned int c = 0; c < columns.size(); c++)
+        {
+           body.append(reinterpret_cast<const char*>(&columns[c][0]),columns[c].size() * sizeof(double));
+        }
+     }
+
+     std::ofstream binary(binary_file.c_str(),std::ios::binary);
+     if(!binary)
+     {
+        std::cerr << "Could not open file " << binary_file << std::endl;
+        antioch_error();
+     }
+     const uint32_t version_and_size[2] = {version(), static_cast<uint32_t>(text_files.size())};
+     const uint64_t sum = checksum(body.data(),body.size());
+     binary.write(magic(),8);
+     binary.write(reinterpret_cast<const char*>(version_and_size),sizeof(version_and_size));
+     binary.write(reinterpret_cast<const char*>(&sum),sizeof(sum));
+     binary.write(body.data(),body.size());
+     binary.close();
+
+     return;
+  }
+
+  inline
+  void CrossSectionDatabase::load(const std::string &binary_file)
+  {
+     this->clear();
+
+     const int fd = open(binary_file.c_str(),O_RDONLY);
+     if(fd < 0)
+     {
+        std::cerr << "Could not open file " << binary_file << std::endl;
+        antioch_error();
+     }
+     struct stat status;
+     if(fstat(fd,&status) != 0 || status.st_size < 24)
+     {
+        close(fd);
+        std::cerr << "Error: " << binary_file << " is not a cross-section database" << std::endl;
+        antioch_error();
+     }
+     _map_size = status.st_size;
+     _map = mmap(NULL,_map_size,PROT_READ,MAP_SHARED,fd,0);
+     close(fd);
+     if(_map == MAP_FAILED)
+     {
+        _map = NULL;
+        std::cerr << "Could not map file " << binary_file << std::endl;
+        antioch_error();
+     }
+
+     const char *bytes = static_cast<const char*>(_map);
+     uint32_t version_and_size[2];
+     uint64_t sum;
+     std::memcpy(version_and_size,bytes + 8,sizeof(version_and_size));
+     std::memcpy(&sum,bytes + 16,sizeof(sum));
+     if(std::memcmp(bytes,magic(),8) != 0 || version_and_size[0] != version())
+     {
+        this->clear();
+        std::cerr << "Error: " << binary_file << " is not a cross-section database of version " << version() << std::endl;
+        antioch_error();
+     }
+     if(checksum(bytes + 24,_map_size - 24) != sum)
+     {
+        this->clear();
+        std::cerr << "Error: checksum of " << binary_file << " does not match, file corrupted" << std::endl;
+        antioch_error();
+     }
+
+     std::size_t offset(24);
+     for(uint32_t t = 0; t < version_and_size[1]; t++)
+     {
+        uint32_t sizes[4];
+        this->check_size(offset,sizeof(sizes),binary_file);
+        std::memcpy(sizes,bytes + offset,sizeof(sizes));
+        offset += sizeof(sizes);
+
+        this->check_size(offset,padded(std::size_t(sizes[0]) + sizes[1]),binary_file);
+        // databases of older conversions may hold paths as given
+        const std::string name = normalised_path(std::string(bytes + offset,sizes[0]));
+        Table table;
+        table.header.assign(bytes + offset + sizes[0],sizes[1]);
+        table.n_columns = sizes[2];
+        table.n_rows    = sizes[3];
+        offset += padded(std::size_t(sizes[0]) + sizes[1]);
+        table.data = reinterpret_cast<const double*>(bytes + offset);
+        this->check_size(offset,std::size_t(table.n_columns) * table.n_rows * sizeof(double),binary_file);
+        offset += std::size_t(table.n_columns) * table.n_rows * sizeof(double);
+
+        _names.push_back(name);
+        _tables[name] = table;
+     }
+
+     return;
+  }
+
+  inline
+  void CrossSectionDatabase::clear()
+  {
+     if(_map)munmap(_map,_map_size);
+     _map      = NULL;
+     _map_size = 0;
+     _names.clear();
+     _tables.clear();
+
+     return;
+  }
+
+  inline
+  bool CrossSectionDatabase::loaded() const
+  {
+     return _map;
+  }
+
+  inline
+  bool CrossSectionDatabase::has_table(const std::string &name) const
+  {
+     return _tables.count(normalised_path(name));
+  }
+
+  inline
+  const CrossSectionDatabase::Table &CrossSectionDatabase::table(const std::string &name) const
+  {
+     std::map<std::string,Table>::const_iterator it = _tables.find(normalised_path(name));
+     if(it == _tables.end())
+     {
+        std::cerr << "Error: no table " << name << " in the cross-section database" << std::endl;
+        antioch_error();
+     }
+
+     return it->second;
+  }
+
+  inline
+  const std::vector<std::string> &CrossSectionDatabase::table_names() const
+  {
+     return _names;
+  }
+
+  inline
+  const std::string &CrossSectionDatabase::header(const std::string &name) const
+  {
+     return this->table(name).header;
+  }
+
+  inline
+  unsigned int CrossSectionDatabase::n_columns(const std::string &name) const
+  {
+     return this->table(name).n_columns;
+  }
+
+  inline
+  unsigned int CrossSectionDatabase::n_rows(const std::string &name) const
+  {
+     return this->table(name).n_rows;
+  }
+
+  inline
+  const double *CrossSectionDatabase::column(const std::string &name, unsigned int c) const
+  {
+     const Table &tab = this->table(name);
+     antioch_assert_less(c,tab.n_columns);
+
+     return tab.data + std::size_t(c) * tab.n_rows;
+  }
+
+  template<typename VectorStateType>
+  inline
+  void CrossSectionDatabase::column(const std::string &name, unsigned int c, VectorStateType &values) const
+  {
+     const double *col = this->column(name,c);
+     const unsigned int n = this->n_rows(name);
+     values.resize(n);
+     for(unsigned int i = 0; i < n; i++)
+     {
+        values[i] = col[i];
+     }
+
+     return;
+  }
+
+}
+
+#endif
@@ -30,10 +30,15 @@
 
 //Planet
 #include "planet/molecular_diffusion_evaluator.h"
+#include "planet/multicomponent_diffusion_evaluator.h"
 #include "planet/eddy_diffusion_evaluator.h"
+#include "planet/diffusion_workspace.h"
+#include "planet/planet_constants.h"
+#include "planet/altitude_store.h"
 
 //C++
 #include <string>
+#include <map>
 
 namespace Planet{
 
@@ -53,6 +58,34 @@ namespace Planet{
        const AtmosphericMixture<CoeffType,VectorCoeffType,MatrixCoeffType>          & _mixture;
        const AtmosphericTemperature<CoeffType,VectorCoeffType>                      & _temperature;
 
+//Stefan-Maxwell, optional
+       const MulticomponentDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType> * _multicomponent_diffusion;
+
+       //! filled in place at each evaluation, an evaluator is not to be shared between threads
+       mutable DiffusionWorkspace<CoeffType> _workspace;
+
+       //! what depends only on the altitude
+       struct AltitudeTerms
+       {
+          //! temperature (K)
+          CoeffType T;
+          //! \f$\frac{1}{T}\frac{\partial T}{\partial z}\f$ (km-1)
+          CoeffType dT_dz_T;
+          //! \f$\frac{RT}{g}\f$, scale height times molar mass (km.kg.mol-1)
+          CoeffType H_M;
+          //! species scale heights (km)
+          VectorCoeffType Hs;
+       };
+
+       //! altitude terms, by altitude, a mesh is visited at each Newton iteration
+       mutable AltitudeStore<CoeffType,AltitudeTerms> _altitude_terms;
+       //! revision of the temperature profile the table was built on
+       mutable unsigned int _temperature_revision;
+
+       //! tabulates the altitude terms at \p z if needed
+       template<typename StateType>
+       const AltitudeTerms & altitude_terms(const StateType &z) const;
+
       public:
        //!
        DiffusionEvaluator(const MolecularDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType> &mol_diff,
@@ -63,6 +96,12 @@ namespace Planet{
         //!
        ~DiffusionEvaluator();
 
+       //! molecular diffusion by the Stefan-Maxwell coefficients instead of \f$\tilde{D}\f$
+       void set_multicomponent_diffusion(const MulticomponentDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType> &multi_diff);
+
+       //!\return true if the Stefan-Maxwell coefficients are used
+       bool multicomponent() const;
+
        //!
        template<typename StateType, typename VectorStateType>
        void diffusion(const VectorStateType &molar_concentrations,
@@ -78,6 +117,18 @@ namespace Planet{
                                  MatrixStateType &domegas_dn_i_A_TERM,
                                  MatrixStateType &domegas_dn_i_B_TERM) const;
 
+       //!\return the workspace, to monitor its allocations
+       const DiffusionWorkspace<CoeffType> & workspace() const;
+
+       //! empties the altitude table, to be called when the mesh changes
+       void clear_altitude_terms();
+
+       //!\return number of tabulated altitudes
+       unsigned int n_tabulated_altitudes() const;
+
+       //! at most \p n tabulated altitudes, the least recently used are dropped
+       void set_altitude_store_size(unsigned int n);
+
   };
 
   template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
@@ -90,7 +141,10 @@ namespace Planet{
     _molecular_diffusion(mol_diff),
     _eddy_diffusion(eddy_diff),
     _mixture(mix),
-    _temperature(temp)
+    _temperature(temp),
+    _multicomponent_diffusion(NULL),
+    _workspace(mix.neutral_composition().n_species(),mol_diff.n_medium()),
+    _temperature_revision(temp.revision())
   {
      return;
   }
@@ -102,6 +156,80 @@ namespace Planet{
      return;
   }
 
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  void DiffusionEvaluator<CoeffType, VectorCoeffType,MatrixCoeffType>::set_multicomponent_diffusion(
+                          const MulticomponentDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType> &multi_diff)
+  {
+     antioch_assert_equal_to(multi_diff.n_species(),_mixture.neutral_composition().n_species());
+     _multicomponent_diffusion = &multi_diff;
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  bool DiffusionEvaluator<CoeffType, VectorCoeffType,MatrixCoeffType>::multicomponent() const
+  {
+     return (_multicomponent_diffusion != NULL);
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  const DiffusionWorkspace<CoeffType> & DiffusionEvaluator<CoeffType, VectorCoeffType,MatrixCoeffType>::workspace() const
+  {
+     return _workspace;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  void DiffusionEvaluator<CoeffType, VectorCoeffType,MatrixCoeffType>::clear_altitude_terms()
+  {
+     _altitude_terms.clear();
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  unsigned int DiffusionEvaluator<CoeffType, VectorCoeffType,MatrixCoeffType>::n_tabulated_altitudes() const
+  {
+     return _altitude_terms.size();
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  void DiffusionEvaluator<CoeffType, VectorCoeffType,MatrixCoeffType>::set_altitude_store_size(unsigned int n)
+  {
+     _altitude_terms.set_capacity(n);
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType>
+  inline
+  const typename DiffusionEvaluator<CoeffType, VectorCoeffType,MatrixCoeffType>::AltitudeTerms &
+        DiffusionEvaluator<CoeffType, VectorCoeffType,MatrixCoeffType>::altitude_terms(const StateType &z) const
+  {
+// new temperature profile, everything is stale
+     if(_temperature.revision() != _temperature_revision)
+     {
+        _altitude_terms.clear();
+        _temperature_revision = _temperature.revision();
+     }
+
+     const AltitudeTerms * stored = _altitude_terms.find(z);
+     if(stored)return *stored;
+
+     AltitudeTerms & terms = _altitude_terms.insert(z);
+     terms.T       = _temperature.neutral_temperature(z);
+     terms.dT_dz_T = _temperature.dneutral_temperature_dz(z) / terms.T;
+     terms.H_M     = Antioch::constant_clone(terms.T,1e-3) * // m -> km
+                     Antioch::Constants::R_universal<CoeffType>() * terms.T /
+                     Constants::g(Constants::Titan::radius<CoeffType>(), CoeffType(z), Constants::Titan::mass<CoeffType>());
+     _mixture.scale_heights(z,terms.Hs);
+
+     return terms;
+  }
+
   template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
   template<typename StateType, typename VectorStateType>
   inline
@@ -113,29 +241,35 @@ namespace Planet{
      antioch_assert_equal_to(omega_a.size(),_mixture.neutral_composition().n_species());
      antioch_assert_equal_to(omega_b.size(),_mixture.neutral_composition().n_species());
 
-// temperature
-     StateType T = _temperature.neutral_temperature(z);
-     StateType dT_dz_T = _temperature.dneutral_temperature_dz(z) / T;
+// temperature and scale heights
+     const AltitudeTerms & terms = this->altitude_terms(z);
+     const StateType T = terms.T;
+     const StateType dT_dz_T = terms.dT_dz_T;
+     const VectorCoeffType & Hs = terms.Hs;
 
 // Dtilde
-     VectorStateType molecular(molar_concentrations.size());
-     _molecular_diffusion.Dtilde(molar_concentrations,T,molecular);// Dtilde
+     if(_multicomponent_diffusion)
+     {
+        _multicomponent_diffusion->Dtilde(molar_concentrations,T,_workspace);
+     }else
+     {
+        _molecular_diffusion.Dtilde(molar_concentrations,T,_workspace);
+     }
+     const CoeffType * molecular = _workspace.Dtilde();
 
-// nTot
+// nTot and mean molar mass
      StateType nTot(0);
+     StateType Mm(0);
      for(unsigned int s = 0; s < molar_concentrations.size(); s++)
      {
         nTot += molar_concentrations[s];
+        Mm   += molar_concentrations[s] * _mixture.neutral_composition().M(s);
      }
      StateType one_over_nTot = Antioch::constant_clone(T,1) / nTot;
 
-// scale heights
-     VectorStateType Hs(molar_concentrations.size());
-     _mixture.scale_heights(z,Hs);
-
-// eddy diff (K / Ha)
+// eddy diff (K / Ha), Ha = RT / (g Mm / nTot)
      StateType eddy_K = _eddy_diffusion.K(nTot);
-     StateType eddy_K_Ha = eddy_K / _mixture.atmospheric_scale_height(molar_concentrations,z);
+     StateType eddy_K_Ha = eddy_K / (terms.H_M / (Mm * one_over_nTot));
      
      StateType eddy_K_times_dT_dz_T = eddy_K * dT_dz_T;
 
@@ -175,40 +309,41 @@ namespace Planet{
 //params
      StateType nTot;
      Antioch::set_zero(nTot);
+     StateType Mm;
+     Antioch::set_zero(Mm);
      for(unsigned int s = 0; s < molar_concentrations.size();s++)
      {
         nTot += molar_concentrations[s];
+        Mm   += molar_concentrations[s] * _mixture.neutral_composition().M(s);
         antioch_assert_equal_to(_mixture.neutral_composition().n_species(),domegas_dn_i_A_TERM[s].size());
         antioch_assert_equal_to(_mixture.neutral_composition().n_species(),domegas_dn_i_B_TERM[s].size());
      }
-     StateType T       = _temperature.neutral_temperature(z);
-     StateType dT_dz_T = _temperature.dneutral_temperature_dz(z) / T;
+     const AltitudeTerms & terms = this->altitude_terms(z);
+     const StateType T       = terms.T;
+     const StateType dT_dz_T = terms.dT_dz_T;
 
 //eddy
      StateType dK_dn = _eddy_diffusion.K_deriv_ns(nTot);
      StateType K     = _eddy_diffusion.K(nTot);
 
-//molecular
-     VectorStateType Dtilde;
-     Dtilde.resize(_mixture.neutral_composition().n_species(),0.);
-     MatrixCoeffType dDtilde_dn;
-     dDtilde_dn.resize(_mixture.neutral_composition().n_species());
-     for(unsigned int s = 0; s < _mixture.neutral_composition().n_species(); s++)
+//molecular, in the workspace
+     if(_multicomponent_diffusion)
      {
-        dDtilde_dn[s].resize(_mixture.neutral_composition().n_species());
+        _multicomponent_diffusion->Dtilde_and_derivs_dn(molar_concentrations,T,nTot,_workspace);
+     }else
+     {
+        _molecular_diffusion.Dtilde_and_derivs_dn(molar_concentrations,T,nTot,_workspace);
      }
+     const CoeffType * Dtilde = _workspace.Dtilde();
 
-     _molecular_diffusion.Dtilde_and_derivs_dn(molar_concentrations,T,nTot,Dtilde,dDtilde_dn);
-
-//scale heights
-     CoeffType Ha;
-     VectorStateType dHa_dn_i;
-     VectorStateType Hs;
-     Hs.resize(_mixture.neutral_composition().n_species(),0);
-     dHa_dn_i.resize(_mixture.neutral_composition().n_species(),0);
-
-     _mixture.datmospheric_scale_height_dn_i(molar_concentrations,z,Ha,dHa_dn_i);
-     _mixture.scale_heights(z,Hs);
+//scale heights, Ha = RT / (g Mm / nTot), dHa_dn_i = Ha / Mm * (Mm / nTot - M_i)
+     const VectorCoeffType & Hs = terms.Hs;
+     const StateType Ha = terms.H_M / (Mm / nTot);
+     CoeffType * dHa_dn_i = _workspace.dHa_dn();
+     for(unsigned int i = 0; i < _mixture.neutral_composition().n_species(); i++)
+     {
+        dHa_dn_i[i] = Ha / Mm * (Mm / nTot - _mixture.neutral_composition().M(i));
+     }
 
 
 // temporaries to limit computations
@@ -223,6 +358,7 @@ namespace Planet{
 
      for(unsigned int s = 0; s < _mixture.neutral_composition().n_species(); s++)
      {
+        const CoeffType * dDtilde_dn = _workspace.dDtilde_dn(s);
 
 // temporaries to limit computations
           // 1/T * dT_dz * (1 + (1 -xs) * alphas)
@@ -251,8 +387,8 @@ namespace Planet{
 
        for(unsigned int i = 0; i < _mixture.neutral_composition().n_species(); i++)
        {
-          domegas_dn_i_A_TERM[s][i] = - (dDtilde_dn[s][i] + dK_dn) * Antioch::constant_clone(T,1e-10); //cm2.s-1.cm3 to km2.s-1.cm3
-          domegas_dn_i_B_TERM[s][i] = -  dDtilde_dn[s][i] * ( one_Hs + dT_dz_T_times_stuff )
+          domegas_dn_i_A_TERM[s][i] = - (dDtilde_dn[i] + dK_dn) * Antioch::constant_clone(T,1e-10); //cm2.s-1.cm3 to km2.s-1.cm3
+          domegas_dn_i_B_TERM[s][i] = -  dDtilde_dn[i] * ( one_Hs + dT_dz_T_times_stuff )
                                       + Dtilde_times_more_stuff // - Dtilde * 1/T * dT_dz * alphas * (- xs / nTot )
                                       - dK_dn_times_stuff
                                       + K_Ha_2 * dHa_dn_i[i];
@@ -0,0 +1,257 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// Planet - An atmospheric code for planetary bodies, adapted to Titan
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+
+#ifndef PLANET_DIFFUSION_WORKSPACE_H
+#define PLANET_DIFFUSION_WORKSPACE_H
+
+//Antioch
+#include "antioch/antioch_asserts.h"
+
+//C++
+#include <vector>
+#include <cstddef>
+
+namespace Planet
+{
+  /*! Scratch of the diffusion evaluations at a point: \f$\tilde{D}\f$, its
+   *  derivatives with respect to the concentrations, the derivatives of the
+   *  atmospheric scale height and the binary coefficients table, in one
+   *  contiguous block whose rows start on a cache line. It is sized once
+   *  for a mechanism, the evaluations then fill it in place without
+   *  allocating.
+   */
+  template <typename CoeffType>
+  class DiffusionWorkspace
+  {
+      public:
+
+        DiffusionWorkspace(unsigned int n_species, unsigned int n_medium);
+        //! copies the sizes, not the content
+        DiffusionWorkspace(const DiffusionWorkspace<CoeffType> &rhs);
+        ~DiffusionWorkspace();
+
+        //! sizes the block, allocates only if the sizes change
+        void resize(unsigned int n_species, unsigned int n_medium);
+
+        //!\return number of species
+        unsigned int n_species() const;
+
+        //!\return number of medium species
+        unsigned int n_medium() const;
+
+        //!\return distance between two rows of the matrices, padded to a cache line
+        unsigned int stride() const;
+
+        //!\return \f$\tilde{D}_s\f$
+        CoeffType * Dtilde();
+        const CoeffType * Dtilde() const;
+
+        //!\return \f$\frac{\partial \tilde{D}_s}{\partial n_i}\f$, row \p s
+        CoeffType * dDtilde_dn(unsigned int s);
+        const CoeffType * dDtilde_dn(unsigned int s) const;
+
+        //!\return binary coefficients \f$D_{m,s}\f$ at m * n_species + s
+        CoeffType * binary();
+
+        //!\return \f$\frac{\partial H_a}{\partial n_i}\f$
+        CoeffType * dHa_dn();
+
+        //!\return number of times the block was allocated
+        unsigned int n_allocations() const;
+
+      private:
+        //don't use it
+        DiffusionWorkspace();
+
+        //! elements of a cache line
+        static unsigned int line();
+
+        //! pads \p n to a whole number of cache lines
+        static unsigned int pad(unsigned int n);
+
+        unsigned int _n_species;
+        unsigned int _n_medium;
+        unsigned int _stride;
+
+        std::vector<CoeffType> _storage;
+        //! first aligned element of the storage
+        std::size_t _start;
+        std::size_t _dHa_dn;
+        std::size_t _dDtilde_dn;
+        std::size_t _binary;
+
+        unsigned int _n_allocations;
+  };
+
+  template <typename CoeffType>
+  inline
+  DiffusionWorkspace<CoeffType>::DiffusionWorkspace(unsigned int n_species, unsigned int n_medium):
+      _n_species(0),
+      _n_medium(0),
+      _stride(0),
+      _start(0),
+      _dHa_dn(0),
+      _dDtilde_dn(0),
+      _binary(0),
+      _n_allocations(0)
+  {
+     this->resize(n_species,n_medium);
+     return;
+  }
+
+  template <typename CoeffType>
+  inline
+  DiffusionWorkspace<CoeffType>::DiffusionWorkspace(const DiffusionWorkspace<CoeffType> &rhs):
+      _n_species(0),
+      _n_medium(0),
+      _stride(0),
+      _start(0),
+      _dHa_dn(0),
+      _dDtilde_dn(0),
+      _binary(0),
+      _n_allocations(0)
+  {
+     this->resize(rhs.n_species(),rhs.n_medium());
+     return;
+  }
+
+  template <typename CoeffType>
+  inline
+  DiffusionWorkspace<CoeffType>::~DiffusionWorkspace()
+  {
+     return;
+  }
+
+  template <typename CoeffType>
+  inline
+  unsigned int DiffusionWorkspace<CoeffType>::line()
+  {
+     return (sizeof(CoeffType) < 64)?64 / sizeof(CoeffType):1;
+  }
+
+  template <typename CoeffType>
+  inline
+  unsigned int DiffusionWorkspace<CoeffType>::pad(unsigned int n)
+  {
+     return ((n + line() - 1) / line()) * line();
+  }
+
+  template <typename CoeffType>
+  inline
+  void DiffusionWorkspace<CoeffType>::resize(unsigned int n_species, unsigned int n_medium)
+  {
+     if(n_species == _n_species && n_medium == _n_medium && !_storage.empty())return;
+
+     _n_species = n_species;
+     _n_medium  = n_medium;
+     _stride    = pad(_n_species);
+
+// Dtilde | dHa_dn | dDtilde_dn, n_species rows | binary, n_medium rows
+     _dHa_dn     = _stride;
+     _dDtilde_dn = _dHa_dn + _stride;
+     _binary     = _dDtilde_dn + std::size_t(_n_species) * _stride;
+     const std::size_t size = _binary + std::size_t(_n_medium) * _stride;
+
+// one more line to align the start
+     _storage.assign(size + line(),CoeffType(0));
+     _n_allocations++;
+     const std::size_t misalignment = reinterpret_cast<std::size_t>(&_storage[0]) % 64;
+     _start = (misalignment == 0)?0:(64 - misalignment) / sizeof(CoeffType);
+
+     return;
+  }
+
+  template <typename CoeffType>
+  inline
+  unsigned int DiffusionWorkspace<CoeffType>::n_species() const
+  {
+     return _n_species;
+  }
+
+  template <typename CoeffType>
+  inline
+  unsigned int DiffusionWorkspace<CoeffType>::n_medium() const
+  {
+     return _n_medium;
+  }
+
+  template <typename CoeffType>
+  inline
+  unsigned int DiffusionWorkspace<CoeffType>::stride() const
+  {
+     return _stride;
+  }
+
+  template <typename CoeffType>
+  inline
+  CoeffType * DiffusionWorkspace<CoeffType>::Dtilde()
+  {
+     return &_storage[_start];
+  }
+
+  template <typename CoeffType>
+  inline
+  const CoeffType * DiffusionWorkspace<CoeffType>::Dtilde() const
+  {
+     return &_storage[_start];
+  }
+
+  template <typename CoeffType>
+  inline
+  CoeffType * DiffusionWorkspace<CoeffType>::dDtilde_dn(unsigned int s)
+  {
+     antioch_assert_less(s,_n_species);
+     return &_storage[_start + _dDtilde_dn + std::size_t(s) * _stride];
+  }
+
+  template <typename CoeffType>
+  inline
+  const CoeffType * DiffusionWorkspace<CoeffType>::dDtilde_dn(unsigned int s) const
+  {
+     antioch_assert_less(s,_n_species);
+     return &_storage[_start + _dDtilde_dn + std::size_t(s) * _stride];
+  }
+
+  template <typename CoeffType>
+  inline
+  CoeffType * DiffusionWorkspace<CoeffType>::binary()
+  {
+     return &_storage[_start + _binary];
+  }
+
+  template <typename CoeffType>
+  inline
+  CoeffType * DiffusionWorkspace<CoeffType>::dHa_dn()
+  {
+     return &_storage[_start + _dHa_dn];
+  }
+
+  template <typename CoeffType>
+  inline
+  unsigned int DiffusionWorkspace<CoeffType>::n_allocations() const
+  {
+     return _n_allocations;
+  }
+}
+
+#endif
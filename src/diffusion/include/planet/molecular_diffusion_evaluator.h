@@ -30,11 +30,13 @@
 
 //Planet
 #include "planet/binary_diffusion.h"
+#include "planet/diffusion_workspace.h"
 #include "planet/atmospheric_mixture.h"
 #include "planet/atmospheric_temperature.h"
 
 //C++
-
+#include <vector>
+#include <iostream>
 
 namespace Planet
 {
@@ -46,7 +48,10 @@ namespace Planet
         MolecularDiffusionEvaluator() {antioch_error();return;}
 
         unsigned int _n_medium;
+        unsigned int _n_species;
         std::vector<unsigned int> _i_medium;
+        //! medium index of each species, \p _n_medium if not in the medium
+        std::vector<unsigned int> _medium_index;
 
     //dependencies
         //! stock of binary diffusion coefficients
@@ -54,21 +59,48 @@ namespace Planet
         const AtmosphericMixture<CoeffType, VectorCoeffType,MatrixCoeffType>  & _mixture;
         const AtmosphericTemperature<CoeffType, VectorCoeffType>              & _temperature;
 
-        //! The coefficients are unknown, i heavier than j
-        template<typename StateType>
-        ANTIOCH_AUTO(StateType)
-        binary_coefficient_unknown_ji(unsigned int m, unsigned int j, const StateType &T, const StateType &P) const
-        ANTIOCH_AUTOFUNC(StateType,_diffusion[m][m].binary_coefficient(T,P) * 
-                                   Antioch::ant_sqrt( (_mixture.neutral_composition().M(j)/_mixture.neutral_composition().M(_i_medium[m]) + Antioch::constant_clone(T,1)) / Antioch::constant_clone(T,2) )
-                                   )
-        //! The coefficients are unknown, j heavier than i
-        template<typename StateType>
-        ANTIOCH_AUTO(StateType)
-        binary_coefficient_unknown_ij(unsigned int m, unsigned int j, const StateType &T, const StateType &P) const
-        ANTIOCH_AUTOFUNC(StateType,_diffusion[m][m].binary_coefficient(T,P) * Antioch::ant_sqrt(_mixture.neutral_composition().M(j)/_mixture.neutral_composition().M(_i_medium[m])))
+    //binary table, pair (m,s) stored at m * n_species + s
+        //! \f$D_{01}\f$ of the pair, mass-scaled from the medium when no data
+        std::vector<CoeffType> _D01;
+        //! index of the pair exponent in \p _betas
+        std::vector<unsigned int> _beta_index;
+        //! distinct exponents
+        std::vector<CoeffType> _betas;
+        //! pairs sorted by exponent, pairs of _betas[b] are in [_beta_start[b],_beta_start[b+1])
+        std::vector<unsigned int> _beta_start;
+        std::vector<unsigned int> _beta_pairs;
 
         void set_medium_species(const std::vector<std::string> &medium_species);
 
+        //! resolves the pairs without data and sorts the exponents
+        void build_binary_table();
+
+        /*! \f$\sum_{j \neq d} M_j n_j\f$, \f$d\f$ being the most abundant species,
+            from which each mean molar mass without \f$s\f$ is obtained in O(1)
+            without cancellation */
+        template<typename StateType, typename VectorStateType>
+        StateType molar_mass_sum(const VectorStateType & molar_concentrations, unsigned int & dominant) const;
+
+        //! \f$M_{\neq s}\f$ from molar_mass_sum()
+        template<typename StateType, typename VectorStateType>
+        StateType mean_molar_mass_without(unsigned int s, unsigned int dominant, const StateType & M_sum,
+                                          const VectorStateType & molar_concentrations, const StateType & nTot_diff) const;
+
+        //! binary_coefficients() in a sized container
+        template<typename StateType, typename BinaryType>
+        void fill_binary_coefficients(const StateType &T, const StateType &P, BinaryType &D) const;
+
+        //! \f$\tilde{D}_s\f$ from the binary table given by binary_coefficients()
+        template<typename StateType, typename VectorStateType, typename BinaryType>
+        StateType Dtilde_from_binary(unsigned int s, const StateType & nTot, unsigned int dominant, const StateType & M_sum,
+                                     const VectorStateType & molar_concentrations, const BinaryType & binary) const;
+
+        //! \f$\tilde{D}_s\f$ and its derivatives with respect to concentrations from the binary table
+        template<typename StateType, typename VectorStateType, typename BinaryType, typename RowStateType>
+        void Dtilde_and_derivative_n_from_binary(unsigned int s, const VectorStateType &molar_concentrations, const StateType &nTot, 
+                                                 unsigned int dominant, const StateType & M_sum, const BinaryType & binary,
+                                                 StateType & Dtilde, RowStateType & dDtilde_dn) const;
+
 
      public:
         //!
@@ -89,51 +121,63 @@ namespace Planet
         void Dtilde(const VectorStateType &molar_concentrations, const StateType &T,
                     VectorStateType &Dtilde) const;// Dtilde
 
+        //! \f$\tilde{D}\f$ in \p workspace, no allocation
+        template<typename StateType, typename VectorStateType>
+        void Dtilde(const VectorStateType &molar_concentrations, const StateType &T,
+                    DiffusionWorkspace<CoeffType> &workspace) const;
+
         //!
         template<typename StateType>
         ANTIOCH_AUTO(StateType)
         binary_coefficient(unsigned int m, unsigned int j, const StateType &T, const StateType &P) const
-        ANTIOCH_AUTOFUNC(StateType,(_diffusion[m][j].diffusion_model() != DiffusionType::NoData)?
-                                             _diffusion[m][j].binary_coefficient(T,P):
-                                                (_mixture.neutral_composition().M(j) < _mixture.neutral_composition().M(_i_medium[m]))?
-                                                        this->binary_coefficient_unknown_ji(m,j,T,P):
-                                                        this->binary_coefficient_unknown_ij(m,j,T,P))
+        ANTIOCH_AUTOFUNC(StateType,_D01[m * _n_species + j] * Constants::Convention::P_normal<StateType>() / P * 
+                                   Antioch::ant_pow(T/Constants::Convention::T_standard<StateType>(),_betas[_beta_index[m * _n_species + j]]))
 
         //! \f$\frac{\partial D_{m,s}}{\partial n_i}\f$
         template<typename StateType>
         ANTIOCH_AUTO(StateType)
         binary_coefficient_deriv_n(unsigned int m, unsigned int s, unsigned int /*i*/, const StateType & T, const StateType & P, const StateType & nTot) const
-        ANTIOCH_AUTOFUNC(StateType,(_diffusion[m][s].diffusion_model() != DiffusionType::NoData)?
-                                             _diffusion[m][s].binary_coefficient_deriv_n(T,P,nTot):
-                                                (_mixture.neutral_composition().M(_i_medium[m]) < _mixture.neutral_composition().M(s))?
-                                                    Antioch::ant_sqrt(_mixture.neutral_composition().M(s) / _mixture.neutral_composition().M(_i_medium[m])) * 
-                                                                        _diffusion[m][_i_medium[m]].binary_coefficient_deriv_n(T,P,nTot)
-                                                        :
-                                                    Antioch::ant_sqrt( _mixture.neutral_composition().M(s) /( Antioch::constant_clone(T,2) * _mixture.neutral_composition().M(_i_medium[m])) + 
-                                                                        Antioch::constant_clone(T,0.5) ) * 
-                                                                        _diffusion[m][_i_medium[m]].binary_coefficient_deriv_n(T,P,nTot)
-                        )
+        ANTIOCH_AUTOFUNC(StateType, - this->binary_coefficient(m,s,T,P) / nTot)
 
         //! \f$\frac{\partial D_{m,s}}{\partial T}\f$
         template<typename StateType>
         ANTIOCH_AUTO(StateType)
         binary_coefficient_deriv_T(unsigned int m, unsigned int s, const StateType & T, const StateType & P) const
-        ANTIOCH_AUTOFUNC(StateType,(_diffusion[m][s].diffusion_model() != DiffusionType::NoData)?
-                                             _diffusion[m][s].binary_coefficient_deriv_T(T,P):
-                                                (_mixture.neutral_composition().M(_i_medium[m]) < _mixture.neutral_composition().M(s))?
-                                                    Antioch::ant_sqrt(_mixture.neutral_composition().M(s) / _mixture.neutral_composition().M(_i_medium[m])) * 
-                                                                        _diffusion[m][_i_medium[m]].binary_coefficient_deriv_T(T,P)
-                                                    :
-                                                    Antioch::ant_sqrt( _mixture.neutral_composition().M(s) /( Antioch::constant_clone(T,2) * _mixture.neutral_composition().M(_i_medium[m])) + 
-                                                                        Antioch::constant_clone(T,0.5) ) * 
-                                                                        _diffusion[m][_i_medium[m]].binary_coefficient_deriv_T(T,P)
-                        )
+        ANTIOCH_AUTOFUNC(StateType,this->binary_coefficient(m,s,T,P) / T * (_betas[_beta_index[m * _n_species + s]] - CoeffType(1.L)))
+
+        //! all the \f$D_{m,s}\f$, stored at m * n_species + s, one power per distinct exponent
+        template<typename StateType, typename VectorStateType>
+        void binary_coefficients(const StateType &T, const StateType &P, VectorStateType &D) const;
+
+        //! all the \f$D_{m,s}\f$ and \f$\frac{\partial D_{m,s}}{\partial T}\f$
+        template<typename StateType, typename VectorStateType>
+        void binary_coefficients_and_deriv_T(const StateType &T, const StateType &P, VectorStateType &D, VectorStateType &dD_dT) const;
+
+        //! number of medium species
+        unsigned int n_medium() const;
+
+        //!\return index in the mixture of the medium species \p m
+        unsigned int medium_species(unsigned int m) const;
+
+        //!\return \f$D_{01}\f$ of the pair (m,s), mass-scaled from the medium when no data
+        CoeffType binary_D01(unsigned int m, unsigned int s) const;
+
+        //!\return temperature exponent of the pair (m,s)
+        CoeffType binary_beta(unsigned int m, unsigned int s) const;
+
+        //! number of distinct exponents in the binary table
+        unsigned int n_distinct_exponents() const;
 
         //! \f$\tilde{D}\f$ and all the derivatives with respect to concentrations
         template<typename StateType, typename VectorStateType, typename MatrixStateType>
         void Dtilde_and_derivs_dn(const VectorStateType &molar_concentrations, const StateType &T, const StateType &nTot, 
                                   VectorStateType &Dtilde, MatrixStateType &dD_dns) const;
 
+        //! \f$\tilde{D}\f$ and all the derivatives with respect to concentrations in \p workspace, no allocation
+        template<typename StateType, typename VectorStateType>
+        void Dtilde_and_derivs_dn(const VectorStateType &molar_concentrations, const StateType &T, const StateType &nTot, 
+                                  DiffusionWorkspace<CoeffType> &workspace) const;
+
         //! \f$\tilde{D}_s\f$ and all its derivatives with respect to concentrations
         template<typename StateType, typename VectorStateType>
         void Dtilde_and_derivative_n(unsigned int s, const VectorStateType &molar_concentrations, const StateType &T, const StateType &nTot,
@@ -162,11 +206,13 @@ namespace Planet
                         const std::vector<std::string> & medium
                        ):
        _n_medium(diff.size()),
+       _n_species(comp.neutral_composition().n_species()),
        _diffusion(diff),
        _mixture(comp),
        _temperature(temp)
   {
      this->set_medium_species(medium);
+     this->build_binary_table();
      return;
   }
 
@@ -180,10 +226,174 @@ namespace Planet
     {
       _i_medium[i] = _mixture.neutral_composition().species_name_map().at(medium_species[i]);
     }
+    _medium_index.assign(_mixture.neutral_composition().n_species(),_n_medium);
+    for(unsigned int i = 0; i < _n_medium; i++)
+    {
+      _medium_index[_i_medium[i]] = i;
+    }
   
     return; 
    }
 
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  void MolecularDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::build_binary_table()
+  {
+    antioch_assert_equal_to(_n_species,_mixture.neutral_composition().n_species());
+
+    _D01.resize(_n_medium * _n_species);
+    _beta_index.resize(_n_medium * _n_species);
+    _betas.clear();
+
+    std::vector<CoeffType> beta(_n_medium * _n_species);
+    for(unsigned int m = 0; m < _n_medium; m++)
+    {
+      antioch_assert_equal_to(_diffusion[m].size(),_n_species);
+      const BinaryDiffusion<CoeffType> & medium = _diffusion[m][_i_medium[m]];
+      for(unsigned int s = 0; s < _n_species; s++)
+      {
+        const unsigned int ms = m * _n_species + s;
+        if(_diffusion[m][s].diffusion_model() != DiffusionType::NoData)
+        {
+          _D01[ms] = _diffusion[m][s].D01();
+          beta[ms] = _diffusion[m][s].beta();
+        }else
+        {
+// no data: medium self-diffusion, scaled by the masses
+          if(medium.diffusion_model() == DiffusionType::NoData)
+          {
+             std::cerr << "No binary diffusion data for the medium species "
+                       << _mixture.neutral_composition().species_inverse_name_map().at(_i_medium[m]) << std::endl;
+             antioch_error();
+          }
+          const CoeffType M_ratio = _mixture.neutral_composition().M(s) / _mixture.neutral_composition().M(_i_medium[m]);
+          _D01[ms] = medium.D01() * ((M_ratio < CoeffType(1.L))?Antioch::ant_sqrt((M_ratio + CoeffType(1.L)) / CoeffType(2.L)):
+                                                               Antioch::ant_sqrt(M_ratio));
+          beta[ms] = medium.beta();
+        }
+
+        unsigned int b(0);
+        while(b < _betas.size() && _betas[b] != beta[ms])b++;
+        if(b == _betas.size())_betas.push_back(beta[ms]);
+        _beta_index[ms] = b;
+      }
+    }
+
+// pairs grouped by exponent
+    _beta_start.assign(_betas.size() + 1,0);
+    for(unsigned int ms = 0; ms < _beta_index.size(); ms++)
+    {
+      _beta_start[_beta_index[ms] + 1]++;
+    }
+    for(unsigned int b = 0; b < _betas.size(); b++)
+    {
+      _beta_start[b + 1] += _beta_start[b];
+    }
+    _beta_pairs.resize(_beta_index.size());
+    std::vector<unsigned int> fill(_beta_start.begin(),_beta_start.end() - 1);
+    for(unsigned int ms = 0; ms < _beta_index.size(); ms++)
+    {
+      _beta_pairs[fill[_beta_index[ms]]++] = ms;
+    }
+
+    return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  unsigned int MolecularDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::n_medium() const
+  {
+    return _n_medium;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  unsigned int MolecularDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::medium_species(unsigned int m) const
+  {
+    antioch_assert_less(m,_n_medium);
+    return _i_medium[m];
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  CoeffType MolecularDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::binary_D01(unsigned int m, unsigned int s) const
+  {
+    antioch_assert_less(m,_n_medium);
+    antioch_assert_less(s,_n_species);
+    return _D01[m * _n_species + s];
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  CoeffType MolecularDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::binary_beta(unsigned int m, unsigned int s) const
+  {
+    antioch_assert_less(m,_n_medium);
+    antioch_assert_less(s,_n_species);
+    return _betas[_beta_index[m * _n_species + s]];
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  unsigned int MolecularDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::n_distinct_exponents() const
+  {
+    return _betas.size();
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType>
+  inline
+  void MolecularDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::binary_coefficients(const StateType &T, const StateType &P, VectorStateType &D) const
+  {
+    D.resize(_D01.size());
+    this->fill_binary_coefficients(T,P,D);
+
+    return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename BinaryType>
+  inline
+  void MolecularDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::fill_binary_coefficients(const StateType &T, const StateType &P, BinaryType &D) const
+  {
+    const StateType T_reduced = T / Constants::Convention::T_standard<StateType>();
+    const StateType P_reduced = Constants::Convention::P_normal<StateType>() / P;
+    for(unsigned int b = 0; b < _betas.size(); b++)
+    {
+      const StateType factor = P_reduced * Antioch::ant_pow(T_reduced,_betas[b]);
+      for(unsigned int k = _beta_start[b]; k < _beta_start[b + 1]; k++)
+      {
+        D[_beta_pairs[k]] = _D01[_beta_pairs[k]] * factor;
+      }
+    }
+
+    return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType>
+  inline
+  void MolecularDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::binary_coefficients_and_deriv_T(const StateType &T, const StateType &P, 
+                                                                                                              VectorStateType &D, VectorStateType &dD_dT) const
+  {
+    D.resize(_D01.size());
+    dD_dT.resize(_D01.size());
+
+    const StateType T_reduced = T / Constants::Convention::T_standard<StateType>();
+    const StateType P_reduced = Constants::Convention::P_normal<StateType>() / P;
+    for(unsigned int b = 0; b < _betas.size(); b++)
+    {
+      const StateType factor = P_reduced * Antioch::ant_pow(T_reduced,_betas[b]);
+      const StateType dfactor = (_betas[b] - CoeffType(1.L)) / T;
+      for(unsigned int k = _beta_start[b]; k < _beta_start[b + 1]; k++)
+      {
+        D[_beta_pairs[k]]     = _D01[_beta_pairs[k]] * factor;
+        dD_dT[_beta_pairs[k]] = D[_beta_pairs[k]] * dfactor;
+      }
+    }
+
+    return;
+  }
+
   template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
   template<typename StateType, typename VectorStateType>
   inline
@@ -203,12 +413,111 @@ namespace Planet
 // p = n * kb * T  (Pa)
      CoeffType p = nTot * Antioch::constant_clone(nTot,1e6) //cm-3 -> m-3
                    * Constants::Universal::kb<CoeffType>() * T;
+
+     VectorStateType binary(_D01.size());
+     this->binary_coefficients(T,p,binary);
+
+     unsigned int dominant;
+     const CoeffType M_sum = this->molar_mass_sum<CoeffType>(molar_concentrations,dominant);
      for(unsigned int s = 0; s < _mixture.neutral_composition().n_species(); s++)
      {
-        Dtilde[s] = this->Dtilde(s,nTot,T,p,molar_concentrations);
+        Dtilde[s] = this->Dtilde_from_binary(s,nTot,dominant,M_sum,molar_concentrations,binary);
+     }
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType>
+  inline
+  void MolecularDiffusionEvaluator<CoeffType, VectorCoeffType,MatrixCoeffType>::Dtilde(const VectorStateType &molar_concentrations, const StateType &T,
+                                                                                       DiffusionWorkspace<CoeffType> &workspace) const
+  {
+     antioch_assert_equal_to(molar_concentrations.size(),_mixture.neutral_composition().n_species());
+     antioch_assert_equal_to(workspace.n_species(),_n_species);
+     antioch_assert_equal_to(workspace.n_medium(),_n_medium);
+
+     StateType nTot;
+     Antioch::set_zero(nTot);
+     for(unsigned int s = 0; s < molar_concentrations.size(); s++)
+     {
+        nTot += molar_concentrations[s];
+     }
+
+// p = n * kb * T  (Pa)
+     StateType p = nTot * Antioch::constant_clone(nTot,1e6) //cm-3 -> m-3
+                   * Constants::Universal::kb<CoeffType>() * T;
+
+     CoeffType * binary = workspace.binary();
+     this->fill_binary_coefficients(T,p,binary);
+
+     unsigned int dominant;
+     const StateType M_sum = this->molar_mass_sum<StateType>(molar_concentrations,dominant);
+     CoeffType * Dtilde = workspace.Dtilde();
+     for(unsigned int s = 0; s < _n_species; s++)
+     {
+        Dtilde[s] = this->Dtilde_from_binary(s,nTot,dominant,M_sum,molar_concentrations,binary);
      }
   }
 
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType>
+  inline
+  StateType MolecularDiffusionEvaluator<CoeffType, VectorCoeffType,MatrixCoeffType>::molar_mass_sum(const VectorStateType & molar_concentrations,
+                                                                                                    unsigned int & dominant) const
+  {
+        dominant = 0;
+        for(unsigned int i = 1; i < _mixture.neutral_composition().n_species(); i++)
+        {
+          if(molar_concentrations[dominant] < molar_concentrations[i])dominant = i;
+        }
+        StateType M_sum;
+        Antioch::set_zero(M_sum);
+        for(unsigned int i = 0; i < _mixture.neutral_composition().n_species(); i++)
+        {
+          if(i == dominant)continue;
+          M_sum += _mixture.neutral_composition().M(i) * molar_concentrations[i];
+        }
+        return M_sum;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType>
+  inline
+  StateType MolecularDiffusionEvaluator<CoeffType, VectorCoeffType,MatrixCoeffType>::mean_molar_mass_without(unsigned int s, unsigned int dominant,
+                                                                                                             const StateType & M_sum,
+                                                                                                             const VectorStateType & molar_concentrations,
+                                                                                                             const StateType & nTot_diff) const
+  {
+        return (s == dominant)?M_sum / nTot_diff:
+                               ( _mixture.neutral_composition().M(dominant) * molar_concentrations[dominant] + 
+                                (M_sum - _mixture.neutral_composition().M(s) * molar_concentrations[s]) ) / nTot_diff;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType, typename BinaryType>
+  inline
+  StateType MolecularDiffusionEvaluator<CoeffType, VectorCoeffType,MatrixCoeffType>::Dtilde_from_binary(unsigned int s, const StateType & nTot, 
+                                                                                                        unsigned int dominant, const StateType & M_sum,
+                                                                                                        const VectorStateType & molar_concentrations,
+                                                                                                        const BinaryType & binary) const
+  {
+//M_{/=}
+        StateType ntot_s = nTot - molar_concentrations[s]; //ntot - ns
+        StateType meanM = this->mean_molar_mass_without(s,dominant,M_sum,molar_concentrations,ntot_s);
+//Ds denominator : sum_{j_m} n_{j_m}/D_{s,j_m}
+        StateType n_D;
+        Antioch::set_zero(n_D);
+        for(unsigned int m = 0; m < _n_medium; m++)
+        {
+          if(_i_medium[m] == s)continue;
+          n_D += molar_concentrations[_i_medium[m]] / binary[m * _n_species + s];
+        }
+// cm2.s-1
+        return ntot_s / ( n_D * ( 
+                                  1 - molar_concentrations[s]/nTot * (1 - _mixture.neutral_composition().M(s) / meanM)
+                                )
+                        );
+  }
+
   template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
   template<typename StateType, typename VectorStateType>
   inline
@@ -217,15 +526,10 @@ namespace Planet
                                                                                     const StateType & p, const VectorStateType & molar_concentrations) const
   {
 //M_{/=}
-        StateType meanM;
-        Antioch::set_zero(meanM);
         StateType ntot_s = nTot - molar_concentrations[s]; //ntot - ns
-        for(unsigned int i = 0; i < _mixture.neutral_composition().n_species(); i++)
-        {
-          if(i == s)continue;
-          meanM += _mixture.neutral_composition().M(i) * molar_concentrations[i]; //x_i without s: ni/(ntot - ns)
-        }
-        meanM /= ntot_s;
+        unsigned int dominant;
+        StateType M_sum = this->molar_mass_sum<StateType>(molar_concentrations,dominant);
+        StateType meanM = this->mean_molar_mass_without(s,dominant,M_sum,molar_concentrations,ntot_s);
 //Ds denominator : sum_{j_m} n_{j_m}/D_{s,j_m}
         StateType n_D;
         Antioch::set_zero(n_D);
@@ -259,9 +563,41 @@ namespace Planet
      }
 #endif
 
+     StateType p = nTot * Antioch::constant_clone(nTot,1e6) //cm-3 -> m-3
+                        * Constants::Universal::kb<CoeffType>() * T;
+     VectorStateType binary(_D01.size());
+     this->binary_coefficients(T,p,binary);
+
+     unsigned int dominant;
+     const StateType M_sum = this->molar_mass_sum<StateType>(molar_concentrations,dominant);
      for(unsigned int s = 0; s < dD_dns.size(); s++)
      {
-       this->Dtilde_and_derivative_n(s,molar_concentrations,T,nTot,Dtilde[s],dD_dns[s]);
+       this->Dtilde_and_derivative_n_from_binary(s,molar_concentrations,nTot,dominant,M_sum,binary,Dtilde[s],dD_dns[s]);
+     }
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType>
+  inline
+  void MolecularDiffusionEvaluator<CoeffType, VectorCoeffType,MatrixCoeffType>::Dtilde_and_derivs_dn(const VectorStateType &molar_concentrations, const StateType &T, const StateType &nTot, 
+                                                                                                DiffusionWorkspace<CoeffType> &workspace) const
+  {
+     antioch_assert_equal_to(molar_concentrations.size(),_mixture.neutral_composition().n_species());
+     antioch_assert_equal_to(workspace.n_species(),_n_species);
+     antioch_assert_equal_to(workspace.n_medium(),_n_medium);
+
+     StateType p = nTot * Antioch::constant_clone(nTot,1e6) //cm-3 -> m-3
+                        * Constants::Universal::kb<CoeffType>() * T;
+     CoeffType * binary = workspace.binary();
+     this->fill_binary_coefficients(T,p,binary);
+
+     unsigned int dominant;
+     const StateType M_sum = this->molar_mass_sum<StateType>(molar_concentrations,dominant);
+     CoeffType * Dtilde = workspace.Dtilde();
+     for(unsigned int s = 0; s < _n_species; s++)
+     {
+       CoeffType * dD_dn = workspace.dDtilde_dn(s);
+       this->Dtilde_and_derivative_n_from_binary(s,molar_concentrations,nTot,dominant,M_sum,binary,Dtilde[s],dD_dn);
      }
   }
 
@@ -274,10 +610,32 @@ namespace Planet
                                                                                                         StateType & Dtilde,
                                                                                                         VectorStateType & dDtilde_dn) const
   {
-
         antioch_assert_equal_to(molar_concentrations.size(),_mixture.neutral_composition().n_species());
         antioch_assert_equal_to(dDtilde_dn.size(),_mixture.neutral_composition().n_species());
 
+        StateType p = nTot * Antioch::constant_clone(nTot,1e6) //cm-3 -> m-3
+                           * Constants::Universal::kb<CoeffType>() * T;
+        VectorStateType binary(_D01.size());
+        this->binary_coefficients(T,p,binary);
+
+        unsigned int dominant;
+        const StateType M_sum = this->molar_mass_sum<StateType>(molar_concentrations,dominant);
+        this->Dtilde_and_derivative_n_from_binary(s,molar_concentrations,nTot,dominant,M_sum,binary,Dtilde,dDtilde_dn);
+
+        return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType, typename BinaryType, typename RowStateType>
+  inline
+  void MolecularDiffusionEvaluator<CoeffType, VectorCoeffType,MatrixCoeffType>::Dtilde_and_derivative_n_from_binary(unsigned int s,
+                                                                                                        const VectorStateType &molar_concentrations,
+                                                                                                        const StateType &nTot, 
+                                                                                                        unsigned int dominant, const StateType &M_sum,
+                                                                                                        const BinaryType & binary,
+                                                                                                        StateType & Dtilde,
+                                                                                                        RowStateType & dDtilde_dn) const
+  {
 /////////////
 // Wilke part
 /////////////
@@ -286,19 +644,12 @@ namespace Planet
         // nt - ns
         StateType nTot_diff = nTot - molar_concentrations[s];
         // 1/(nt - ns)
-        StateType one_over_nTot_diff = Antioch::constant_clone(T,1) / nTot_diff;
+        StateType one_over_nTot_diff = Antioch::constant_clone(nTot,1) / nTot_diff;
 
 //// M_{\neq}
-        StateType meanM;
-        Antioch::set_zero(meanM);
-        for(unsigned int j = 0; j < _mixture.neutral_composition().n_species(); j++)
-        {
-          if(j == s)continue;
-          meanM += _mixture.neutral_composition().M(j) * molar_concentrations[j]; 
-        }
-        meanM /= nTot_diff;
+        StateType meanM = this->mean_molar_mass_without(s,dominant,M_sum,molar_concentrations,nTot_diff);
 // 1 / nt
-        StateType one_over_nTot = Antioch::constant_clone(T,1) / nTot;
+        StateType one_over_nTot = Antioch::constant_clone(nTot,1) / nTot;
 // Ms / M_{\neq}
         StateType Ms_over_Mmean = _mixture.neutral_composition().M(s) / meanM;
 
@@ -307,51 +658,48 @@ namespace Planet
 // ns / nt^2
         StateType ns_over_ntot_square = molar_concentrations[s] * one_over_nTot * one_over_nTot;
 // 1 - Ms / M_{\neq}
-        StateType one_minus_Ms_over_Mdiff = Antioch::constant_clone(T,1) - Ms_over_Mmean;
+        StateType one_minus_Ms_over_Mdiff = Antioch::constant_clone(nTot,1) - Ms_over_Mmean;
 
 // bimolecular diffusion, Wilke rule
         StateType sum_bimol;
         Antioch::set_zero(sum_bimol);
-        StateType p = nTot * Antioch::constant_clone(nTot,1e6) //cm-3 -> m-3
-                           * Constants::Universal::kb<CoeffType>() * T;
-
         for(unsigned int m = 0; m < _n_medium; m++)
         {
           if(_i_medium[m] == s)continue;
-          sum_bimol += molar_concentrations[_i_medium[m]] / this->binary_coefficient(m,s,T,p);
+          sum_bimol += molar_concentrations[_i_medium[m]] / binary[m * _n_species + s];
         }
 // Ds
         StateType one_over_Ds = sum_bimol / nTot_diff;
 
-// term for derivative
-        std::map<unsigned int, StateType> Ds_medium_term;
-        for(unsigned int m = 0; m < _n_medium; m++)
-        {
-          if(_i_medium[m] == s)continue;
-          Ds_medium_term[_i_medium[m]] = Antioch::constant_clone(T,1) / (this->binary_coefficient(m,s,T,p) * sum_bimol);          
-        }
-
 ///////////
 // Dtilde, De La Haye modification
 //////
         
-        StateType denom = Antioch::constant_clone(T,1) - molar_concentrations[s] * one_over_nTot * one_minus_Ms_over_Mdiff;
+        StateType denom = Antioch::constant_clone(nTot,1) - molar_concentrations[s] * one_over_nTot * one_minus_Ms_over_Mdiff;
 
         Dtilde = nTot_diff / (denom * sum_bimol);
-//      dDtilde_dT = dDs_dT * Dtilde / Ds
+        const StateType Dtilde_over_Ds = Dtilde * one_over_Ds;
 
-        for(unsigned int k = 0; k < _mixture.neutral_composition().n_species(); k++)
+// one pass over the row, the medium terms 1 / (D_{m,s} sum_bimol) are read from the binary table
+        for(unsigned int k = 0; k < _n_species; k++)
         {
           dDtilde_dn[k] = - ns_over_ntot_square;
-          if(k == s)dDtilde_dn[k] += one_over_nTot;
-          dDtilde_dn[k] *= one_minus_Ms_over_Mdiff;
-          if(k != s)dDtilde_dn[k] += molar_mass_term * (_mixture.neutral_composition().M(k) - meanM);
-          dDtilde_dn[k] *= Dtilde * one_over_Ds;
-          dDtilde_dn[k] -= one_over_nTot;
-          if(Ds_medium_term.count(k))dDtilde_dn[k] -= Ds_medium_term[k];
-          if(k != s)dDtilde_dn[k] += one_over_nTot_diff;
+          if(k == s)
+          {
+            dDtilde_dn[k] += one_over_nTot;
+            dDtilde_dn[k] *= one_minus_Ms_over_Mdiff;
+            dDtilde_dn[k] *= Dtilde_over_Ds;
+            dDtilde_dn[k] -= one_over_nTot;
+          }else
+          {
+            dDtilde_dn[k] *= one_minus_Ms_over_Mdiff;
+            dDtilde_dn[k] += molar_mass_term * (_mixture.neutral_composition().M(k) - meanM);
+            dDtilde_dn[k] *= Dtilde_over_Ds;
+            dDtilde_dn[k] -= one_over_nTot;
+            if(_medium_index[k] < _n_medium)dDtilde_dn[k] -= Antioch::constant_clone(nTot,1) / (binary[_medium_index[k] * _n_species + s] * sum_bimol);
+            dDtilde_dn[k] += one_over_nTot_diff;
+          }
           dDtilde_dn[k] *= Dtilde;
-
         }
 
         return;
@@ -379,6 +727,13 @@ namespace Planet
                         * Constants::Universal::kb<CoeffType>() * T;
 
 
+     VectorStateType binary(_D01.size());
+     VectorStateType dbinary_dT(_D01.size());
+     this->binary_coefficients_and_deriv_T(T,p,binary,dbinary_dT);
+
+     unsigned int dominant;
+     const StateType M_sum = this->molar_mass_sum<StateType>(molar_concentrations,dominant);
+
      for(unsigned int s = 0; s < molar_concentrations.size(); s++)
      {
 
@@ -394,8 +749,8 @@ namespace Planet
         {
           if(_i_medium[m] == s)continue;
 
-          StateType Dsjm = Antioch::constant_clone(T,1) / this->binary_coefficient(m,s,T,p);
-          StateType dDsjm_dT = this->binary_coefficient_deriv_T(m,s,T, p);
+          StateType Dsjm = Antioch::constant_clone(T,1) / binary[m * _n_species + s];
+          StateType dDsjm_dT = dbinary_dT[m * _n_species + s];
 
           sum_bimol += molar_concentrations[_i_medium[m]] * Dsjm;
           numerator += molar_concentrations[_i_medium[m]] * Dsjm * Dsjm * dDsjm_dT;
@@ -404,14 +759,7 @@ namespace Planet
         StateType dDs_dT = nTot_diff /(sum_bimol * sum_bimol) * numerator;
 
 // DTilde, De La Haye version
-        StateType meanM;
-        Antioch::set_zero(meanM);
-        for(unsigned int j = 0; j < _mixture.neutral_composition().n_species(); j++)
-        {
-          if(j == s)continue;
-          meanM += _mixture.neutral_composition().M(j) * molar_concentrations[j]; 
-        }
-        meanM /= nTot_diff;
+        StateType meanM = this->mean_molar_mass_without(s,dominant,M_sum,molar_concentrations,nTot_diff);
 
         dDtilde_dT[s] = dDs_dT / (Antioch::constant_clone(T,1) - molar_concentrations[s] / nTot * 
                                                                  (Antioch::constant_clone(T,1) - _mixture.neutral_composition().M(s) / meanM) );
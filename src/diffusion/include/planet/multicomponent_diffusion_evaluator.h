@@ -0,0 +1,454 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// Planet - An atmospheric code for planetary bodies, adapted to Titan
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+
+#ifndef PLANET_MULTICOMPONENT_DIFFUSION_EVALUATOR_H
+#define PLANET_MULTICOMPONENT_DIFFUSION_EVALUATOR_H
+
+//Antioch
+#include "antioch/antioch_asserts.h"
+#include "antioch/cmath_shims.h"
+
+//Planet
+#include "planet/molecular_diffusion_evaluator.h"
+#include "planet/diffusion_workspace.h"
+#include "planet/atmospheric_mixture.h"
+
+//Eigen
+#include <Eigen/Dense>
+
+//C++
+#include <vector>
+
+namespace Planet
+{
+  /*! Stefan-Maxwell diffusion coefficients, in place of the Wilke rule of
+   *  MolecularDiffusionEvaluator.
+   *
+   *  The velocities \f$u\f$ of the species answer the driving forces \f$d\f$ through
+   *  \f$\sum_j \frac{x_ix_j}{D_{ij}}(u_j - u_i) = d_i\f$ with \f$\sum_i y_i u_i = 0\f$,
+   *  \f$x\f$ and \f$y\f$ being the molar and mass fractions. The coefficient of
+   *  species \f$s\f$ is its velocity when it is driven out of its diffusive equilibrium,
+   *  the rest of the gas compensating uniformly, \f$d_j = - x_j\frac{x_s}{1-x_s}\f$:
+   *  it is \f$\tilde{D}_s\f$ if the rest of the gas moves as one, the Stefan-Maxwell
+   *  system lets it move species by species.
+   *
+   *  Rows divided by \f$x_i\f$, the system matrix \f$M_{ij} = -\frac{n_j}{D_{ij}n}\f$,
+   *  \f$M_{ii} = \sum_{j\neq i}\frac{n_j}{D_{ij}n}\f$ is linear in the concentrations
+   *  (\f$D_{ij}n\f$ depends only on \f$T\f$). Closed by \f$B = M + \alpha\mathbf{1}y^T\f$,
+   *  the coefficients are \f$D_s = \frac{B^{-1}_{ss} - x_s/\alpha}{1 - x_s}\f$ whatever
+   *  \f$\alpha\f$, and the derivatives follow from \f$\partial B^{-1} = - B^{-1}\partial B B^{-1}\f$.
+   *  One factorization per point, \f$O(N^3)\f$ with the derivatives.
+   *
+   *  The pairs of MolecularDiffusionEvaluator are used as they are, the pairs of two
+   *  species out of the medium are built from their pairs with the first medium species,
+   *  hard spheres with \f$\sigma_{ij}^2 = \sigma_{0i}\sigma_{0j}\f$.
+   *
+   *  The factorization and the scratch are sized once and filled at each
+   *  evaluation, an evaluator is not to be shared between threads.
+   */
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  class MulticomponentDiffusionEvaluator
+  {
+     private:
+        //! don't use it
+        MulticomponentDiffusionEvaluator() {antioch_error();return;}
+
+        typedef Eigen::Matrix<CoeffType,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor> MatrixType;
+        typedef Eigen::Matrix<CoeffType,1,Eigen::Dynamic>                              RowType;
+
+    //dependencies
+        const MolecularDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType> & _molecular_diffusion;
+        const AtmosphericMixture<CoeffType,VectorCoeffType,MatrixCoeffType>          & _mixture;
+
+        unsigned int _n_species;
+
+    //pair table, pair (i,j) at i * n_species + j
+        //! \f$D_{01}\f$ of the pair
+        std::vector<CoeffType> _D01;
+        //! index of the pair exponent in \p _betas
+        std::vector<unsigned int> _beta_index;
+        //! distinct exponents
+        std::vector<CoeffType> _betas;
+
+    //scratch
+        //! \f$D_{ij}n\f$ factor of each distinct exponent
+        mutable std::vector<CoeffType> _factors;
+        //! \f$\frac{1}{D_{ij}n}\f$
+        mutable MatrixType _W;
+        //! \f$B\f$
+        mutable MatrixType _B;
+        //! \f$B^{-1}\f$
+        mutable MatrixType _C;
+        //! factorization of \f$B\f$, storage kept from a point to the next
+        mutable Eigen::PartialPivLU<Eigen::Matrix<CoeffType,Eigen::Dynamic,Eigen::Dynamic> > _lu;
+        mutable RowType _CW;
+        mutable RowType _PW;
+
+        //! all the pairs, the exponents sorted
+        void build_pair_table();
+
+        //! builds and factorizes \f$B\f$, fills \f$B^{-1}\f$ and \f$\rho = \sum_j M_jn_j\f$, \return \f$\alpha\f$
+        template<typename StateType, typename VectorStateType>
+        CoeffType factorize(const VectorStateType &molar_concentrations, const StateType &T, StateType &rho) const;
+
+        //! coefficients from the factorization
+        template<typename StateType, typename VectorStateType, typename DtildeType>
+        void coefficients(const VectorStateType &molar_concentrations, const StateType &nTot, const CoeffType &alpha, DtildeType &Dtilde) const;
+
+        //! derivatives of the coefficient of \p s from the factorization
+        template<typename StateType, typename VectorStateType, typename RowStateType>
+        void derivatives(unsigned int s, const VectorStateType &molar_concentrations, const StateType &nTot, const StateType &rho,
+                         const CoeffType &alpha, const StateType &Dtilde, RowStateType &dDtilde_dn) const;
+
+     public:
+        //!
+        MulticomponentDiffusionEvaluator(const MolecularDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType> &mol_diff,
+                                         const AtmosphericMixture<CoeffType,VectorCoeffType,MatrixCoeffType> &comp);
+        //!
+        ~MulticomponentDiffusionEvaluator();
+
+        //! number of species
+        unsigned int n_species() const;
+
+        //! \f$D_{ij}\f$, any pair
+        template<typename StateType>
+        ANTIOCH_AUTO(StateType)
+        binary_coefficient(unsigned int i, unsigned int j, const StateType &T, const StateType &P) const
+        ANTIOCH_AUTOFUNC(StateType,_D01[i * _n_species + j] * Constants::Convention::P_normal<StateType>() / P *
+                                   Antioch::ant_pow(T/Constants::Convention::T_standard<StateType>(),_betas[_beta_index[i * _n_species + j]]))
+
+        //! Stefan-Maxwell coefficients
+        template<typename StateType, typename VectorStateType>
+        void Dtilde(const VectorStateType &molar_concentrations, const StateType &T,
+                    VectorStateType &Dtilde) const;
+
+        //! Stefan-Maxwell coefficients in \p workspace
+        template<typename StateType, typename VectorStateType>
+        void Dtilde(const VectorStateType &molar_concentrations, const StateType &T,
+                    DiffusionWorkspace<CoeffType> &workspace) const;
+
+        //! Stefan-Maxwell coefficients and all the derivatives with respect to concentrations
+        template<typename StateType, typename VectorStateType, typename MatrixStateType>
+        void Dtilde_and_derivs_dn(const VectorStateType &molar_concentrations, const StateType &T, const StateType &nTot,
+                                  VectorStateType &Dtilde, MatrixStateType &dD_dns) const;
+
+        //! Stefan-Maxwell coefficients and all the derivatives with respect to concentrations in \p workspace
+        template<typename StateType, typename VectorStateType>
+        void Dtilde_and_derivs_dn(const VectorStateType &molar_concentrations, const StateType &T, const StateType &nTot,
+                                  DiffusionWorkspace<CoeffType> &workspace) const;
+
+  };
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  MulticomponentDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::MulticomponentDiffusionEvaluator(
+                                         const MolecularDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType> &mol_diff,
+                                         const AtmosphericMixture<CoeffType,VectorCoeffType,MatrixCoeffType> &comp):
+      _molecular_diffusion(mol_diff),
+      _mixture(comp),
+      _n_species(comp.neutral_composition().n_species())
+  {
+     antioch_assert_greater(_n_species,1);
+     this->build_pair_table();
+
+     _factors.resize(_betas.size(),0);
+     _W.setZero(_n_species,_n_species);
+     _B.setZero(_n_species,_n_species);
+     _C.setZero(_n_species,_n_species);
+     _lu = Eigen::PartialPivLU<Eigen::Matrix<CoeffType,Eigen::Dynamic,Eigen::Dynamic> >(_n_species);
+     _CW.setZero(_n_species);
+     _PW.setZero(_n_species);
+
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  MulticomponentDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::~MulticomponentDiffusionEvaluator()
+  {
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  unsigned int MulticomponentDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::n_species() const
+  {
+     return _n_species;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  void MulticomponentDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::build_pair_table()
+  {
+    const unsigned int n_medium = _molecular_diffusion.n_medium();
+    std::vector<unsigned int> medium_index(_n_species,n_medium);
+    for(unsigned int m = 0; m < n_medium; m++)
+    {
+      medium_index[_molecular_diffusion.medium_species(m)] = m;
+    }
+
+    _D01.assign(_n_species * _n_species,0);
+    _beta_index.assign(_n_species * _n_species,0);
+    _betas.clear();
+
+    const unsigned int main_medium = _molecular_diffusion.medium_species(0);
+    const CoeffType one_over_M0 = CoeffType(1.L) / _mixture.neutral_composition().M(main_medium);
+    for(unsigned int i = 0; i < _n_species; i++)
+    {
+      for(unsigned int j = i + 1; j < _n_species; j++)
+      {
+        CoeffType D01, beta;
+        if(medium_index[i] < n_medium || medium_index[j] < n_medium)
+        {
+// the pair of the first medium species of the two
+          const bool i_first = (medium_index[i] < medium_index[j]);
+          const unsigned int m = i_first?medium_index[i]:medium_index[j];
+          const unsigned int s = i_first?j:i;
+          D01  = _molecular_diffusion.binary_D01(m,s);
+          beta = _molecular_diffusion.binary_beta(m,s);
+        }else
+        {
+// hard spheres, D ~ sqrt(1/Mi + 1/Mj) / sigma_ij^2
+          const CoeffType one_over_Mi = CoeffType(1.L) / _mixture.neutral_composition().M(i);
+          const CoeffType one_over_Mj = CoeffType(1.L) / _mixture.neutral_composition().M(j);
+          D01  = Antioch::ant_sqrt(_molecular_diffusion.binary_D01(0,i) * _molecular_diffusion.binary_D01(0,j)) *
+                 Antioch::ant_sqrt((one_over_Mi + one_over_Mj) /
+                                   Antioch::ant_sqrt((one_over_M0 + one_over_Mi) * (one_over_M0 + one_over_Mj)));
+          beta = (_molecular_diffusion.binary_beta(0,i) + _molecular_diffusion.binary_beta(0,j)) / CoeffType(2.L);
+        }
+
+        unsigned int b(0);
+        while(b < _betas.size() && _betas[b] != beta)b++;
+        if(b == _betas.size())_betas.push_back(beta);
+
+        _D01[i * _n_species + j] = D01;
+        _D01[j * _n_species + i] = D01;
+        _beta_index[i * _n_species + j] = b;
+        _beta_index[j * _n_species + i] = b;
+      }
+    }
+
+    return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template <typename StateType, typename VectorStateType>
+  inline
+  CoeffType MulticomponentDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::factorize(const VectorStateType &molar_concentrations,
+                                                                                                   const StateType &T, StateType &rho) const
+  {
+     antioch_assert_equal_to(molar_concentrations.size(),_n_species);
+
+// D_{ij} n = D01 * P_normal / (kb T) * (T / T_standard)^beta, m-3 -> cm-3
+     const StateType T_reduced = T / Constants::Convention::T_standard<StateType>();
+     const StateType nP_reduced = Constants::Convention::P_normal<StateType>() /
+                                  (Antioch::constant_clone(T,1e6) * Constants::Universal::kb<CoeffType>() * T);
+     for(unsigned int b = 0; b < _betas.size(); b++)
+     {
+        _factors[b] = nP_reduced * Antioch::ant_pow(T_reduced,_betas[b]);
+     }
+
+     Antioch::set_zero(rho);
+     for(unsigned int k = 0; k < _n_species; k++)
+     {
+        rho += molar_concentrations[k] * _mixture.neutral_composition().M(k);
+     }
+
+// M, the diagonal giving alpha
+     CoeffType alpha(0);
+     for(unsigned int i = 0; i < _n_species; i++)
+     {
+        CoeffType diag(0);
+        for(unsigned int j = 0; j < _n_species; j++)
+        {
+           if(j == i)continue;
+           _W(i,j) = Antioch::constant_clone(T,1) / (_D01[i * _n_species + j] * _factors[_beta_index[i * _n_species + j]]);
+           _B(i,j) = - molar_concentrations[j] * _W(i,j);
+           diag   -= _B(i,j);
+        }
+        _B(i,i) = diag;
+        if(diag > alpha)alpha = diag;
+     }
+     antioch_assert_greater(alpha,0);
+
+// B = M + alpha 1 y^T
+     for(unsigned int j = 0; j < _n_species; j++)
+     {
+        const CoeffType alpha_y = alpha * molar_concentrations[j] * _mixture.neutral_composition().M(j) / rho;
+        for(unsigned int i = 0; i < _n_species; i++)
+        {
+          _B(i,j) += alpha_y;
+        }
+     }
+
+     _lu.compute(_B);
+     _C.noalias() = _lu.inverse();
+
+     return alpha;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template <typename StateType, typename VectorStateType, typename DtildeType>
+  inline
+  void MulticomponentDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::coefficients(const VectorStateType &molar_concentrations,
+                                                                                                 const StateType &nTot, const CoeffType &alpha,
+                                                                                                 DtildeType &Dtilde) const
+  {
+// cm2.s-1
+     for(unsigned int s = 0; s < _n_species; s++)
+     {
+        const StateType x_s = molar_concentrations[s] / nTot;
+        Dtilde[s] = (_C(s,s) - x_s / alpha) / (Antioch::constant_clone(nTot,1) - x_s);
+     }
+
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template <typename StateType, typename VectorStateType, typename RowStateType>
+  inline
+  void MulticomponentDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::derivatives(unsigned int s,
+                                                                                                const VectorStateType &molar_concentrations,
+                                                                                                const StateType &nTot, const StateType &rho,
+                                                                                                const CoeffType &alpha, const StateType &Dtilde,
+                                                                                                RowStateType &dDtilde_dn) const
+  {
+// d(B^-1)_ss/dn_i = - sum_j C_sj W_ji (C_js - C_is) - M_i / rho (C_is - x_s / alpha)
+     _CW.noalias() = _C.row(s) * _W;
+     _PW.noalias() = _C.row(s).cwiseProduct(_C.col(s).transpose()) * _W;
+
+     const StateType x_s = molar_concentrations[s] / nTot;
+     const StateType one_over_nTot = Antioch::constant_clone(nTot,1) / nTot;
+     const StateType one_over_one_minus_xs = Antioch::constant_clone(nTot,1) / (Antioch::constant_clone(nTot,1) - x_s);
+     const StateType D_minus_one_over_alpha = Dtilde - Antioch::constant_clone(nTot,1) / alpha;
+
+     for(unsigned int i = 0; i < _n_species; i++)
+     {
+        const StateType dC_dn = - (_PW(i) - _C(i,s) * _CW(i))
+                                - _mixture.neutral_composition().M(i) / rho * (_C(i,s) - x_s / alpha);
+        const StateType dx_dn = ((i == s)?one_over_nTot - x_s * one_over_nTot:- x_s * one_over_nTot);
+        dDtilde_dn[i] = (dC_dn + D_minus_one_over_alpha * dx_dn) * one_over_one_minus_xs;
+     }
+
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template <typename StateType, typename VectorStateType>
+  inline
+  void MulticomponentDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::Dtilde(const VectorStateType &molar_concentrations,
+                                                                                           const StateType &T, VectorStateType &Dtilde) const
+  {
+     antioch_assert_equal_to(molar_concentrations.size(),_n_species);
+
+     Dtilde.resize(_n_species,0);
+     StateType nTot;
+     Antioch::set_zero(nTot);
+     for(unsigned int s = 0; s < _n_species; s++)
+     {
+        nTot += molar_concentrations[s];
+     }
+
+     StateType rho;
+     const CoeffType alpha = this->factorize(molar_concentrations,T,rho);
+     this->coefficients(molar_concentrations,nTot,alpha,Dtilde);
+
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template <typename StateType, typename VectorStateType>
+  inline
+  void MulticomponentDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::Dtilde(const VectorStateType &molar_concentrations,
+                                                                                           const StateType &T,
+                                                                                           DiffusionWorkspace<CoeffType> &workspace) const
+  {
+     antioch_assert_equal_to(molar_concentrations.size(),_n_species);
+     antioch_assert_equal_to(workspace.n_species(),_n_species);
+
+     StateType nTot;
+     Antioch::set_zero(nTot);
+     for(unsigned int s = 0; s < _n_species; s++)
+     {
+        nTot += molar_concentrations[s];
+     }
+
+     StateType rho;
+     const CoeffType alpha = this->factorize(molar_concentrations,T,rho);
+     CoeffType * Dtilde = workspace.Dtilde();
+     this->coefficients(molar_concentrations,nTot,alpha,Dtilde);
+
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template <typename StateType, typename VectorStateType, typename MatrixStateType>
+  inline
+  void MulticomponentDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::Dtilde_and_derivs_dn(const VectorStateType &molar_concentrations,
+                                                                                                         const StateType &T, const StateType &nTot,
+                                                                                                         VectorStateType &Dtilde, MatrixStateType &dD_dns) const
+  {
+     antioch_assert_equal_to(molar_concentrations.size(),_n_species);
+     antioch_assert_equal_to(Dtilde.size(),_n_species);
+     antioch_assert_equal_to(dD_dns.size(),_n_species);
+
+     StateType rho;
+     const CoeffType alpha = this->factorize(molar_concentrations,T,rho);
+     this->coefficients(molar_concentrations,nTot,alpha,Dtilde);
+
+     for(unsigned int s = 0; s < _n_species; s++)
+     {
+        antioch_assert_equal_to(dD_dns[s].size(),_n_species);
+        this->derivatives(s,molar_concentrations,nTot,rho,alpha,Dtilde[s],dD_dns[s]);
+     }
+
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template <typename StateType, typename VectorStateType>
+  inline
+  void MulticomponentDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::Dtilde_and_derivs_dn(const VectorStateType &molar_concentrations,
+                                                                                                         const StateType &T, const StateType &nTot,
+                                                                                                         DiffusionWorkspace<CoeffType> &workspace) const
+  {
+     antioch_assert_equal_to(molar_concentrations.size(),_n_species);
+     antioch_assert_equal_to(workspace.n_species(),_n_species);
+
+     StateType rho;
+     const CoeffType alpha = this->factorize(molar_concentrations,T,rho);
+     CoeffType * Dtilde = workspace.Dtilde();
+     this->coefficients(molar_concentrations,nTot,alpha,Dtilde);
+
+     for(unsigned int s = 0; s < _n_species; s++)
+     {
+        CoeffType * dD_dn = workspace.dDtilde_dn(s);
+        this->derivatives(s,molar_concentrations,nTot,rho,alpha,StateType(Dtilde[s]),dD_dn);
+     }
+
+     return;
+  }
+
+}
+
+#endif
@@ -45,6 +45,7 @@
 #include "libmesh/fem_system.h"
 #include "libmesh/string_to_enum.h"
 #include "libmesh/quadrature.h"
+#include "libmesh/threads.h"
 
 namespace Planet
 {
@@ -103,6 +104,36 @@ namespace Planet
 
     PlanetPhysics();
 
+    //! evaluator from the pool, created if none is free
+    PlanetPhysicsEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType> * acquire_evaluator();
+
+    //! gives back the evaluator to the pool
+    void release_evaluator(PlanetPhysicsEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType> * evaluator);
+
+    //! evaluator taken from the pool for a scope, given back when leaving it, exception or not
+    class EvaluatorLease
+    {
+    public:
+      EvaluatorLease(PlanetPhysics<CoeffType,VectorCoeffType,MatrixCoeffType> & physics);
+      ~EvaluatorLease();
+
+      PlanetPhysicsEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType> & evaluator();
+
+    private:
+      EvaluatorLease();
+      EvaluatorLease(const EvaluatorLease &);
+      EvaluatorLease & operator=(const EvaluatorLease &);
+
+      PlanetPhysics<CoeffType,VectorCoeffType,MatrixCoeffType>          & _physics;
+      PlanetPhysicsEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType> * _evaluator;
+    };
+
+    /*! free evaluators, they live as long as the physics so that
+        their stored rate constants and warm starts are kept from
+        one element (and one assembly) to the other, one per thread at most */
+    std::vector<PlanetPhysicsEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType> *> _evaluators;
+    libMesh::Threads::spin_mutex                                                    _evaluators_mutex;
+
   };
 
   template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
@@ -135,9 +166,59 @@ namespace Planet
   template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
   PlanetPhysics<CoeffType,VectorCoeffType,MatrixCoeffType>::~PlanetPhysics()
   {
+    for(unsigned int e = 0; e < _evaluators.size(); e++)
+      {
+        delete _evaluators[e];
+      }
+    return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  PlanetPhysicsEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType> * PlanetPhysics<CoeffType,VectorCoeffType,MatrixCoeffType>::acquire_evaluator()
+  {
+    {
+      libMesh::Threads::spin_mutex::scoped_lock lock(_evaluators_mutex);
+      if(!_evaluators.empty())
+        {
+          PlanetPhysicsEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType> * evaluator = _evaluators.back();
+          _evaluators.pop_back();
+          return evaluator;
+        }
+    }
+
+    return new PlanetPhysicsEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>(_helper);
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  void PlanetPhysics<CoeffType,VectorCoeffType,MatrixCoeffType>::release_evaluator(PlanetPhysicsEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType> * evaluator)
+  {
+    libMesh::Threads::spin_mutex::scoped_lock lock(_evaluators_mutex);
+    _evaluators.push_back(evaluator);
+
+    return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  PlanetPhysics<CoeffType,VectorCoeffType,MatrixCoeffType>::EvaluatorLease::EvaluatorLease(PlanetPhysics<CoeffType,VectorCoeffType,MatrixCoeffType> & physics)
+    : _physics(physics),
+      _evaluator(physics.acquire_evaluator())
+  {
+    return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  PlanetPhysics<CoeffType,VectorCoeffType,MatrixCoeffType>::EvaluatorLease::~EvaluatorLease()
+  {
+    _physics.release_evaluator(_evaluator);
     return;
   }
 
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  PlanetPhysicsEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType> & PlanetPhysics<CoeffType,VectorCoeffType,MatrixCoeffType>::EvaluatorLease::evaluator()
+  {
+    return *_evaluator;
+  }
+
   template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
   void PlanetPhysics<CoeffType,VectorCoeffType,MatrixCoeffType>::init_variables( libMesh::FEMSystem* system )
   {
@@ -199,9 +280,14 @@ namespace Planet
     const std::vector<libMesh::Point>& s_qpoint = 
       context.get_element_fe(var)->get_xyz();
 
-    // We shouldn't have to create this for every element and put it in a context,
-    // but just getting this going for now.
-    PlanetPhysicsEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType> evaluator(_helper);
+    // taken from the pool, the rate constants stored by altitude
+    // and the ionospheric warm starts survive the element
+    EvaluatorLease lease(*this);
+    PlanetPhysicsEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType> & evaluator = lease.evaluator();
+
+    // sparse pattern of the chemical jacobian
+    const std::vector<unsigned int> & chem_row_ptr = evaluator.chemical_jacobian_row_ptr();
+    const std::vector<unsigned int> & chem_cols    = evaluator.chemical_jacobian_cols();
 
 //    std::cout << "Element #" << context.get_elem().id() << std::endl;
     for (unsigned int qp=0; qp != n_qpoints; qp++)
@@ -246,21 +332,33 @@ namespace Planet
                 if( compute_jacobian )
                   {
 
+                    // chemistry, only the (s,t) blocks of the sparse pattern
+                    for(unsigned int k = chem_row_ptr[s]; k < chem_row_ptr[s + 1]; k++ )
+                      {
+                        libMesh::DenseSubMatrix<libMesh::Number> &J =
+                          context.get_elem_jacobian(this->_species_vars[s], this->_species_vars[chem_cols[k]]); // R_{s},{t}
+
+                        libMesh::Real domega_dot_dns = evaluator.dchemical_term_dn(k);
+
+                        for(unsigned int j=0; j != n_s_dofs; j++)
+                          {
+                            J(i,j) += jac * domega_dot_dns * s_phi[i][qp] * s_phi[j][qp];
+                          }
+                      }
+
+                    // diffusion, every species through the total density
                     for(unsigned int t=0; t < this->_n_species; t++ )
                       {
                         libMesh::DenseSubMatrix<libMesh::Number> &J =
                           context.get_elem_jacobian(this->_species_vars[s], this->_species_vars[t]); // R_{s},{t}
 
-                        libMesh::Real domega_dot_dns = evaluator.dchemical_term_dn_i(s,t);
-
                         libMesh::Real domega_B_term_dns = evaluator.ddiffusion_B_term_dn(s,t);
 
                         libMesh::Real domega_A_term_dns = evaluator.ddiffusion_A_term_dn(s,t);
 
                         for(unsigned int j=0; j != n_s_dofs; j++)
                           {
-                            J(i,j) += jac*( domega_dot_dns * s_phi[i][qp] * s_phi[j][qp]
-                                            + n_s * domega_B_term_dns * s_grad_phi[i][qp](0) * s_phi[j][qp]
+                            J(i,j) += jac*( n_s * domega_B_term_dns * s_grad_phi[i][qp](0) * s_phi[j][qp]
                                             + dns_dz * domega_A_term_dns * s_grad_phi[i][qp](0) * s_phi[j][qp] 
                                           );
                           }
@@ -282,7 +380,7 @@ namespace Planet
           }
 
       }
-    
+
     return;
   }
 
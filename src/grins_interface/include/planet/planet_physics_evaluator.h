@@ -53,9 +53,18 @@ namespace Planet
     //! 
     libMesh::Real ddiffusion_B_term_dn(unsigned int s, unsigned int i) const;
 
-    //! domega_dot_s_dn_i
+    //! domega_dot_s_dn_i, zero out of the sparse pattern
     libMesh::Real dchemical_term_dn_i(unsigned int s, unsigned int i)  const;
 
+    //! k-th stored value of the chemical jacobian, see chemical_jacobian_row_ptr() and chemical_jacobian_cols()
+    libMesh::Real dchemical_term_dn(unsigned int k)  const;
+
+    //!\return row pointer of the sparse chemical jacobian (CSR)
+    const std::vector<unsigned int> & chemical_jacobian_row_ptr() const;
+
+    //!\return columns of the sparse chemical jacobian (CSR)
+    const std::vector<unsigned int> & chemical_jacobian_cols() const;
+
     //!
     const CoeffType scaling_factor() const;
 
@@ -97,6 +106,7 @@ namespace Planet
     PhotonEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType> _photon;
 
     MolecularDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType> _molecular_diffusion;
+    MulticomponentDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType> _multicomponent_diffusion;
     EddyDiffusionEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>      _eddy_diffusion;
 
     AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType> _kinetics;
@@ -108,7 +118,8 @@ namespace Planet
 
     MatrixCoeffType _domegas_dn_A_TERM;
     MatrixCoeffType _domegas_dn_B_TERM;
-    MatrixCoeffType _domegas_dots_dn;
+    // sparse, in the pattern of the kinetics
+    VectorCoeffType _domegas_dots_dn;
 
     MatrixCoeffType _cache_composition;
     VectorCoeffType _cache_altitudes;
@@ -137,8 +148,9 @@ namespace Planet
       _index_hv(helper.index_photochemistry()),
       _photon(helper.phy_at_top(),helper.tau(),_composition),
       _molecular_diffusion(helper.bin_diff_coeff(),_composition,helper.temperature(),helper.medium()),
+      _multicomponent_diffusion(_molecular_diffusion,_composition),
       _eddy_diffusion(_composition,helper.K0()),
-      _kinetics(_neutral_kinetics,_ionic_kinetics,helper.temperature(),_photon,_composition, helper.ss_species()),
+      _kinetics(_neutral_kinetics,_ionic_kinetics,helper.temperature(),_photon,_composition, helper.ionic_mechanism()),
       _diffusion(_molecular_diffusion,_eddy_diffusion,_composition,helper.temperature()),
       _scaling_factor(helper.scaling_factor())
   {
@@ -146,12 +158,10 @@ namespace Planet
     _omegas_B_term.resize(_kinetics.neutral_kinetics().n_species(),0);
     _omegas_dots.resize(_kinetics.neutral_kinetics().n_species(),0);
 
-    _domegas_dots_dn.resize(_kinetics.neutral_kinetics().n_species());
     _domegas_dn_A_TERM.resize(_kinetics.neutral_kinetics().n_species());
     _domegas_dn_B_TERM.resize(_kinetics.neutral_kinetics().n_species());
     for(unsigned int s = 0; s < _kinetics.neutral_kinetics().n_species(); s++)
     {
-      _domegas_dots_dn[s].resize(_kinetics.neutral_kinetics().n_species(),0);
       _domegas_dn_A_TERM[s].resize(_kinetics.neutral_kinetics().n_species(),0);
       _domegas_dn_B_TERM[s].resize(_kinetics.neutral_kinetics().n_species(),0);
     }
@@ -159,6 +169,19 @@ namespace Planet
     // calculate photon flux
     phy_at_z.set_abscissa(_photon.photon_flux_at_top().abscissa());
 
+    // photolysis by the J-value engine
+    if(helper.photolysis())_kinetics.set_photolysis(*helper.photolysis());
+
+    // Stefan-Maxwell diffusion
+    if(helper.multicomponent_diffusion())_diffusion.set_multicomponent_diffusion(_multicomponent_diffusion);
+
+    // bounded caches by altitude
+    _kinetics.set_altitude_store_size(helper.altitude_store_size());
+    _diffusion.set_altitude_store_size(helper.altitude_store_size());
+
+    // pattern known once the photolysis is set
+    _domegas_dots_dn.resize(_kinetics.chemical_jacobian_non_zeros(),0);
+
     return;
   }
 
@@ -186,15 +209,28 @@ namespace Planet
    Antioch::set_zero(_omegas_dots);
    Antioch::set_zero(_domegas_dots_dn);
 
-// calculate phy
+   StateType T = _temperature.neutral_temperature(z);
+   Antioch::KineticsConditions<StateType> KC(T);
+
+   if(_kinetics.photolysis_engine())
+   {
+// diff and chem, photolysis rates by the J-value engine
+// the column densities are lagged in the cache, the photon flux
+// depends on the local densities through a(n) only
+     _diffusion.diffusion_and_derivs(molar,z,_omegas_A_term,_omegas_B_term,_domegas_dn_A_TERM,_domegas_dn_B_TERM);
+     _kinetics.chemical_rate_and_sparse_derivs(molar,this->get_cache(z),KC,z,_omegas_dots,_domegas_dots_dn);
+
+     return;
+   }
+
+// calculate phy, photolysis by Antioch: the flux is frozen in the
+// jacobian, its dependence on the densities needs the J-value engine
    VectorStateType phy;
    phy.resize(_photon.photon_flux_at_top().abscissa().size());
 
    _photon.update_photon_flux(molar,this->get_cache(z),z,phy);
 
    phy_at_z.set_flux(phy);
-   StateType T = _temperature.neutral_temperature(z);
-   Antioch::KineticsConditions<StateType> KC(T);
 
    for(unsigned int hv = 0; hv < _index_hv.size(); hv++)
    {
@@ -203,7 +239,7 @@ namespace Planet
 
 // diff and chem
    _diffusion.diffusion_and_derivs(molar,z,_omegas_A_term,_omegas_B_term,_domegas_dn_A_TERM,_domegas_dn_B_TERM);
-   _kinetics.chemical_rate_and_derivs(molar,KC,z,_omegas_dots,_domegas_dots_dn);
+   _kinetics.chemical_rate_and_sparse_derivs(molar,KC,z,_omegas_dots,_domegas_dots_dn);
 
     return;
   }
@@ -301,7 +337,28 @@ namespace Planet
   template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
   libMesh::Real PlanetPhysicsEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::dchemical_term_dn_i(unsigned int s, unsigned int i)  const
   {
-    return _domegas_dots_dn[s][i];
+    const std::vector<unsigned int> & row_ptr = _kinetics.chemical_jacobian_row_ptr();
+    const std::vector<unsigned int> & cols    = _kinetics.chemical_jacobian_cols();
+    std::vector<unsigned int>::const_iterator col = std::lower_bound(cols.begin() + row_ptr[s], cols.begin() + row_ptr[s + 1], i);
+    return (col != cols.begin() + row_ptr[s + 1] && *col == i)?_domegas_dots_dn[col - cols.begin()]:0.;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  libMesh::Real PlanetPhysicsEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::dchemical_term_dn(unsigned int k)  const
+  {
+    return _domegas_dots_dn[k];
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  const std::vector<unsigned int> & PlanetPhysicsEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::chemical_jacobian_row_ptr() const
+  {
+    return _kinetics.chemical_jacobian_row_ptr();
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  const std::vector<unsigned int> & PlanetPhysicsEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::chemical_jacobian_cols() const
+  {
+    return _kinetics.chemical_jacobian_cols();
   }
 
   template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
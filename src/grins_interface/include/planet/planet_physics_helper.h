@@ -36,6 +36,8 @@
 
 //Planet
 #include "planet/diffusion_evaluator.h"
+#include "planet/cross_section_database.h"
+#include "planet/spectral_grid_coarsener.h"
 #include "planet/atmospheric_kinetics.h"
 #include "planet/kinetics_branching_structure.h"
 #include "planet/branching_ratio_node.h"
@@ -113,14 +115,32 @@ namespace Planet
 
     const std::vector<std::string>& medium() const;
 
+    //!\return species whose cross-sections make the opacity
+    const std::vector<std::string>& absorbing_species() const;
+
+    //!\return species whose photolysis is read
+    const std::vector<std::string>& photo_reacting_species() const;
+
     CoeffType K0() const;
 
+    //!\return true if the molecular diffusion is the full Stefan-Maxwell one
+    bool multicomponent_diffusion() const;
+
+    //!\return number of altitudes kept by the caches of an evaluator
+    unsigned int altitude_store_size() const;
+
     CoeffType scaling_factor() const;
 
     const std::vector<Antioch::Species> & ss_species() const;
 
+    //! ionospheric steady state mechanism, shared by all the evaluators
+    const SteadyStateMechanism<CoeffType> & ionic_mechanism() const;
+
     const std::vector<unsigned int> & index_photochemistry() const;
 
+    //!\return J-value engine, NULL if photolysis is left to Antioch
+    const PhotolysisEvaluator<CoeffType,VectorCoeffType>* photolysis() const;
+
   private:
 
     AtmosphericMixture<CoeffType,VectorCoeffType,MatrixCoeffType>*  _composition; //for first guess
@@ -136,6 +156,7 @@ namespace Planet
 // chemistry
     Antioch::ReactionSet<CoeffType>* _neutral_reaction_set;
     Antioch::ReactionSet<CoeffType>* _ionic_reaction_set;
+    SteadyStateMechanism<CoeffType>* _ionic_mechanism;
 
 // photons related
     std::vector<unsigned int> _index_photochemistry;
@@ -146,8 +167,13 @@ namespace Planet
 
     std::vector<CrossSection<VectorCoeffType> > _hv_cross_section;
 
+    //! binary tables replacing the text files, if given
+    CrossSectionDatabase _cross_section_db;
+
     PhotonOpacity<CoeffType,VectorCoeffType>* _tau;
 
+    PhotolysisEvaluator<CoeffType,VectorCoeffType>* _photolysis;
+
 //diffusion
 //  molecular
 
@@ -156,6 +182,13 @@ namespace Planet
     std::vector<std::string>      _medium;
     std::vector<Antioch::Species> _ss_species;
 
+    std::vector<std::string>      _absorbing_species;
+    std::vector<std::string>      _photo_reacting_species;
+
+    bool _multicomponent_diffusion;
+
+    unsigned int _altitude_store_size;
+
 //  eddy
     CoeffType _K0;
 
@@ -189,6 +222,11 @@ namespace Planet
                           std::vector<std::vector<DiffusionType> >& bin_diff_model,
                           const std::vector<std::string>& neutrals);
 
+    /*! Opt-in coarsening of the spectral grid within tolerances on J and tau,
+        the reference profile is the first guess. J are the rates of the J-value
+        engine, or of the Antioch photochemical reactions without it */
+    void build_spectral_grid( const GetPot& input );
+
     // read conc_s(z) from a file
     void parse_first_guess(const std::string & file);
 
@@ -214,6 +252,9 @@ namespace Planet
                           const std::string& file_flyby,
                           const std::string& root_input) const;
 
+    //!\return true if \p file is in the cross-section database, warns if a database is loaded without it
+    bool from_cross_section_database( const std::string &file ) const;
+
     void read_cross_section( const std::string &file,
                             VectorCoeffType &lambda, VectorCoeffType &sigma ) const;
 
@@ -237,8 +278,10 @@ namespace Planet
 
     void condense_molecule(std::vector<unsigned int> &stoi, std::vector<std::string> &mol) const;
 
+    //! photolysis channels go to the J-value engine if \p photolysis is not NULL
     void read_photochemistry_reac(const std::string &hv_file, const std::string &reac,
-                                  Antioch::ReactionSet<CoeffType> &neutral_reaction_set) const;
+                                  Antioch::ReactionSet<CoeffType> &neutral_reaction_set,
+                                  PhotolysisEvaluator<CoeffType,VectorCoeffType> *photolysis = NULL) const;
 
     void shave_string(std::string &str) const;
 
@@ -258,8 +301,12 @@ namespace Planet
       _ionic_species(NULL),
       _neutral_reaction_set(NULL),
       _ionic_reaction_set(NULL),
+      _ionic_mechanism(NULL),
       _chapman(NULL),
       _tau(NULL),
+      _photolysis(NULL),
+      _multicomponent_diffusion(false),
+      _altitude_store_size(AltitudeStore<CoeffType,VectorCoeffType>::default_capacity()),
       _scaling_factor(-1),
       _explicit_first_guess(false)
   {
@@ -273,14 +320,19 @@ namespace Planet
              _index_photochemistry.push_back(ih);
     }
 
+    // ionospheric topology and jacobian pattern, built once for all the evaluators
+    _ionic_mechanism = new SteadyStateMechanism<CoeffType>(_ss_species,*_ionic_reaction_set);
+
     return;
   }
 
   template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
   PlanetPhysicsHelper<CoeffType,VectorCoeffType,MatrixCoeffType>::~PlanetPhysicsHelper()
   {
+    delete _photolysis;
     delete _tau;
     delete _chapman;
+    delete _ionic_mechanism;
     delete _ionic_reaction_set;
     delete _neutral_reaction_set;
     delete _ionic_species;
@@ -362,6 +414,10 @@ namespace Planet
     if(input.have_variable("Planet/scale_factor") )
        _scaling_factor = input("Planet/scale_factor", -1);
 
+    // binary cross-sections, solar flux and photolysis tables
+    if(input.have_variable("Planet/cross_section_database") )
+       _cross_section_db.load(input("Planet/cross_section_database", "DIE!"));
+
 
     // Parse medium
     if( !input.have_variable("Planet/medium") )
@@ -376,6 +432,18 @@ namespace Planet
         _medium[s] = input("Planet/medium", "DIE!", s);
       }
 
+    // Stefan-Maxwell instead of Wilke
+    _multicomponent_diffusion = input("Planet/multicomponent_diffusion", false);
+
+    // rate constants, warm starts and diffusion terms stored by altitude, least recently used dropped
+    const int altitude_store_size = input("Planet/altitude_store_size", static_cast<int>(_altitude_store_size));
+    if(altitude_store_size <= 0)
+      {
+        std::cerr << "Error: altitude_store_size must be positive" << std::endl;
+        antioch_error();
+      }
+    _altitude_store_size = altitude_store_size;
+
     // Parse neutrals, ions
     std::vector<std::string> neutrals;
     std::vector<std::string> ions;
@@ -448,6 +516,12 @@ namespace Planet
         this->parse_first_guess(input("Planet/first_guess","DIE!"));
     }
 
+    // Must be called after: build_opacity, build_reaction_sets, build_composition
+    if( input.have_variable("Planet/spectral_grid_tolerance") )
+    {
+        this->build_spectral_grid(input);
+    }
+
     return;
   }
 
@@ -573,12 +647,13 @@ namespace Planet
          std::cerr << "Unknown species \"" << species << "\".  Forgot to add it to the neutral_species entry?" << std::endl;
          antioch_error();
       }
+      _absorbing_species.push_back(species);
 
       std::vector<CoeffType> lambda, sigma;
 
       this->read_cross_section(abs_file[s], lambda, sigma); //cm2.angstrom-1
 
-      _tau->add_cross_section( lambda, sigma, _neutral_species->species_name_map().at(species),          // Antioch::Species
+      _tau->add_cross_section( std::move(lambda), std::move(sigma), _neutral_species->species_name_map().at(species), // Antioch::Species
                                               _neutral_species->species_name_map().at(species) ); // id
 
     }
@@ -633,7 +708,12 @@ namespace Planet
 
     this->fill_neutral_reactions_falloff(input_reactions_fall, *_neutral_reaction_set, Tref);
 
-    //now the photochemical ones
+    //now the photochemical ones, in Antioch or in the J-value engine
+    if( input("Planet/photolysis_engine", false) )
+      {
+        _photolysis = new PhotolysisEvaluator<CoeffType,VectorCoeffType>();
+      }
+
     unsigned int n_hv_reacting = input.vector_variable_size("Planet/photo_reacting_species");
 
     std::vector<std::string> hv_file(n_hv_reacting);
@@ -654,10 +734,14 @@ namespace Planet
          antioch_error();
       }
 
-      this->read_photochemistry_reac(hv_file[s], species, *_neutral_reaction_set);
+      _photo_reacting_species.push_back(species);
+      this->read_photochemistry_reac(hv_file[s], species, *_neutral_reaction_set, _photolysis);
 
     }
 
+    // must be called after build_opacity
+    if(_photolysis)_photolysis->update_cross_section(_phy1AU.abscissa());
+
     if( input.have_variable("Planet/input_ions_reactions") )
       {
         std::string file_ions_reac = input( "Planet/input_ions_reactions", "DIE!" );
@@ -698,6 +782,64 @@ namespace Planet
     return;
   }
 
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  void PlanetPhysicsHelper<CoeffType,VectorCoeffType,MatrixCoeffType>::build_spectral_grid( const GetPot& input )
+  {
+    CoeffType j_tolerance   = input("Planet/spectral_grid_tolerance", 0.0 );
+    CoeffType tau_tolerance = input("Planet/spectral_grid_tau_tolerance", j_tolerance );
+    unsigned int n_ref      = input("Planet/spectral_grid_reference_points", 20 );
+
+    if(j_tolerance <= 0. || n_ref < 2)
+      {
+        std::cerr << "Error: spectral grid tolerance must be positive with at least 2 reference points" << std::endl;
+        antioch_error();
+      }
+
+    SpectralGridCoarsener<CoeffType,VectorCoeffType> coarsener(j_tolerance,tau_tolerance);
+
+    CoeffType zmin = input("Planet/zmin", 0.0 );
+    CoeffType zmax = input("Planet/zmax", 0.0 );
+    VectorCoeffType dens(_neutral_species->n_species(),0.L);
+    VectorCoeffType sum_dens(_neutral_species->n_species(),0.L);
+    for(unsigned int p = 0; p < n_ref; p++)
+      {
+        CoeffType z = zmin + (zmax - zmin) * CoeffType(p) / CoeffType(n_ref - 1);
+        _composition->first_guess_densities(z,dens);
+        _composition->first_guess_densities_sum(z,sum_dens);
+        coarsener.add_reference_point(sum_dens,_tau->chapman_factor(_composition->a(dens,z)));
+      }
+
+    const unsigned int n_fine = _phy1AU.abscissa().size();
+
+    // without the J-value engine, the Antioch photochemical reactions are checked
+    // through their cross-sections in an evaluator used for the check only
+    PhotolysisEvaluator<CoeffType,VectorCoeffType> antioch_photolysis;
+    const PhotolysisEvaluator<CoeffType,VectorCoeffType> * j_check = _photolysis;
+    if(!_photolysis)
+      {
+        for(unsigned int s = 0; s < _photo_reacting_species.size(); s++)
+          {
+            const std::string & species = _photo_reacting_species[s];
+            std::string hv_file = std::string(input("Planet/input_photoreactions_root","DIE!")) + species;
+            this->read_photochemistry_reac(hv_file, species, *_neutral_reaction_set, &antioch_photolysis);
+          }
+        antioch_photolysis.update_cross_section(_phy1AU.abscissa());
+        j_check = &antioch_photolysis;
+      }
+
+    coarsener.build(_phy1AU.abscissa(),_phy_at_top.flux(),*_tau,j_check);
+    coarsener.apply(*_tau,_photolysis);
+    coarsener.coarsen_flux(_phy1AU);
+    coarsener.coarsen_flux(_phy_at_top);
+
+    if(libMesh::global_processor_id() == 0)
+      std::cout << "Spectral grid coarsened from " << n_fine
+                << " to " << coarsener.coarse_grid().size() << " nodes, errors J "
+                << coarsener.j_error() << " and tau " << coarsener.tau_error() << std::endl;
+
+    return;
+  }
+
   template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
   void PlanetPhysicsHelper<CoeffType,VectorCoeffType,MatrixCoeffType>::build_diffusion( std::vector<std::vector<std::vector<CoeffType> > >& bin_diff_data,
                                                                                         std::vector<std::vector<DiffusionType> >& bin_diff_model,
@@ -1431,10 +1573,28 @@ namespace Planet
     flyby.close();
   }
 
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  bool PlanetPhysicsHelper<CoeffType,VectorCoeffType,MatrixCoeffType>::from_cross_section_database( const std::string &file ) const
+  {
+    if(_cross_section_db.has_table(file))return true;
+
+    if(_cross_section_db.loaded() && libMesh::global_processor_id() == 0)
+      std::cerr << "Warning: " << file << " is not in the cross-section database, parsing the text file" << std::endl;
+
+    return false;
+  }
+
   template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
   void PlanetPhysicsHelper<CoeffType,VectorCoeffType,MatrixCoeffType>::read_cross_section( const std::string &file,
                             VectorCoeffType &lambda, VectorCoeffType &sigma ) const
   {
+    if(this->from_cross_section_database(file))
+      {
+        _cross_section_db.column(file,0,lambda);//A
+        _cross_section_db.column(file,1,sigma); //cm-2/A
+        return;
+      }
+
     std::string line;
     std::ifstream sig_f(file);
     if( !sig_f)
@@ -1461,26 +1621,33 @@ namespace Planet
                                                                                     Antioch::ParticleFlux<VectorCoeffType> &phy_at_top, 
                                                                                     const std::string &file) const
   {
-    std::string line;
-    std::ifstream flux_1AU(file);
-    if( !flux_1AU)
-      {
-        std::cerr << "Could not open file " << file << std::endl;
-        antioch_error();
-      }
-    getline(flux_1AU,line);
     VectorCoeffType lambda,flux;
-//TODO unit management !! use SwRI only
-    while(!flux_1AU.eof())
+    if(this->from_cross_section_database(file))
       {
-        CoeffType wv(-1),ir(-1),dirr(-1);
-        flux_1AU >> wv >> ir >> dirr;
-        if(!flux_1AU.good())break;
-        lambda.push_back(wv);// * 10.L);//nm -> A
-        flux.push_back(ir);/* * 1e3L * (wv*1e-9L) / (Antioch::Constants::Planck_constant<CoeffType>() *
-                                                   Antioch::Constants::light_celerity<CoeffType>()));//W/m2/nm -> J/s/cm2/A -> s-1/cm-2/A*/
+        _cross_section_db.column(file,0,lambda);
+        _cross_section_db.column(file,1,flux);
+      }else
+      {
+        std::string line;
+        std::ifstream flux_1AU(file);
+        if( !flux_1AU)
+          {
+            std::cerr << "Could not open file " << file << std::endl;
+            antioch_error();
+          }
+        getline(flux_1AU,line);
+//TODO unit management !! use SwRI only
+        while(!flux_1AU.eof())
+          {
+            CoeffType wv(-1),ir(-1),dirr(-1);
+            flux_1AU >> wv >> ir >> dirr;
+            if(!flux_1AU.good())break;
+            lambda.push_back(wv);// * 10.L);//nm -> A
+            flux.push_back(ir);/* * 1e3L * (wv*1e-9L) / (Antioch::Constants::Planck_constant<CoeffType>() *
+                                                       Antioch::Constants::light_celerity<CoeffType>()));//W/m2/nm -> J/s/cm2/A -> s-1/cm-2/A*/
+          }
+        flux_1AU.close();
       }
-    flux_1AU.close();
 
 //if in reverse order
     if(lambda.back() < lambda.front())
@@ -1716,16 +1883,25 @@ namespace Planet
 
   template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
   void PlanetPhysicsHelper<CoeffType,VectorCoeffType,MatrixCoeffType>::read_photochemistry_reac(const std::string &hv_file, const std::string &reac,
-                                                                                                Antioch::ReactionSet<CoeffType> &neutral_reaction_set) const
+                                                                                                Antioch::ReactionSet<CoeffType> &neutral_reaction_set,
+                                                                                                PhotolysisEvaluator<CoeffType,VectorCoeffType> *photolysis) const
   {
     Antioch::KineticsModel::KineticsModel kineticsModel(Antioch::KineticsModel::PHOTOCHEM);
     Antioch::ReactionType::ReactionType reactionType(Antioch::ReactionType::ELEMENTARY);
 
     const Antioch::ChemicalMixture<CoeffType>& chem_mixture = neutral_reaction_set.chemical_mixture();
 
-    std::ifstream data(hv_file.c_str());
+    const bool from_db = this->from_cross_section_database(hv_file);
+    std::ifstream data;
     std::string line;
-    getline(data,line);
+    if(from_db)
+      {
+        line = _cross_section_db.header(hv_file);
+      }else
+      {
+        data.open(hv_file.c_str());
+        getline(data,line);
+      }
     std::vector<std::string> out;
     Antioch::SplitString(line," ",out,false);
     unsigned int nbr = out.size();
@@ -1763,7 +1939,17 @@ namespace Planet
       }
 
     datas.resize(nbr - 1);
-    while(!data.eof())
+    if(from_db)
+      {
+        if(_cross_section_db.n_columns(hv_file) < nbr)
+          {
+            std::cerr << "Error: " << hv_file << " in the cross-section database has less columns than branches" << std::endl;
+            antioch_error();
+          }
+        _cross_section_db.column(hv_file,0,datas[0]);
+        for(unsigned int ibr = 0; ibr < nbr - 2; ibr++)_cross_section_db.column(hv_file,ibr + 2,datas[ibr + 1]);
+      }
+    while(!from_db && !data.eof())
       {
         CoeffType lambda(-1), total(-1);
         VectorCoeffType sigmas;
@@ -1785,6 +1971,31 @@ namespace Planet
             for(unsigned int i = 0; i < stoi_prod[ibr][ip]; i++)equation += produc[ibr][ip] + " + ";
           }
         equation.erase(equation.size() - 3, 3);
+
+        if(photolysis) // J-value engine, not an Antioch reaction
+          {
+            int istep(1);
+            int start(0);
+            if(datas[0].back() < datas[0].front())
+            {
+               istep = -1;
+               start = datas[0].size() - 1;
+            }
+            VectorCoeffType lambda,cs;
+            for(int i = start; i < (int)datas[0].size() && i > -1; i += istep)
+            {
+               lambda.push_back(datas[0][i]);
+               cs.push_back(datas[ibr + 1][i]);
+            }
+            std::vector<unsigned int> products(produc[ibr].size());
+            for(unsigned int ip = 0; ip < produc[ibr].size(); ip++)
+              {
+                products[ip] = chem_mixture.species_name_map().find(produc[ibr][ip])->second;
+              }
+            photolysis->add_photolysis(equation, lambda, cs, chem_mixture.species_name_map().find(reac)->second, products, stoi_prod[ibr]);
+            continue;
+          }
+
         Antioch::Reaction<CoeffType> * reaction = Antioch::build_reaction<CoeffType>(chem_mixture.n_species(), equation, false, reactionType, kineticsModel);
 
         reaction->add_reactant( reac,chem_mixture.species_name_map().find(reac)->second,1);
@@ -2043,12 +2254,36 @@ namespace Planet
     return _medium;
   }
 
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  const std::vector<std::string>& PlanetPhysicsHelper<CoeffType,VectorCoeffType,MatrixCoeffType>::absorbing_species() const
+  {
+    return _absorbing_species;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  const std::vector<std::string>& PlanetPhysicsHelper<CoeffType,VectorCoeffType,MatrixCoeffType>::photo_reacting_species() const
+  {
+    return _photo_reacting_species;
+  }
+
   template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
   CoeffType PlanetPhysicsHelper<CoeffType,VectorCoeffType,MatrixCoeffType>::K0() const
   {
     return _K0;
   }
 
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  bool PlanetPhysicsHelper<CoeffType,VectorCoeffType,MatrixCoeffType>::multicomponent_diffusion() const
+  {
+    return _multicomponent_diffusion;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  unsigned int PlanetPhysicsHelper<CoeffType,VectorCoeffType,MatrixCoeffType>::altitude_store_size() const
+  {
+    return _altitude_store_size;
+  }
+
   template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
   CoeffType PlanetPhysicsHelper<CoeffType,VectorCoeffType,MatrixCoeffType>::scaling_factor() const
   {
@@ -2069,12 +2304,24 @@ namespace Planet
     return _ss_species;
   }
 
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  const SteadyStateMechanism<CoeffType> & PlanetPhysicsHelper<CoeffType,VectorCoeffType,MatrixCoeffType>::ionic_mechanism() const
+  {
+    return *_ionic_mechanism;
+  }
+
   template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
   const std::vector<unsigned int> & PlanetPhysicsHelper<CoeffType,VectorCoeffType,MatrixCoeffType>::index_photochemistry() const
   {
     return _index_photochemistry;
   }
 
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  const PhotolysisEvaluator<CoeffType,VectorCoeffType>* PlanetPhysicsHelper<CoeffType,VectorCoeffType,MatrixCoeffType>::photolysis() const
+  {
+    return _photolysis;
+  }
+
 } // end namespace Planet
 
 #endif // PLANET_PLANET_PHYSICS_HELPER_H
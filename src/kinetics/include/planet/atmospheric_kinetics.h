@@ -32,12 +32,16 @@
 #include "planet/atmospheric_temperature.h"
 #include "planet/atmospheric_mixture.h"
 #include "planet/photon_evaluator.h"
+#include "planet/photolysis_evaluator.h"
 #include "planet/atmospheric_steady_state.h"
+#include "planet/batched_kinetics.h"
 
 //eigen
 #include <Eigen/Dense>
 
 //C++
+#include <vector>
+#include <algorithm>
 
 namespace Planet
 {
@@ -47,6 +51,9 @@ namespace Planet
       private:
         //! no default constructor
         AtmosphericKinetics() {antioch_error();return;}
+        //! owns the batch, don't copy
+        AtmosphericKinetics(const AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType> &);
+        AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType> & operator=(const AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType> &);
 
         Antioch::KineticsEvaluator<CoeffType> &_neutral_reactions;
         Antioch::KineticsEvaluator<CoeffType> &_ionic_reactions;
@@ -59,6 +66,65 @@ namespace Planet
         const AtmosphericTemperature<CoeffType,VectorCoeffType>             & _temperature;
         PhotonEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>          & _photon;
         const AtmosphericMixture<CoeffType,VectorCoeffType,MatrixCoeffType> & _composition;
+
+//J-value engine, optional
+        const PhotolysisEvaluator<CoeffType,VectorCoeffType>                * _photolysis;
+        VectorCoeffType                                                       _flux_at_z;
+        VectorCoeffType                                                       _photolysis_rates;
+        VectorCoeffType                                                       _tau_at_z;
+        VectorCoeffType                                                       _dlog_chapman_dn;
+        VectorCoeffType                                                       _dcolumn_dn;
+        MatrixCoeffType                                                       _dphotolysis_rates_dn;
+
+//batched neutral chemistry, built at the first batched call
+        BatchedKinetics<CoeffType,VectorCoeffType>                          * _neutral_batch;
+        //! altitudes kept by the rate constant caches and the warm starts
+        unsigned int                                                          _altitude_store_size;
+
+        //! resized batch of \p n_points points
+        BatchedKinetics<CoeffType,VectorCoeffType> & neutral_batch(unsigned int n_points);
+
+//single point scratch, a batch of one point kept between calls
+        std::vector<Antioch::KineticsConditions<CoeffType> >                  _point_conditions;
+        VectorCoeffType                                                       _point_altitude;
+        VectorCoeffType                                                       _point_jacobian;
+
+        //! condition and altitude of the batch of one point
+        template<typename StateType>
+        void set_point(const Antioch::KineticsConditions<StateType> & KC, const StateType & z);
+
+//ionic scratch
+        VectorCoeffType                                                       _full_concentrations;
+        VectorCoeffType                                                       _source_ions;
+        MatrixCoeffType                                                       _ionic_drate_dn;
+        // one point of a batch, neutral species
+        VectorCoeffType                                                       _batch_point_concentrations;
+        VectorCoeffType                                                       _batch_point_rates;
+        MatrixCoeffType                                                       _batch_point_drates_dn;
+
+/* sparse chemical jacobian (CSR over the neutral species), the union of
+   the neutral reactions, the ionic system and the photolysis patterns */
+        std::vector<unsigned int>                                             _jacobian_row_ptr;
+        std::vector<unsigned int>                                             _jacobian_cols;
+        // position of the values of the neutral batch pattern
+        std::vector<unsigned int>                                             _neutral_jacobian_position;
+        VectorCoeffType                                                       _neutral_jacobian_values;
+        // (neutral, neutral) entries of the ionic system: ionic indices and position
+        std::vector<unsigned int>                                             _ionic_jacobian_rows;
+        std::vector<unsigned int>                                             _ionic_jacobian_cols;
+        std::vector<unsigned int>                                             _ionic_jacobian_position;
+
+        //! builds the sparse pattern of the chemical jacobian, photolysis included if set
+        void build_jacobian_pattern();
+
+        //! error if the J-value engine is not set, the photolysis derivatives through the photon flux need it
+        void require_photolysis_engine() const;
+
+        //! steady state ions for the neutral densities, \return false if no ionospheric activity
+        template<typename StateType, typename VectorStateType>
+        bool ionic_sources_and_derivs(const VectorStateType &neutral_concentrations, 
+                                      const Antioch::KineticsConditions<StateType> & KC, const StateType &z);
+
       public:
         //!
         AtmosphericKinetics(Antioch::KineticsEvaluator<CoeffType>                               &neu,
@@ -67,6 +133,14 @@ namespace Planet
                             PhotonEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>          &photon,
                             const AtmosphericMixture<CoeffType,VectorCoeffType,MatrixCoeffType> &composition,
                             std::vector<Antioch::Species>                                       ionic_species = std::vector<Antioch::Species>());
+
+        //! ionic system on a shared steady state mechanism, which must outlive this object
+        AtmosphericKinetics(Antioch::KineticsEvaluator<CoeffType>                               &neu,
+                            Antioch::KineticsEvaluator<CoeffType>                               &ion,
+                            const AtmosphericTemperature<CoeffType,VectorCoeffType>             &temperature,
+                            PhotonEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>          &photon,
+                            const AtmosphericMixture<CoeffType,VectorCoeffType,MatrixCoeffType> &composition,
+                            const SteadyStateMechanism<CoeffType>                               &ionic_mechanism);
         //!
         ~AtmosphericKinetics();
 
@@ -76,6 +150,39 @@ namespace Planet
         //!\return ionic kinetics system, writable reference
         Antioch::KineticsEvaluator<CoeffType> &ionic_kinetics();
 
+        //! photolysis rates are given by the J-value engine
+        void set_photolysis(const PhotolysisEvaluator<CoeffType,VectorCoeffType> &photolysis);
+
+        //!\return true if the J-value engine is used
+        bool photolysis_engine() const;
+
+        //!\return J-value engine, NULL if photolysis is left to Antioch
+        const PhotolysisEvaluator<CoeffType,VectorCoeffType> * photolysis() const;
+
+        //!\return true if the ions are solved at steady state
+        bool ionic_coupling() const;
+
+        //! forgets the rate constants stored by altitude, to be called when the rate parameters or the temperature profile change
+        void clear_rate_caches();
+
+        //! at most \p n altitudes in the rate constant caches and in the ionic warm start store
+        void set_altitude_store_size(unsigned int n);
+
+        //!\return ionic steady state solver, Newton settings and diagnostics
+        AtmosphericSteadyState<CoeffType,VectorCoeffType> & ionic_solver();
+
+        //!\return ionic steady state solver, Newton diagnostics
+        const AtmosphericSteadyState<CoeffType,VectorCoeffType> & ionic_solver() const;
+
+        //!\return row pointer of the sparse chemical jacobian (CSR), fixed by the mechanisms
+        const std::vector<unsigned int> & chemical_jacobian_row_ptr() const;
+
+        //!\return columns of the sparse chemical jacobian (CSR)
+        const std::vector<unsigned int> & chemical_jacobian_cols() const;
+
+        //!\return number of stored values of the sparse chemical jacobian
+        unsigned int chemical_jacobian_non_zeros() const;
+
         //! compute chemical net rate and provide them in kin_rates
         template<typename StateType, typename VectorStateType>
         void chemical_rate(const VectorStateType &molar_concentrations, 
@@ -88,6 +195,77 @@ namespace Planet
                                       const StateType & z,
                                       VectorStateType &kin_rates, MatrixStateType &dkin_rates_dn);
 
+        //! compute chemical net rate, photolysis by the J-value engine using the column densities \p sum_dens
+        template<typename StateType, typename VectorStateType>
+        void chemical_rate(const VectorStateType &molar_concentrations, const VectorStateType &sum_dens,
+                           const Antioch::KineticsConditions<StateType> &KC, 
+                           const StateType & z, VectorStateType &kin_rates);
+
+        //! compute chemical net rate and derivatives, photolysis by the J-value engine using the column densities \p sum_dens
+        template<typename StateType, typename VectorStateType, typename MatrixStateType>
+        void chemical_rate_and_derivs(const VectorStateType &molar_concentrations, const VectorStateType &sum_dens,
+                                      const Antioch::KineticsConditions<StateType> &KC, 
+                                      const StateType & z,
+                                      VectorStateType &kin_rates, MatrixStateType &dkin_rates_dn);
+
+        //! compute chemical net rate and derivatives, the column densities \p sum_dens depending locally on the densities by \p dsum_dens_dn
+        template<typename StateType, typename VectorStateType, typename MatrixStateType>
+        void chemical_rate_and_derivs(const VectorStateType &molar_concentrations, const VectorStateType &sum_dens,
+                                      const VectorStateType &dsum_dens_dn,
+                                      const Antioch::KineticsConditions<StateType> &KC, 
+                                      const StateType & z,
+                                      VectorStateType &kin_rates, MatrixStateType &dkin_rates_dn);
+
+        //! compute chemical net rate and derivatives, jacobian values following chemical_jacobian_row_ptr() and chemical_jacobian_cols()
+        template<typename StateType, typename VectorStateType>
+        void chemical_rate_and_sparse_derivs(const VectorStateType &molar_concentrations,
+                                             const Antioch::KineticsConditions<StateType> &KC, 
+                                             const StateType & z,
+                                             VectorStateType &kin_rates, VectorStateType &jacobian_values);
+
+        //! compute chemical net rate and sparse derivatives, photolysis by the J-value engine using the column densities \p sum_dens
+        template<typename StateType, typename VectorStateType>
+        void chemical_rate_and_sparse_derivs(const VectorStateType &molar_concentrations, const VectorStateType &sum_dens,
+                                             const Antioch::KineticsConditions<StateType> &KC, 
+                                             const StateType & z,
+                                             VectorStateType &kin_rates, VectorStateType &jacobian_values);
+
+        /*! compute chemical net rates of n_points points in one sweep over the neutral reactions, one condition and
+         *  one altitude per point, densities and rates points fastest: molar_concentrations[s * n_points + p]
+         */
+        template<typename StateType, typename VectorStateType>
+        void chemical_rate_batch(const VectorStateType &molar_concentrations,
+                                 const std::vector<Antioch::KineticsConditions<StateType> > &conditions,
+                                 const VectorStateType & z, VectorStateType &kin_rates);
+
+        //! batched chemical net rates and dense derivatives, dkin_rates_dn[(s * n_species + i) * n_points + p]
+        template<typename StateType, typename VectorStateType>
+        void chemical_rate_and_derivs_batch(const VectorStateType &molar_concentrations,
+                                            const std::vector<Antioch::KineticsConditions<StateType> > &conditions,
+                                            const VectorStateType & z,
+                                            VectorStateType &kin_rates, VectorStateType &dkin_rates_dn);
+
+        //! photolysis rates (s-1) of the channels of the J-value engine
+        template<typename StateType, typename VectorStateType>
+        void photolysis_rates(const VectorStateType &molar_concentrations, const VectorStateType &sum_dens,
+                              const StateType & z, VectorStateType &rates);
+
+        //! photolysis sources from the J-value engine
+        template<typename StateType, typename VectorStateType>
+        void add_photolysis_contribution(const VectorStateType &molar_concentrations, const VectorStateType &sum_dens,
+                                         const StateType & z, VectorStateType &kin_rates);
+
+        //! photolysis sources and derivatives from the J-value engine, photon flux derivatives through a(n)
+        template<typename StateType, typename VectorStateType, typename MatrixStateType>
+        void add_photolysis_contribution_and_derivs(const VectorStateType &molar_concentrations, const VectorStateType &sum_dens,
+                                                    const StateType & z, VectorStateType &kin_rates, MatrixStateType &dkin_rates_dn);
+
+        //! photolysis sources and derivatives from the J-value engine, photon flux derivatives through a(n) and the column densities
+        template<typename StateType, typename VectorStateType, typename MatrixStateType>
+        void add_photolysis_contribution_and_derivs(const VectorStateType &molar_concentrations, const VectorStateType &sum_dens,
+                                                    const VectorStateType &dsum_dens_dn,
+                                                    const StateType & z, VectorStateType &kin_rates, MatrixStateType &dkin_rates_dn);
+
         //! Newton solver for the ionic system
         template<typename StateType, typename VectorStateType>
         void add_ionic_contribution(const VectorStateType &molar_concentrations, const Antioch::KineticsConditions<StateType> &KC, 
@@ -98,6 +276,17 @@ namespace Planet
         void add_ionic_contribution_and_derivs(const VectorStateType &neutral_concentrations, 
                                                const Antioch::KineticsConditions<StateType> & KC, const StateType &z, 
                                                VectorStateType &kin_rates, MatrixStateType &dkin_rates_dn);
+
+        //! Newton solver for the ionic system, derivatives in the sparse chemical jacobian
+        template<typename StateType, typename VectorStateType>
+        void add_ionic_contribution_and_sparse_derivs(const VectorStateType &neutral_concentrations, 
+                                                      const Antioch::KineticsConditions<StateType> & KC, const StateType &z, 
+                                                      VectorStateType &kin_rates, VectorStateType &jacobian_values);
+
+        //! photolysis sources and derivatives from the J-value engine in the sparse chemical jacobian
+        template<typename StateType, typename VectorStateType>
+        void add_photolysis_contribution_and_sparse_derivs(const VectorStateType &molar_concentrations, const VectorStateType &sum_dens,
+                                                           const StateType & z, VectorStateType &kin_rates, VectorStateType &jacobian_values);
   };
 
 
@@ -115,24 +304,245 @@ namespace Planet
    _newton_solver(_ions_species,ion),
    _temperature(temperature),
    _photon(photon),
-   _composition(composition)
+   _composition(composition),
+   _photolysis(NULL),
+   _neutral_batch(NULL),
+   _altitude_store_size(AltitudeStore<CoeffType,VectorCoeffType>::default_capacity())
   {
     _ionic_coupling = !ionic_species.empty();
+    this->build_jacobian_pattern();
+    
+    return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::AtmosphericKinetics(Antioch::KineticsEvaluator<CoeffType>               &neu,
+                                                                      Antioch::KineticsEvaluator<CoeffType>                               &ion,
+                                                                      const AtmosphericTemperature<CoeffType,VectorCoeffType>             &temperature,
+                                                                      PhotonEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>          &photon,
+                                                                      const AtmosphericMixture<CoeffType,VectorCoeffType,MatrixCoeffType> &composition,
+                                                                      const SteadyStateMechanism<CoeffType>                               &ionic_mechanism ):
+   _neutral_reactions(neu),
+   _ionic_reactions(ion),
+   _ions_species(ionic_mechanism.ss_species()),
+   _newton_solver(ionic_mechanism),
+   _temperature(temperature),
+   _photon(photon),
+   _composition(composition),
+   _photolysis(NULL),
+   _neutral_batch(NULL),
+   _altitude_store_size(AltitudeStore<CoeffType,VectorCoeffType>::default_capacity())
+  {
+    _ionic_coupling = !_ions_species.empty();
+    this->build_jacobian_pattern();
+    
+    return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::~AtmosphericKinetics()
+  {
+    delete _neutral_batch;
+    return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  BatchedKinetics<CoeffType,VectorCoeffType> & AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::neutral_batch(unsigned int n_points)
+  {
+    if(!_neutral_batch)
+    {
+      _neutral_batch = new BatchedKinetics<CoeffType,VectorCoeffType>(_neutral_reactions.reaction_set(),n_points);
+      _neutral_batch->set_altitude_store_size(_altitude_store_size);
+    }
+    _neutral_batch->set_n_points(n_points);
+
+    return *_neutral_batch;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType>
+  inline
+  void AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::set_point(const Antioch::KineticsConditions<StateType> & KC, const StateType & z)
+  {
+    // the storage stays, no allocation after the first call
+    _point_conditions.clear();
+    _point_conditions.push_back(KC);
+    _point_altitude.resize(1,0.L);
+    _point_altitude[0] = z;
+
+    return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  void AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::build_jacobian_pattern()
+  {
+    const unsigned int n_species = _composition.neutral_composition().n_species();
+    std::vector<std::vector<unsigned int> > rows(n_species);
+
+    // neutral reactions
+    const BatchedKinetics<CoeffType,VectorCoeffType> & batch = this->neutral_batch(1);
+    for(unsigned int s = 0; s < n_species; s++)
+    {
+       rows[s].assign(batch.jacobian_cols().begin() + batch.jacobian_row_ptr()[s],
+                      batch.jacobian_cols().begin() + batch.jacobian_row_ptr()[s + 1]);
+    }
+
+    // ionic system: neutrals of the ionic reactions by neutral reactants of the ionic reactions
+    std::vector<unsigned int> ionic_rows;
+    std::vector<unsigned int> ionic_cols;
     if(_ionic_coupling)
     {
-      _newton_solver.build_map();        //ionospheric solver maps
+       std::vector<int> neutral_of_ionic(_ionic_reactions.n_species(),-1);
+       for(unsigned int s = 0; s < n_species; s++)
+       {
+          neutral_of_ionic[_composition.ionic_composition().species_list()[_composition.neutral_composition().species_list()[s]]] = s;
+       }
+       std::vector<bool> is_row(n_species,false);
+       std::vector<bool> is_col(n_species,false);
+       const Antioch::ReactionSet<CoeffType> & ionic_set = _ionic_reactions.reaction_set();
+       for(unsigned int rxn = 0; rxn < ionic_set.n_reactions(); rxn++)
+       {
+          const Antioch::Reaction<CoeffType> & reaction = ionic_set.reaction(rxn);
+          for(unsigned int r = 0; r < reaction.n_reactants(); r++)
+          {
+             const int s = neutral_of_ionic[reaction.reactant_id(r)];
+             if(s < 0)continue;
+             is_row[s] = true;
+             is_col[s] = true;
+          }
+          for(unsigned int p = 0; p < reaction.n_products(); p++)
+          {
+             const int s = neutral_of_ionic[reaction.product_id(p)];
+             if(s >= 0)is_row[s] = true;
+          }
+       }
+       for(unsigned int s = 0; s < n_species; s++)
+       {
+          if(is_row[s])ionic_rows.push_back(s);
+          if(is_col[s])ionic_cols.push_back(s);
+       }
+       for(unsigned int r = 0; r < ionic_rows.size(); r++)
+       {
+          rows[ionic_rows[r]].insert(rows[ionic_rows[r]].end(),ionic_cols.begin(),ionic_cols.end());
+       }
     }
-    
+
+    // photolysis by the J-value engine, the photon flux depends on every density
+    if(_photolysis)
+    {
+       std::vector<bool> full_row(n_species,false);
+       for(unsigned int r = 0; r < _photolysis->n_photolysis(); r++)
+       {
+          full_row[_photolysis->reactant(r)] = true;
+          for(unsigned int p = 0; p < _photolysis->products(r).size(); p++)full_row[_photolysis->products(r)[p]] = true;
+       }
+       for(unsigned int s = 0; s < n_species; s++)
+       {
+          if(!full_row[s])continue;
+          rows[s].resize(n_species);
+          for(unsigned int i = 0; i < n_species; i++)rows[s][i] = i;
+       }
+    }
+
+    _jacobian_row_ptr.assign(1,0);
+    _jacobian_cols.clear();
+    for(unsigned int s = 0; s < n_species; s++)
+    {
+       std::sort(rows[s].begin(),rows[s].end());
+       rows[s].erase(std::unique(rows[s].begin(),rows[s].end()),rows[s].end());
+       _jacobian_cols.insert(_jacobian_cols.end(),rows[s].begin(),rows[s].end());
+       _jacobian_row_ptr.push_back(_jacobian_cols.size());
+    }
+
+    // positions
+    _neutral_jacobian_position.resize(batch.jacobian_non_zeros());
+    _neutral_jacobian_values.resize(batch.jacobian_non_zeros(),0.L);
+    for(unsigned int s = 0; s < n_species; s++)
+    {
+       for(unsigned int k = batch.jacobian_row_ptr()[s]; k < batch.jacobian_row_ptr()[s + 1]; k++)
+       {
+          _neutral_jacobian_position[k] = std::lower_bound(_jacobian_cols.begin() + _jacobian_row_ptr[s],
+                                                           _jacobian_cols.begin() + _jacobian_row_ptr[s + 1],
+                                                           batch.jacobian_cols()[k]) - _jacobian_cols.begin();
+       }
+    }
+
+    _ionic_jacobian_rows.clear();
+    _ionic_jacobian_cols.clear();
+    _ionic_jacobian_position.clear();
+    for(unsigned int r = 0; r < ionic_rows.size(); r++)
+    {
+       const unsigned int s = ionic_rows[r];
+       for(unsigned int c = 0; c < ionic_cols.size(); c++)
+       {
+          const unsigned int q = ionic_cols[c];
+          _ionic_jacobian_rows.push_back(_composition.ionic_composition().species_list()[_composition.neutral_composition().species_list()[s]]);
+          _ionic_jacobian_cols.push_back(_composition.ionic_composition().species_list()[_composition.neutral_composition().species_list()[q]]);
+          _ionic_jacobian_position.push_back(std::lower_bound(_jacobian_cols.begin() + _jacobian_row_ptr[s],
+                                                              _jacobian_cols.begin() + _jacobian_row_ptr[s + 1], q) - _jacobian_cols.begin());
+       }
+    }
+
+    // ionic scratch
+    if(_ionic_coupling)
+    {
+       _full_concentrations.resize(_ionic_reactions.n_species(),0.L);
+       _source_ions.resize(_ionic_reactions.n_species(),0.L);
+       _ionic_drate_dn.resize(_ionic_reactions.n_species());
+       for(unsigned int s = 0; s < _ionic_reactions.n_species(); s++)
+       {
+         _ionic_drate_dn[s].resize(_ionic_reactions.n_species(),0.L);
+       }
+       _batch_point_concentrations.resize(n_species,0.L);
+       _batch_point_rates.resize(n_species,0.L);
+       _batch_point_drates_dn.resize(n_species);
+       for(unsigned int s = 0; s < n_species; s++)
+       {
+         _batch_point_drates_dn[s].resize(n_species,0.L);
+       }
+    }
+
     return;
   }
 
   template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
   inline
-  AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::~AtmosphericKinetics()
+  void AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::require_photolysis_engine() const
   {
+    if(!_photolysis)
+    {
+      std::cerr << "Error: photolysis from the column densities needs the J-value engine, see set_photolysis()" << std::endl;
+      antioch_error();
+    }
+
     return;
   }
 
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  const std::vector<unsigned int> & AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::chemical_jacobian_row_ptr() const
+  {
+    return _jacobian_row_ptr;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  const std::vector<unsigned int> & AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::chemical_jacobian_cols() const
+  {
+    return _jacobian_cols;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  unsigned int AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::chemical_jacobian_non_zeros() const
+  {
+    return _jacobian_cols.size();
+  }
+
   template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
   inline
   Antioch::KineticsEvaluator<CoeffType> &AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::neutral_kinetics()
@@ -147,6 +557,81 @@ namespace Planet
      return _ionic_reactions;
   }
 
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  void AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::set_photolysis(const PhotolysisEvaluator<CoeffType,VectorCoeffType> &photolysis)
+  {
+     _photolysis = &photolysis;
+     _flux_at_z.resize(_photon.photon_flux_at_top().flux().size(),0.L);
+     _photolysis_rates.resize(photolysis.n_photolysis(),0.L);
+     _tau_at_z.resize(_photon.photon_flux_at_top().flux().size(),0.L);
+     _dlog_chapman_dn.resize(_composition.neutral_composition().n_species(),0.L);
+     _dcolumn_dn.resize(_composition.neutral_composition().n_species(),0.L);
+     _dphotolysis_rates_dn.resize(photolysis.n_photolysis());
+     for(unsigned int r = 0; r < photolysis.n_photolysis(); r++)
+     {
+       _dphotolysis_rates_dn[r].resize(_composition.neutral_composition().n_species(),0.L);
+     }
+
+     this->build_jacobian_pattern();
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  bool AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::photolysis_engine() const
+  {
+     return (_photolysis != NULL);
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  const PhotolysisEvaluator<CoeffType,VectorCoeffType> * AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::photolysis() const
+  {
+     return _photolysis;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  bool AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::ionic_coupling() const
+  {
+     return _ionic_coupling;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  void AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::clear_rate_caches()
+  {
+     if(_neutral_batch)_neutral_batch->clear_rate_cache();
+     _newton_solver.clear_rate_cache();
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  void AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::set_altitude_store_size(unsigned int n)
+  {
+     _altitude_store_size = n;
+     if(_neutral_batch)_neutral_batch->set_altitude_store_size(n);
+     _newton_solver.set_altitude_store_size(n);
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  AtmosphericSteadyState<CoeffType,VectorCoeffType> & AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::ionic_solver()
+  {
+     return _newton_solver;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  const AtmosphericSteadyState<CoeffType,VectorCoeffType> & AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::ionic_solver() const
+  {
+     return _newton_solver;
+  }
+
   template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
   template<typename StateType, typename VectorStateType>
   inline
@@ -156,10 +641,9 @@ namespace Planet
                                                                      VectorStateType &kin_rates)
   {
      antioch_assert_equal_to(kin_rates.size(),_composition.neutral_composition().n_species());
-     VectorStateType dummy;
-     dummy.resize(_composition.neutral_composition().n_species(),0.L); //everything is irreversible
-     _neutral_reactions.compute_mole_sources(KC,
-                                             molar_concentrations,dummy,kin_rates);
+     // a batch of one point, the rate constants are stored by altitude
+     this->set_point(KC,z);
+     this->neutral_batch(1).mole_sources(_point_conditions,_point_altitude,molar_concentrations,kin_rates);
 
      if(_ionic_coupling)this->add_ionic_contribution(molar_concentrations,KC,z,kin_rates);
 
@@ -182,18 +666,218 @@ namespace Planet
        antioch_assert_equal_to(dkin_rates_dn[s].size(),_composition.neutral_composition().n_species());
      }
 #endif
-     VectorStateType dummy;
-     VectorStateType ddummy_dT;
-     VectorStateType dkin_dT;
-     dummy.resize(_composition.neutral_composition().n_species(),0.L); //everything is irreversible
-     ddummy_dT.resize(_composition.neutral_composition().n_species(),0.L); //everything is irreversible
-     dkin_dT.resize(_composition.neutral_composition().n_species(),0.L); //no temp
-     _neutral_reactions.compute_mole_sources_and_derivs(kinetics_conditions,molar_concentrations,dummy,ddummy_dT,
-                                                        kin_rates,dkin_dT,dkin_rates_dn);
+     const unsigned int n_species = _composition.neutral_composition().n_species();
+     // a batch of one point, the rate constants are stored by altitude
+     this->set_point(kinetics_conditions,z);
+     _point_jacobian.resize(n_species * n_species,0.L);
+     this->neutral_batch(1).mole_sources_and_derivs(_point_conditions,_point_altitude,molar_concentrations,kin_rates,_point_jacobian);
+     for(unsigned int s = 0; s < n_species; s++)
+     {
+        for(unsigned int i = 0; i < n_species; i++)
+        {
+           dkin_rates_dn[s][i] = _point_jacobian[s * n_species + i];
+        }
+     }
 
      if(_ionic_coupling)this->add_ionic_contribution_and_derivs(molar_concentrations,kinetics_conditions,z,kin_rates,dkin_rates_dn);
   }
 
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType>
+  inline
+  void AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::chemical_rate(const VectorStateType &molar_concentrations, 
+                                                                     const VectorStateType &sum_dens,
+                                                                     const Antioch::KineticsConditions<StateType> &KC,
+                                                                     const StateType & z,
+                                                                     VectorStateType &kin_rates)
+  {
+     this->chemical_rate(molar_concentrations,KC,z,kin_rates);
+     this->require_photolysis_engine();
+     this->add_photolysis_contribution(molar_concentrations,sum_dens,z,kin_rates);
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType, typename MatrixStateType>
+  inline
+  void AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::chemical_rate_and_derivs(const VectorStateType &molar_concentrations,
+                                      const VectorStateType &sum_dens,
+                                      const Antioch::KineticsConditions<StateType> & kinetics_conditions, 
+                                      const StateType & z, VectorStateType &kin_rates, MatrixStateType &dkin_rates_dn)
+  {
+     this->chemical_rate_and_derivs(molar_concentrations,kinetics_conditions,z,kin_rates,dkin_rates_dn);
+     this->require_photolysis_engine();
+     this->add_photolysis_contribution_and_derivs(molar_concentrations,sum_dens,z,kin_rates,dkin_rates_dn);
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType, typename MatrixStateType>
+  inline
+  void AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::chemical_rate_and_derivs(const VectorStateType &molar_concentrations,
+                                      const VectorStateType &sum_dens, const VectorStateType &dsum_dens_dn,
+                                      const Antioch::KineticsConditions<StateType> & kinetics_conditions, 
+                                      const StateType & z, VectorStateType &kin_rates, MatrixStateType &dkin_rates_dn)
+  {
+     this->chemical_rate_and_derivs(molar_concentrations,kinetics_conditions,z,kin_rates,dkin_rates_dn);
+     this->require_photolysis_engine();
+     this->add_photolysis_contribution_and_derivs(molar_concentrations,sum_dens,dsum_dens_dn,z,kin_rates,dkin_rates_dn);
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType>
+  inline
+  void AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::chemical_rate_batch(const VectorStateType &molar_concentrations,
+                                                                     const std::vector<Antioch::KineticsConditions<StateType> > &conditions,
+                                                                     const VectorStateType & z, VectorStateType &kin_rates)
+  {
+     const unsigned int n_points = z.size();
+     const unsigned int n_species = _composition.neutral_composition().n_species();
+     antioch_assert_equal_to(kin_rates.size(),n_species * n_points);
+
+     this->neutral_batch(n_points).mole_sources(conditions,z,molar_concentrations,kin_rates);
+
+     if(!_ionic_coupling)return;
+
+     // steady state ions, point by point
+     for(unsigned int p = 0; p < n_points; p++)
+     {
+        for(unsigned int s = 0; s < n_species; s++)
+        {
+           _batch_point_concentrations[s] = molar_concentrations[s * n_points + p];
+        }
+        Antioch::set_zero(_batch_point_rates);
+        this->add_ionic_contribution(_batch_point_concentrations,conditions[p],z[p],_batch_point_rates);
+        for(unsigned int s = 0; s < n_species; s++)
+        {
+           kin_rates[s * n_points + p] += _batch_point_rates[s];
+        }
+     }
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType>
+  inline
+  void AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::chemical_rate_and_derivs_batch(const VectorStateType &molar_concentrations,
+                                                                     const std::vector<Antioch::KineticsConditions<StateType> > &conditions,
+                                                                     const VectorStateType & z,
+                                                                     VectorStateType &kin_rates, VectorStateType &dkin_rates_dn)
+  {
+     const unsigned int n_points = z.size();
+     const unsigned int n_species = _composition.neutral_composition().n_species();
+     antioch_assert_equal_to(kin_rates.size(),n_species * n_points);
+     antioch_assert_equal_to(dkin_rates_dn.size(),n_species * n_species * n_points);
+
+     this->neutral_batch(n_points).mole_sources_and_derivs(conditions,z,molar_concentrations,kin_rates,dkin_rates_dn);
+
+     if(!_ionic_coupling)return;
+
+     // steady state ions, point by point
+     for(unsigned int p = 0; p < n_points; p++)
+     {
+        for(unsigned int s = 0; s < n_species; s++)
+        {
+           _batch_point_concentrations[s] = molar_concentrations[s * n_points + p];
+        }
+        Antioch::set_zero(_batch_point_rates);
+        Antioch::set_zero(_batch_point_drates_dn);
+        this->add_ionic_contribution_and_derivs(_batch_point_concentrations,conditions[p],z[p],_batch_point_rates,_batch_point_drates_dn);
+        for(unsigned int s = 0; s < n_species; s++)
+        {
+           kin_rates[s * n_points + p] += _batch_point_rates[s];
+           for(unsigned int i = 0; i < n_species; i++)
+           {
+              dkin_rates_dn[(s * n_species + i) * n_points + p] += _batch_point_drates_dn[s][i];
+           }
+        }
+     }
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType>
+  inline
+  void AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::add_photolysis_contribution(const VectorStateType &molar_concentrations, 
+                                                                                                   const VectorStateType &sum_dens,
+                                                                                                   const StateType & z,
+                                                                                                   VectorStateType &kin_rates)
+  {
+     antioch_assert(_photolysis);
+
+     _photon.update_photon_flux(molar_concentrations,sum_dens,z,_flux_at_z);
+     _photolysis->photolysis_rates(_flux_at_z,_photolysis_rates);
+     _photolysis->add_mole_sources(_photolysis_rates,molar_concentrations,kin_rates);
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType>
+  inline
+  void AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::photolysis_rates(const VectorStateType &molar_concentrations, 
+                                                                                        const VectorStateType &sum_dens,
+                                                                                        const StateType & z,
+                                                                                        VectorStateType &rates)
+  {
+     this->require_photolysis_engine();
+
+     _photon.update_photon_flux(molar_concentrations,sum_dens,z,_flux_at_z);
+     _photolysis->photolysis_rates(_flux_at_z,rates);
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType, typename MatrixStateType>
+  inline
+  void AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::add_photolysis_contribution_and_derivs(const VectorStateType &molar_concentrations, 
+                                                                                                              const VectorStateType &sum_dens,
+                                                                                                              const StateType & z,
+                                                                                                              VectorStateType &kin_rates, MatrixStateType &dkin_rates_dn)
+  {
+     antioch_assert(_photolysis);
+
+     _photon.update_photon_flux_and_derivs(molar_concentrations,sum_dens,z,_flux_at_z,_tau_at_z,_dlog_chapman_dn);
+     _photolysis->photolysis_rates_and_derivs(_flux_at_z,_tau_at_z,_dlog_chapman_dn,_photolysis_rates,_dphotolysis_rates_dn);
+     _photolysis->add_mole_sources_and_derivs(_photolysis_rates,_dphotolysis_rates_dn,molar_concentrations,kin_rates,dkin_rates_dn);
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType, typename MatrixStateType>
+  inline
+  void AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::add_photolysis_contribution_and_derivs(const VectorStateType &molar_concentrations, 
+                                                                                                              const VectorStateType &sum_dens,
+                                                                                                              const VectorStateType &dsum_dens_dn,
+                                                                                                              const StateType & z,
+                                                                                                              VectorStateType &kin_rates, MatrixStateType &dkin_rates_dn)
+  {
+     antioch_assert(_photolysis);
+     antioch_assert_equal_to(dsum_dens_dn.size(),_dcolumn_dn.size());
+
+     _photon.update_photon_flux_and_derivs(molar_concentrations,sum_dens,z,_flux_at_z,_tau_at_z,_dlog_chapman_dn);
+     _photolysis->photolysis_rates_and_derivs(_flux_at_z,_tau_at_z,_dlog_chapman_dn,_photolysis_rates,_dphotolysis_rates_dn);
+
+     const StateType chap = _photon.chapman_factor(molar_concentrations,z);
+     for(unsigned int s = 0; s < _dcolumn_dn.size(); s++)
+     {
+        _dcolumn_dn[s] = chap * dsum_dens_dn[s];
+     }
+     _photolysis->add_column_derivs(_flux_at_z,_photon.photon_opacity(),_dcolumn_dn,_dphotolysis_rates_dn);
+
+     _photolysis->add_mole_sources_and_derivs(_photolysis_rates,_dphotolysis_rates_dn,molar_concentrations,kin_rates,dkin_rates_dn);
+
+     return;
+  }
+
   template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
   template<typename StateType, typename VectorStateType>
   inline
@@ -206,21 +890,19 @@ namespace Planet
 //    if(z < 800. || z > 1200.)return;
 
  // neutrals resized
-    VectorStateType full_concentrations;
-    full_concentrations.resize(_composition.ionic_composition().n_species(),0.L);
+    Antioch::set_zero(_full_concentrations);
     for(unsigned int s = 0; s < neutral_concentrations.size(); s++)
     {
        unsigned int i = _composition.ionic_composition().species_list()[_composition.neutral_composition().species_list()[s]];
-       full_concentrations[i] = neutral_concentrations[s];
+       _full_concentrations[i] = neutral_concentrations[s];
     }
 
 //solve for ions
-    VectorCoeffType source_ions;
-    source_ions.resize(_ionic_reactions.n_species(),0.L);
+    Antioch::set_zero(_source_ions);
 //all temperature conditions, solver deal with it
 
-    _newton_solver.precompute_rates(full_concentrations,KC, KC.T(), _temperature.electronic_temperature(z)); 
-    if(_newton_solver.steady_state(source_ions))
+    _newton_solver.precompute_rates(_full_concentrations,KC, KC.T(), _temperature.electronic_temperature(z),z);
+    if(_newton_solver.steady_state(_source_ions,z))
     {
 
 //     std::cout << "Ionospheric activity at " << z << " km" << std::endl;
@@ -228,43 +910,45 @@ namespace Planet
       for(unsigned int s = 0; s < _composition.neutral_composition().n_species(); s++)
       {
         unsigned int i_neu = _composition.ionic_composition().species_list()[_composition.neutral_composition().species_list()[s]];
-        kin_rates[s] += source_ions[i_neu];
+        kin_rates[s] += _source_ions[i_neu];
       }
     }
   }
 
-
   template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
-  template<typename StateType, typename VectorStateType, typename MatrixStateType>
+  template<typename StateType, typename VectorStateType>
   inline
-  void AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::add_ionic_contribution_and_derivs(const VectorStateType &neutral_concentrations, 
-                                                                                                         const Antioch::KineticsConditions<StateType> & KC, const StateType &z, 
-                                                                                              VectorStateType &kin_rates, MatrixStateType &dkin_rates_dn)
+  bool AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::ionic_sources_and_derivs(const VectorStateType &neutral_concentrations, 
+                                                                                                const Antioch::KineticsConditions<StateType> & KC, const StateType &z)
   {
-
-//    if(z < 800. || z > 1200.)return;
-
  // neutrals resized
-    VectorStateType full_concentrations;
-    full_concentrations.resize(_composition.ionic_composition().n_species(),0.L);
+    Antioch::set_zero(_full_concentrations);
     for(unsigned int s = 0; s < neutral_concentrations.size(); s++)
     {
        unsigned int i = _composition.ionic_composition().species_list()[_composition.neutral_composition().species_list()[s]];
-       full_concentrations[i] = neutral_concentrations[s];
+       _full_concentrations[i] = neutral_concentrations[s];
     }
 
 //solve for ions
-    VectorCoeffType source_ions;
-    MatrixCoeffType drate_dn;
-    source_ions.resize(_ionic_reactions.n_species(),0.L);
-    drate_dn.resize(_ionic_reactions.n_species());
-    for(unsigned int s = 0; s < _ionic_reactions.n_species(); s++)
-    {
-      drate_dn[s].resize(_ionic_reactions.n_species(),0.L);
-    }
+    Antioch::set_zero(_source_ions);
+    Antioch::set_zero(_ionic_drate_dn);
 //all temperature conditions, solver deal with it
-    _newton_solver.precompute_rates(full_concentrations,KC, KC.T(), _temperature.electronic_temperature(z)); 
-    if(_newton_solver.steady_state_and_derivs(source_ions,drate_dn))
+    _newton_solver.precompute_rates(_full_concentrations,KC, KC.T(), _temperature.electronic_temperature(z),z);
+
+    return _newton_solver.steady_state_and_derivs(_source_ions,_ionic_drate_dn,z);
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType, typename MatrixStateType>
+  inline
+  void AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::add_ionic_contribution_and_derivs(const VectorStateType &neutral_concentrations, 
+                                                                                                         const Antioch::KineticsConditions<StateType> & KC, const StateType &z, 
+                                                                                              VectorStateType &kin_rates, MatrixStateType &dkin_rates_dn)
+  {
+
+//    if(z < 800. || z > 1200.)return;
+
+    if(this->ionic_sources_and_derivs(neutral_concentrations,KC,z))
     {
 
 //       std::cout << "Ionospheric activity at " << z << " km" << std::endl;
@@ -272,15 +956,95 @@ namespace Planet
       for(unsigned int s = 0; s < _composition.neutral_composition().n_species(); s++)
       {
         unsigned int i_neu = _composition.ionic_composition().species_list()[_composition.neutral_composition().species_list()[s]];
-        kin_rates[s] += source_ions[i_neu];
+        kin_rates[s] += _source_ions[i_neu];
         for(unsigned int q = 0; q < _composition.neutral_composition().n_species(); q++)
         {
            unsigned int j_neu = _composition.ionic_composition().species_list()[_composition.neutral_composition().species_list()[q]];
-           dkin_rates_dn[s][q] += drate_dn[i_neu][j_neu];
+           dkin_rates_dn[s][q] += _ionic_drate_dn[i_neu][j_neu];
         }
       }
     }
   }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType>
+  inline
+  void AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::add_ionic_contribution_and_sparse_derivs(const VectorStateType &neutral_concentrations, 
+                                                                                                                const Antioch::KineticsConditions<StateType> & KC, const StateType &z, 
+                                                                                                                VectorStateType &kin_rates, VectorStateType &jacobian_values)
+  {
+    if(this->ionic_sources_and_derivs(neutral_concentrations,KC,z))
+    {
+// update sources and derivs, only the (neutral, neutral) entries of the pattern
+      for(unsigned int s = 0; s < _composition.neutral_composition().n_species(); s++)
+      {
+        unsigned int i_neu = _composition.ionic_composition().species_list()[_composition.neutral_composition().species_list()[s]];
+        kin_rates[s] += _source_ions[i_neu];
+      }
+      for(unsigned int k = 0; k < _ionic_jacobian_position.size(); k++)
+      {
+        jacobian_values[_ionic_jacobian_position[k]] += _ionic_drate_dn[_ionic_jacobian_rows[k]][_ionic_jacobian_cols[k]];
+      }
+    }
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType>
+  inline
+  void AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::add_photolysis_contribution_and_sparse_derivs(const VectorStateType &molar_concentrations, 
+                                                                                                                     const VectorStateType &sum_dens,
+                                                                                                                     const StateType & z,
+                                                                                                                     VectorStateType &kin_rates, VectorStateType &jacobian_values)
+  {
+     antioch_assert(_photolysis);
+
+     _photon.update_photon_flux_and_derivs(molar_concentrations,sum_dens,z,_flux_at_z,_tau_at_z,_dlog_chapman_dn);
+     _photolysis->photolysis_rates_and_derivs(_flux_at_z,_tau_at_z,_dlog_chapman_dn,_photolysis_rates,_dphotolysis_rates_dn);
+     _photolysis->add_mole_sources_and_sparse_derivs(_photolysis_rates,_dphotolysis_rates_dn,molar_concentrations,kin_rates,
+                                                     _jacobian_row_ptr,jacobian_values);
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType>
+  inline
+  void AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::chemical_rate_and_sparse_derivs(const VectorStateType &molar_concentrations,
+                                      const Antioch::KineticsConditions<StateType> & kinetics_conditions, 
+                                      const StateType & z, VectorStateType &kin_rates, VectorStateType &jacobian_values)
+  {
+     antioch_assert_equal_to(kin_rates.size(),_composition.neutral_composition().n_species());
+     antioch_assert_equal_to(jacobian_values.size(),_jacobian_cols.size());
+
+     // a batch of one point, the rate constants are stored by altitude
+     this->set_point(kinetics_conditions,z);
+     this->neutral_batch(1).mole_sources_and_sparse_derivs(_point_conditions,_point_altitude,molar_concentrations,kin_rates,_neutral_jacobian_values);
+
+     Antioch::set_zero(jacobian_values);
+     for(unsigned int k = 0; k < _neutral_jacobian_position.size(); k++)
+     {
+        jacobian_values[_neutral_jacobian_position[k]] = _neutral_jacobian_values[k];
+     }
+
+     if(_ionic_coupling)this->add_ionic_contribution_and_sparse_derivs(molar_concentrations,kinetics_conditions,z,kin_rates,jacobian_values);
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType>
+  inline
+  void AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>::chemical_rate_and_sparse_derivs(const VectorStateType &molar_concentrations,
+                                      const VectorStateType &sum_dens,
+                                      const Antioch::KineticsConditions<StateType> & kinetics_conditions, 
+                                      const StateType & z, VectorStateType &kin_rates, VectorStateType &jacobian_values)
+  {
+     this->chemical_rate_and_sparse_derivs(molar_concentrations,kinetics_conditions,z,kin_rates,jacobian_values);
+     this->require_photolysis_engine();
+     this->add_photolysis_contribution_and_sparse_derivs(molar_concentrations,sum_dens,z,kin_rates,jacobian_values);
+
+     return;
+  }
 }
 
 #endif
@@ -30,18 +30,29 @@
 
 //Planet
 #include "planet/atmospheric_mixture.h"
+#include "planet/steady_state_mechanism.h"
+#include "planet/rate_constant_cache.h"
+#include "planet/altitude_store.h"
 
 //eigen
 #include <Eigen/Dense>
+#include <Eigen/Sparse>
 
 //boost
 #include <boost/math/special_functions/fpclassify.hpp>
 
 //C++
-#include <map>
+#include <vector>
+#include <algorithm>
+#include <utility>
 
 namespace Planet
 {
+  /*! Newton solver of the ionospheric steady state. The reaction topology
+   *  and the jacobian pattern are read from a SteadyStateMechanism, this
+   *  object holds only the per point state (rates, densities, factorization
+   *  and warm start store): build one mechanism and one solver per thread.
+   */
 //name convention:
 // mole_*  -> full system, neutral inside
 // molar_* -> ionic system, only ions
@@ -51,28 +62,84 @@ namespace Planet
       private:
         //don't use it
         AtmosphericSteadyState();
+        //the mechanism may be owned, don't copy
+        AtmosphericSteadyState(const AtmosphericSteadyState<CoeffType,VectorCoeffType> &);
 
-        //from AtmosphericKinetics
-        //!contains all the system
-        Antioch::KineticsEvaluator<CoeffType> &_reactions_system; 
-        //!targets only the species at steady state
-        const std::vector<Antioch::Species>   & _ss_species;
+        typedef typename SteadyStateMechanism<CoeffType>::ReactionTopology ReactionTopology;
+
+        //! built by the legacy constructor, NULL if shared
+        SteadyStateMechanism<CoeffType>       * _own_mechanism;
+        //! topology, maps and jacobian pattern, read only
+        const SteadyStateMechanism<CoeffType> & _mechanism;
+
+        //! scratch for the rate derivatives, one per reactant of a reaction
+        mutable VectorCoeffType _dRfwd_dX;
 
-        //internal stuff
-        std::map<unsigned int,unsigned int> _ionic_map;         //from n_species to ss_species
-        std::map<unsigned int,unsigned int> _ionic_inverse_map; //to ss_species to n_species
         VectorCoeffType _rates;
         VectorCoeffType _mole_concentrations;
         VectorCoeffType _updated_rates;
         VectorCoeffType _molar_concentrations;
 
+        //! Newton workspace, ionic system sized
+        VectorCoeffType              _molar_sources;
+        std::vector<VectorCoeffType> _dmolar_dX_s;
+        VectorCoeffType              _newton_start;
+        //! first approximation workspace, production and loss by ion
+        VectorCoeffType              _sum_forward;
+        VectorCoeffType              _sum_backward;
 
         //solver library, for the Ax = b solve
         Eigen::Matrix<CoeffType,Eigen::Dynamic,Eigen::Dynamic> A;
         Eigen::Matrix<CoeffType,Eigen::Dynamic,1>              b;
+        Eigen::Matrix<CoeffType,Eigen::Dynamic,1>              x;
+
+        //sparse path, the mechanism pattern is analyzed once at construction
+        bool                                                   _sparse;
+        Eigen::SparseMatrix<CoeffType>                         _sparse_jacobian;
+        Eigen::SparseLU<Eigen::SparseMatrix<CoeffType>, Eigen::COLAMDOrdering<int> > _sparse_lu;
+
+        //! sizes the state on the mechanism, analyzes the jacobian pattern
+        void init();
 
         CoeffType _thresh;
 
+        //warm start, converged ions densities by altitude
+        AltitudeStore<CoeffType,VectorCoeffType> _warm_start;
+        CoeffType                           _warm_start_dz;
+        unsigned int                        _newton_iterations;
+
+        //Newton settings
+        unsigned int                        _newton_max_iterations;
+        unsigned int                        _newton_max_backtracks;
+
+        //Newton diagnostics, accumulated until reset
+        unsigned int                        _n_solves;
+        unsigned int                        _n_failures;
+        unsigned int                        _total_newton_iterations;
+        unsigned int                        _n_backtracks;
+        unsigned int                        _n_stalls;
+        bool                                _stalled;
+        std::vector<CoeffType>              _newton_residuals;
+        std::vector<CoeffType>              _failure_altitudes;
+
+        //! starts from the densities stored within _warm_start_dz of \p z, first approximation if none
+        void warm_start(const CoeffType & z);
+
+        //! stores the converged densities at \p z
+        void store_warm_start(const CoeffType & z);
+
+        //! rate constants by altitude, temperatures only
+        RateConstantCache<CoeffType,VectorCoeffType> _rate_cache;
+
+        //! rate constant of reaction \p rxn
+        template <typename StateType, typename VectorStateType>
+        StateType rate_constant(unsigned int rxn, const VectorStateType & mole_concentrations,
+                                const Antioch::KineticsConditions<StateType> & KC, const StateType & T_electrons) const;
+
+        //! rates multiplied by the neutral concentrations
+        template <typename VectorStateType>
+        void update_rates(const VectorStateType & mole_concentrations);
+
         //! to avoid antioch long calculations
         template <typename VectorStateType, typename MatrixStateType>
         void compute_sources_and_jacob(VectorStateType & mole_sources, MatrixStateType & dmole_dX_s) const;
@@ -84,6 +151,9 @@ namespace Planet
         //! gives a first approximation if needed
         void first_approximation();
 
+        //!\return electron density, sum of the ions if the electron is not in the system
+        CoeffType electron_density() const;
+
         //! final calculations for output, only sources here
         template <typename VectorStateType>
         void compute_full_sources(VectorStateType & mole_sources) const;
@@ -93,16 +163,23 @@ namespace Planet
         template <typename VectorStateType, typename MatrixStateType>
         void compute_full_sources_and_derivs(VectorStateType &mole_sources, MatrixStateType &dmole_dX_s);
 
+        //! sources, jacobian and closure at the current ions densities
+        //!\return l1 norm of the ionic sources
+        CoeffType newton_residual();
+
         //! Newton solver here
         bool solve();
 
       public:
 
+        //! builds and owns its mechanism
         AtmosphericSteadyState(const std::vector<Antioch::Species> &ss_species, Antioch::KineticsEvaluator<CoeffType> &reactions_system);
+        //! workspace on a shared mechanism, which must outlive it
+        AtmosphericSteadyState(const SteadyStateMechanism<CoeffType> &mechanism);
         ~AtmosphericSteadyState();
 
-        //! 
-        void build_map();
+        //!\return the mechanism
+        const SteadyStateMechanism<CoeffType> & mechanism() const;
 
         //! caches updated rate constants
         template <typename StateType, typename VectorStateType>
@@ -111,6 +188,20 @@ namespace Planet
                               const StateType & T_ions,
                               const StateType & T_electrons);
 
+        //! caches updated rate constants, the rate constants at the altitude \p z are kept for the next calls
+        template <typename StateType, typename VectorStateType>
+        void precompute_rates(const VectorStateType & mole_concentrations, 
+                              const Antioch::KineticsConditions<StateType> & KC,
+                              const StateType & T_ions,
+                              const StateType & T_electrons,
+                              const StateType & z);
+
+        //! forgets the stored rate constants, to be called when the rate parameters change
+        void clear_rate_cache();
+
+        //!\return rate constants stored by altitude
+        const RateConstantCache<CoeffType,VectorCoeffType> & rate_cache() const;
+
         //! Newton solver
         template <typename VectorStateType>
         bool steady_state(VectorStateType & mole_sources);
@@ -119,114 +210,225 @@ namespace Planet
         template <typename VectorStateType, typename MatrixStateType>
         bool steady_state_and_derivs(VectorStateType & mole_sources, MatrixStateType & drate_dn);
 
+        //! Newton solver, warm started by the solution at the altitude \p z, which is then stored
+        template <typename StateType, typename VectorStateType>
+        bool steady_state(VectorStateType & mole_sources, const StateType & z);
+
+        //! Newton solver, warm started by the solution at the altitude \p z, which is then stored
+        template <typename StateType, typename VectorStateType, typename MatrixStateType>
+        bool steady_state_and_derivs(VectorStateType & mole_sources, MatrixStateType & drate_dn, const StateType & z);
+
+        //! altitudes closer than \p dz share their warm start
+        void set_warm_start_tolerance(const CoeffType & dz);
+
+        //! forgets the stored solutions
+        void clear_warm_start();
+
+        //!\return number of altitudes stored
+        unsigned int n_warm_start() const;
+
+        //! at most \p n altitudes in the warm start store and in the rate constant cache
+        void set_altitude_store_size(unsigned int n);
+
+        //!\return steady state densities of the last solve, ionic system indices
+        const VectorCoeffType & molar_concentrations() const;
+
+        //!\return rate constants of the last precompute_rates() call
+        const VectorCoeffType & rate_constants() const;
+
+        //!\return number of Newton iterations of the last solve
+        unsigned int newton_iterations() const;
+
+        //! maximum number of Newton iterations, 20 by default
+        void set_newton_max_iterations(unsigned int max_iterations);
+
+        //! tolerance on the ionic sources and on the Newton increment
+        void set_newton_tolerance(const CoeffType & tol);
+
+        //!\return tolerance of the Newton solve
+        const CoeffType & newton_tolerance() const;
+
+        //! maximum number of step halvings of the line search, 0 for full Newton steps
+        void set_newton_max_backtracks(unsigned int max_backtracks);
+
+        //!\return l1 norm of the ionic sources at each iterate of the last solve
+        const std::vector<CoeffType> & newton_residuals() const;
+
+        //!\return number of solves since the last reset
+        unsigned int n_solves() const;
+
+        //!\return number of failed solves since the last reset
+        unsigned int n_failures() const;
+
+        //!\return number of Newton iterations since the last reset
+        unsigned int total_newton_iterations() const;
+
+        //!\return number of step halvings since the last reset
+        unsigned int n_backtracks() const;
+
+        //!\return number of solves stopped by the line search at its smallest step since the last reset
+        unsigned int n_stalls() const;
+
+        //!\return true if the last solve was stopped by the line search at its smallest step
+        bool stalled() const;
+
+        //!\return altitudes of the failed solves since the last reset, warm started solves only
+        const std::vector<CoeffType> & failure_altitudes() const;
+
+        //! zeroes the counters, forgets the failure altitudes
+        void reset_newton_statistics();
+
+        /*! sparse LU on the fixed jacobian pattern (default), only the
+         *  numerical factorization is done at each Newton iteration,
+         *  or dense partial pivoting LU
+         */
+        void set_sparse_solver(bool sparse);
+
+        //!\return true if the Newton solve uses the sparse LU
+        bool sparse_solver() const;
+
+        //!\return number of stored values of the sparse jacobian
+        unsigned int jacobian_non_zeros() const;
+
   };
 
 
+// rate constant of a reaction, DR use the electronic temperature
+// TODO how can we generalize the temperature specialization?
   template <typename CoeffType, typename VectorCoeffType>
+  template <typename StateType, typename VectorStateType>
   inline
-  void AtmosphericSteadyState<CoeffType,VectorCoeffType>::build_map()
+  StateType AtmosphericSteadyState<CoeffType,VectorCoeffType>::rate_constant(unsigned int rxn,
+                                                                             const VectorStateType & mole_concentrations,
+                                                                             const Antioch::KineticsConditions<StateType> & KC, //T_neutral & photochemistry as of now
+                                                                             const StateType & T_electrons) const
   {
-     const Antioch::ChemicalMixture<CoeffType> & mixture = _reactions_system.reaction_set().chemical_mixture();
-     for(unsigned int s = 0; s < _ss_species.size(); s++)
-     {
-         _ionic_inverse_map[s] = mixture.species_list()[_ss_species[s]];
-         _ionic_map[mixture.species_list()[_ss_species[s]]] = s;
-     }
+     const Antioch::Reaction<CoeffType> & reaction = _mechanism.reaction_set().reaction(rxn);
+//TODO separate the different kind of reactions in a better way
+     return (reaction.kinetics_model() == Antioch::KineticsModel::HERCOURT_ESSEN)?
+                    reaction.compute_forward_rate_coefficient( mole_concentrations, KC):   // any reaction that is not a DR
+                    reaction.compute_forward_rate_coefficient( mole_concentrations, Antioch::KineticsConditions<StateType>(T_electrons)); // DR
   }
 
-// this will calculate the rate constant and multiply by the neutral concentrations
+// this will multiply the rate constants by the neutral concentrations
 // these values won't change, so no recomputing during the loop
-// TODO how can we generalize the temperature specialization?
   template <typename CoeffType, typename VectorCoeffType>
-  template <typename StateType, typename VectorStateType>
+  template <typename VectorStateType>
   inline
-  void AtmosphericSteadyState<CoeffType,VectorCoeffType>::precompute_rates(const VectorStateType & mole_concentrations,
-                                                                           const Antioch::KineticsConditions<StateType> & KC, //T_neutral & photochemistry as of now
-                                                                           const StateType & T_ions,
-                                                                           const StateType & T_electrons)
+  void AtmosphericSteadyState<CoeffType,VectorCoeffType>::update_rates(const VectorStateType & mole_concentrations)
   {
-    Antioch::set_zero(_updated_rates);
-    Antioch::set_zero(_rates);
+    const ReactionTopology & neutral_reactants = _mechanism.neutral_reactants();
 
     _mole_concentrations = mole_concentrations;
 
-    // compute the requisite reaction rates
-    for(unsigned int rxn = 0; rxn < _reactions_system.n_reactions(); rxn++)
+    for(unsigned int rxn = 0; rxn < _mechanism.n_reactions(); rxn++)
     {
-       const Antioch::Reaction<CoeffType> & reaction = _reactions_system.reaction_set().reaction(rxn);
-       StateType kfwd;
-       Antioch::set_zero(kfwd);
-//TODO separate the different kind of reactions in a better way
-        kfwd = (reaction.kinetics_model() == Antioch::KineticsModel::HERCOURT_ESSEN)?
-                    reaction.compute_forward_rate_coefficient( mole_concentrations, KC):   // any reaction that is not a DR
-                    reaction.compute_forward_rate_coefficient( mole_concentrations, Antioch::KineticsConditions<StateType>(T_electrons)); // DR
-
-       _updated_rates[rxn] = kfwd;
-       _rates[rxn] = kfwd;
+       _updated_rates[rxn] = _rates[rxn];
        // adding neutral contribution, updating
        // update with neutral concentrations
-       for (unsigned int r=0; r< reaction.n_reactants(); r++)
+       for (unsigned int r = neutral_reactants.ptr[rxn]; r < neutral_reactants.ptr[rxn + 1]; r++)
        {
-          if(!_ionic_map.count(reaction.reactant_id(r)))
-          {
-             _updated_rates[rxn] *= Antioch::ant_pow( mole_concentrations[reaction.reactant_id(r)],
-                                              static_cast<int>(reaction.reactant_stoichiometric_coefficient(r)) );
-          }
-        }
+          _updated_rates[rxn] *= Antioch::ant_pow( mole_concentrations[neutral_reactants.species[r]],
+                                                   static_cast<int>(neutral_reactants.stoi[r]) );
+       }
     }
     return;
   }
 
+  template <typename CoeffType, typename VectorCoeffType>
+  template <typename StateType, typename VectorStateType>
+  inline
+  void AtmosphericSteadyState<CoeffType,VectorCoeffType>::precompute_rates(const VectorStateType & mole_concentrations,
+                                                                           const Antioch::KineticsConditions<StateType> & KC,
+                                                                           const StateType & /*T_ions*/,
+                                                                           const StateType & T_electrons)
+  {
+    // compute the requisite reaction rates
+    for(unsigned int rxn = 0; rxn < _mechanism.n_reactions(); rxn++)
+    {
+       _rates[rxn] = this->rate_constant(rxn,mole_concentrations,KC,T_electrons);
+    }
 
+    this->update_rates(mole_concentrations);
+
+    return;
+  }
 
   template <typename CoeffType, typename VectorCoeffType>
+  template <typename StateType, typename VectorStateType>
   inline
-  void AtmosphericSteadyState<CoeffType, VectorCoeffType>::first_approximation()
+  void AtmosphericSteadyState<CoeffType,VectorCoeffType>::precompute_rates(const VectorStateType & mole_concentrations,
+                                                                           const Antioch::KineticsConditions<StateType> & KC,
+                                                                           const StateType & /*T_ions*/,
+                                                                           const StateType & T_electrons,
+                                                                           const StateType & z)
   {
+    // rate constants of the temperatures alone are computed at the first visit of z
+    const VectorCoeffType * rate_constants = _rate_cache.find(z,KC.T(),T_electrons);
+    if(!rate_constants)
+    {
+       VectorCoeffType & stored = _rate_cache.insert(z,KC.T(),T_electrons);
+       for(unsigned int rxn = 0; rxn < _mechanism.n_reactions(); rxn++)
+       {
+          if(_rate_cache.cacheable(rxn))stored[rxn] = this->rate_constant(rxn,mole_concentrations,KC,T_electrons);
+       }
+       rate_constants = &stored;
+    }
+
+    for(unsigned int rxn = 0; rxn < _mechanism.n_reactions(); rxn++)
+    {
+       _rates[rxn] = (_rate_cache.cacheable(rxn))?(*rate_constants)[rxn]:
+                                                  this->rate_constant(rxn,mole_concentrations,KC,T_electrons);
+    }
+
+    this->update_rates(mole_concentrations);
 
-   const Antioch::ChemicalMixture<CoeffType> & mixture = _reactions_system.reaction_set().chemical_mixture();
+    return;
+  }
+
+
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  void AtmosphericSteadyState<CoeffType, VectorCoeffType>::first_approximation()
+  {
+    const unsigned int n_ss = _mechanism.n_ss_species();
+    const ReactionTopology & ss_reactants = _mechanism.ss_reactants();
+    const ReactionTopology & ss_products = _mechanism.ss_products();
 
 //all ions to 0
     Antioch::set_zero(_molar_concentrations);
 
 //first approx C_i = prod_i / (dloss_dCi) = kfwd_const * fwd_conc / (kfwd_const * conc_{no ss species}) ~ updated_rates_fwd / updated_rate_bkwd
-    VectorCoeffType sum_forward;
-    VectorCoeffType sum_backward;
-    sum_forward.resize(_ss_species.size());
-    sum_backward.resize(_ss_species.size());
-    Antioch::set_zero(sum_forward);
-    Antioch::set_zero(sum_backward);
+    Antioch::set_zero(_sum_forward);
+    Antioch::set_zero(_sum_backward);
     for(unsigned int rxn = 0; rxn < _updated_rates.size(); rxn++)
     {
 //prod
-       const Antioch::Reaction<CoeffType>& reaction = _reactions_system.reaction_set().reaction(rxn);
-
-       for (unsigned int p=0; p<reaction.n_products(); p++)
+       for (unsigned int p = ss_products.ptr[rxn]; p < ss_products.ptr[rxn + 1]; p++)
        {
-         if(!_ionic_map.count(reaction.product_id(p)))continue;
-         sum_forward[_ionic_map[reaction.product_id(p)]] += _updated_rates[rxn];
+         _sum_forward[ss_products.species[p]] += _updated_rates[rxn];
        }
 
 // loss
-       for (unsigned int r=0; r<reaction.n_reactants(); r++)
+       for (unsigned int r = ss_reactants.ptr[rxn]; r < ss_reactants.ptr[rxn + 1]; r++)
        {
-         if(!_ionic_map.count(reaction.reactant_id(r)))continue;
-         sum_backward[_ionic_map[reaction.reactant_id(r)]] += _updated_rates[rxn];
-        }
+         _sum_backward[ss_reactants.species[r]] += _updated_rates[rxn];
+       }
      }
 
      CoeffType sum;
      Antioch::set_zero(sum);
-     unsigned int s_electron(_ionic_map.at(mixture.species_name_map().at("e")));
+     const unsigned int s_electron(_mechanism.s_electron());
      const CoeffType tol = std::numeric_limits<CoeffType>::epsilon() * 100.L;
-     for(unsigned int ss = 0; ss < _ss_species.size(); ss++)
+     for(unsigned int ss = 0; ss < n_ss; ss++)
      {
        if(ss == s_electron)continue;
-       if(sum_backward[ss] > tol && sum_forward[ss] > tol)
-          _molar_concentrations[ss] = Antioch::ant_sqrt(sum_forward[ss] / sum_backward[ss]);
+       if(_sum_backward[ss] > tol && _sum_forward[ss] > tol)
+          _molar_concentrations[ss] = Antioch::ant_sqrt(_sum_forward[ss] / _sum_backward[ss]);
         sum += _molar_concentrations[ss];
      }
-     _molar_concentrations[s_electron] = sum;
+     if(s_electron < n_ss)_molar_concentrations[s_electron] = sum;
 
 //beurk, comparison to zero
 //TODO find something better than comparing a real number to zero
@@ -245,13 +447,15 @@ namespace Planet
   void AtmosphericSteadyState<CoeffType,VectorCoeffType>::bring_me_closure(VectorSolveType & deriv,
                                                                            MatrixSolveType & jacob) const
   {
-        const Antioch::ChemicalMixture<CoeffType> & mixture = _reactions_system.reaction_set().chemical_mixture();
-
+    const unsigned int n_ss = _mechanism.n_ss_species();
 // neutral atmosphere approximation: [e] = sum [ions]
+        const unsigned int s_electron(_mechanism.s_electron());
+// no electron, the ionic balance alone
+        if(s_electron == n_ss)return;
+
         CoeffType sum;
         Antioch::set_zero(sum);
-        unsigned int s_electron(_ionic_map.at(mixture.species_name_map().at("e")));
-        for(unsigned int s = 0; s < _ss_species.size(); s++)
+        for(unsigned int s = 0; s < n_ss; s++)
         {
            if(s == s_electron)continue;
            jacob[s_electron][s] = 1.L;
@@ -263,6 +467,23 @@ namespace Planet
         return;
   }
 
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  CoeffType AtmosphericSteadyState<CoeffType,VectorCoeffType>::electron_density() const
+  {
+    const unsigned int n_ss = _mechanism.n_ss_species();
+    const unsigned int s_electron(_mechanism.s_electron());
+    if(s_electron < n_ss)return _molar_concentrations[s_electron];
+
+    CoeffType sum;
+    Antioch::set_zero(sum);
+    for(unsigned int s = 0; s < n_ss; s++)
+    {
+       sum += _molar_concentrations[s];
+    }
+    return sum;
+  }
+
 
 //this will do the second par of Antioch::KineticsEvaluator<CoeffType,StateType>::compute_mole_sources_and_derivs()
   template <typename CoeffType, typename VectorCoeffType>
@@ -271,92 +492,77 @@ namespace Planet
   void AtmosphericSteadyState<CoeffType,VectorCoeffType>::compute_sources_and_jacob(VectorStateType & molar_sources,
                                                                                     MatrixStateType & dmolar_dX_s) const
   {
+    const unsigned int n_ss = _mechanism.n_ss_species();
+    const ReactionTopology & ss_reactants = _mechanism.ss_reactants();
+    const ReactionTopology & ss_products = _mechanism.ss_products();
 
 //initialization
     Antioch::set_zero(molar_sources);
-    for(unsigned int ss = 0; ss < _ss_species.size(); ss++)
+    for(unsigned int ss = 0; ss < n_ss; ss++)
     {
        Antioch::set_zero(dmolar_dX_s[ss]);
     }
 
-    for(unsigned int rxn = 0; rxn < _reactions_system.reaction_set().n_reactions(); rxn++)
+    for(unsigned int rxn = 0; rxn < _updated_rates.size(); rxn++)
     {
+        const unsigned int r_begin = ss_reactants.ptr[rxn];
+        const unsigned int r_end   = ss_reactants.ptr[rxn + 1];
 
-        const Antioch::Reaction<CoeffType> & reac = _reactions_system.reaction_set().reaction(rxn);
-
-        VectorStateType dRfwd_dX_s(reac.n_species(), 0.L);
         CoeffType facfwd(1.L);
     
         // pre-fill the participating species partials with the updated rates
-        for (unsigned int r=0; r< reac.n_reactants(); r++)
+        for (unsigned int r = r_begin; r < r_end; r++)
         {
-             if(!_ionic_map.count(reac.reactant_id(r)))continue;
-
-                dRfwd_dX_s[_ionic_map.at(reac.reactant_id(r))] = _updated_rates[rxn];
+           _dRfwd_dX[r - r_begin] = _updated_rates[rxn];
         }
            // product of concentrations and derivatives term
-        for (unsigned int ro=0; ro < reac.n_reactants(); ro++)
+        for (unsigned int ro = r_begin; ro < r_end; ro++)
         {
 //we consider only the ions
-           if(!_ionic_map.count(reac.reactant_id(ro)))continue;
+           const int stoi = static_cast<int>(ss_reactants.stoi[ro]);
 
-           const CoeffType val = 
-                Antioch::ant_pow(_molar_concentrations[_ionic_map.at(reac.reactant_id(ro))],
-                                 static_cast<int>(reac.reactant_stoichiometric_coefficient(ro)) );
+           const CoeffType val = Antioch::ant_pow(_molar_concentrations[ss_reactants.species[ro]], stoi);
 
            facfwd *= val;
 
-           const CoeffType dval = 
-                 ( static_cast<CoeffType>(reac.reactant_stoichiometric_coefficient(ro))*
-                Antioch::ant_pow(_molar_concentrations[_ionic_map.at(reac.reactant_id(ro))],
-                                 static_cast<int>(reac.reactant_stoichiometric_coefficient(ro))-1 ) 
-                );
+           const CoeffType dval = static_cast<CoeffType>(stoi) * Antioch::ant_pow(_molar_concentrations[ss_reactants.species[ro]], stoi - 1);
 
-           for (unsigned int ri=0; ri<reac.n_reactants(); ri++)
+           for (unsigned int ri = r_begin; ri < r_end; ri++)
            {
-              if(!_ionic_map.count(reac.reactant_id(ri)))continue;
-
-              dRfwd_dX_s[_ionic_map.at(reac.reactant_id(ri))] *= (ri == ro) ? dval : val;
+              _dRfwd_dX[ri - r_begin] *= (ri == ro) ? dval : val;
            }
          }
 
         /// calculate now sources and derivatives
 
         // reactants contributions
-        for (unsigned int r = 0; r < reac.n_reactants(); r++)
+        for (unsigned int r = r_begin; r < r_end; r++)
           {
-            if(!_ionic_map.count(reac.reactant_id(r)))continue;
-
-            const unsigned int s_id = _ionic_map.at(reac.reactant_id(r));
-            const unsigned int r_stoich = reac.reactant_stoichiometric_coefficient(r);
+            const unsigned int s_id = ss_reactants.species[r];
+            const CoeffType r_stoich = static_cast<CoeffType>(ss_reactants.stoi[r]);
             
             // d/dX_s rate contributions, no need to consider other species than reactants
-            for (unsigned int rr=0; rr < reac.n_reactants(); rr++)
+            for (unsigned int rr = r_begin; rr < r_end; rr++)
               {
-                if(!_ionic_map.count(reac.reactant_id(rr)))continue;
-                unsigned int s = _ionic_map.at(reac.reactant_id(rr));
-                dmolar_dX_s[s_id][s] -= (static_cast<CoeffType>(r_stoich) * dRfwd_dX_s[s]);
+                dmolar_dX_s[s_id][ss_reactants.species[rr]] -= r_stoich * _dRfwd_dX[rr - r_begin];
               }
             // sources, loss term
-            molar_sources[_ionic_map.at(reac.reactant_id(r))] -= static_cast<CoeffType>(r_stoich) * facfwd * _updated_rates[rxn];
+            molar_sources[s_id] -= r_stoich * facfwd * _updated_rates[rxn];
           }
         
         // product contributions
-        for (unsigned int p=0; p < reac.n_products(); p++)
+        for (unsigned int p = ss_products.ptr[rxn]; p < ss_products.ptr[rxn + 1]; p++)
           {
-            if(!_ionic_map.count(reac.product_id(p)))continue;
-            const unsigned int s_id = _ionic_map.at(reac.product_id(p));
-            const unsigned int p_stoich = reac.product_stoichiometric_coefficient(p);
+            const unsigned int s_id = ss_products.species[p];
+            const CoeffType p_stoich = static_cast<CoeffType>(ss_products.stoi[p]);
             
             // d/dX_s rate contributions, no need to consider other species than reactants
-            for (unsigned int r=0; r < reac.n_reactants(); r++)
+            for (unsigned int r = r_begin; r < r_end; r++)
               {
-                if(!_ionic_map.count(reac.reactant_id(r)))continue;
-                unsigned int s = _ionic_map.at(reac.reactant_id(r));
-                dmolar_dX_s[s_id][s] += (static_cast<CoeffType>(p_stoich) * dRfwd_dX_s[s]);
+                dmolar_dX_s[s_id][ss_reactants.species[r]] += p_stoich * _dRfwd_dX[r - r_begin];
               }
             // sources, prod term
-            molar_sources[_ionic_map.at(reac.product_id(p))] += static_cast<CoeffType>(p_stoich) * facfwd * _updated_rates[rxn];
+            molar_sources[s_id] += p_stoich * facfwd * _updated_rates[rxn];
           }
     }
         
@@ -368,35 +574,34 @@ namespace Planet
   inline
   void AtmosphericSteadyState<CoeffType,VectorCoeffType>::compute_full_sources(VectorStateType & mole_sources) const
   {
-    for(unsigned int rxn = 0; rxn < _reactions_system.reaction_set().n_reactions(); rxn++)
+    const ReactionTopology & ss_reactants = _mechanism.ss_reactants();
+    const ReactionTopology & reactants = _mechanism.reactants();
+    const ReactionTopology & products = _mechanism.products();
+    for(unsigned int rxn = 0; rxn < _updated_rates.size(); rxn++)
     {
-        const Antioch::Reaction<CoeffType> & reac = _reactions_system.reaction_set().reaction(rxn);
-
         CoeffType facfwd(1.L);
 
         // product of concentrations, only ions are missing
-        for (unsigned int r = 0; r < reac.n_reactants(); r++)
+        for (unsigned int r = ss_reactants.ptr[rxn]; r < ss_reactants.ptr[rxn + 1]; r++)
           {
-            if(_ionic_map.count(reac.reactant_id(r)))
-                                facfwd *= Antioch::ant_pow(_molar_concentrations[_ionic_map.at(reac.reactant_id(r))],
-                                          static_cast<int>(reac.reactant_stoichiometric_coefficient(r)) );
+            facfwd *= Antioch::ant_pow(_molar_concentrations[ss_reactants.species[r]],
+                                       static_cast<int>(ss_reactants.stoi[r]) );
           }
 
+        const CoeffType rate = facfwd * _updated_rates[rxn];
 
         // reactants contributions
-        for (unsigned int r = 0; r < reac.n_reactants(); r++)
+        for (unsigned int r = reactants.ptr[rxn]; r < reactants.ptr[rxn + 1]; r++)
           {
-            const unsigned int r_stoich = reac.reactant_stoichiometric_coefficient(r);
             // sources, loss term
-            mole_sources[reac.reactant_id(r)] -= static_cast<CoeffType>(r_stoich) * facfwd * _updated_rates[rxn];
+            mole_sources[reactants.species[r]] -= static_cast<CoeffType>(reactants.stoi[r]) * rate;
           }
         
         // product contributions
-        for (unsigned int p=0; p < reac.n_products(); p++)
+        for (unsigned int p = products.ptr[rxn]; p < products.ptr[rxn + 1]; p++)
           {
-            const unsigned int p_stoich = reac.product_stoichiometric_coefficient(p);
             // sources, prod term
-            mole_sources[reac.product_id(p)] += static_cast<CoeffType>(p_stoich) * facfwd * _updated_rates[rxn];
+            mole_sources[products.species[p]] += static_cast<CoeffType>(products.stoi[p]) * rate;
           }
     }
   }
@@ -406,162 +611,219 @@ namespace Planet
   inline
   void AtmosphericSteadyState<CoeffType,VectorCoeffType>::compute_full_sources_and_derivs(VectorStateType &mole_sources, MatrixStateType &dmole_dX_s)
   {
+    const unsigned int n_ss = _mechanism.n_ss_species();
+    const ReactionTopology & reactants = _mechanism.reactants();
+    const ReactionTopology & products = _mechanism.products();
+    const std::vector<unsigned int> & ss_to_species = _mechanism.ss_to_species();
 //initialization
     Antioch::set_zero(mole_sources);
-    for(unsigned int ss = 0; ss < _ss_species.size(); ss++)
+    for(unsigned int ss = 0; ss < n_ss; ss++)
     {
        Antioch::set_zero(dmole_dX_s[ss]);
-       _mole_concentrations[_ionic_inverse_map.at(ss)] = _molar_concentrations[ss];
+       _mole_concentrations[ss_to_species[ss]] = _molar_concentrations[ss];
     }
 
-    for(unsigned int rxn = 0; rxn < _reactions_system.reaction_set().n_reactions(); rxn++)
+    for(unsigned int rxn = 0; rxn < _rates.size(); rxn++)
     {
+        const unsigned int r_begin = reactants.ptr[rxn];
+        const unsigned int r_end   = reactants.ptr[rxn + 1];
 
-        const Antioch::Reaction<CoeffType> & reac = _reactions_system.reaction_set().reaction(rxn);
-
-        VectorStateType dRfwd_dX_s(reac.n_species(), 0.L);
         CoeffType facfwd(1.L);
     
-        // pre-fill the participating species partials with the updated rates
-        for (unsigned int r=0; r< reac.n_reactants(); r++)
+        // pre-fill the participating species partials with the rates
+        for (unsigned int r = r_begin; r < r_end; r++)
         {
-           dRfwd_dX_s[reac.reactant_id(r)] = _rates[rxn];
+           _dRfwd_dX[r - r_begin] = _rates[rxn];
         }
            // product of concentrations and derivatives term
-        for (unsigned int ro=0; ro < reac.n_reactants(); ro++)
+        for (unsigned int ro = r_begin; ro < r_end; ro++)
         {
-           const CoeffType val = 
-                Antioch::ant_pow(_mole_concentrations[reac.reactant_id(ro)],
-                                 static_cast<int>(reac.reactant_stoichiometric_coefficient(ro)) );
+           const int stoi = static_cast<int>(reactants.stoi[ro]);
+
+           const CoeffType val = Antioch::ant_pow(_mole_concentrations[reactants.species[ro]], stoi);
 
            facfwd *= val;
 
-           const CoeffType dval = 
-                 ( static_cast<CoeffType>(reac.reactant_stoichiometric_coefficient(ro))*
-                Antioch::ant_pow(_mole_concentrations[reac.reactant_id(ro)],
-                                 static_cast<int>(reac.reactant_stoichiometric_coefficient(ro))-1 ) 
-                );
+           const CoeffType dval = static_cast<CoeffType>(stoi) * Antioch::ant_pow(_mole_concentrations[reactants.species[ro]], stoi - 1);
 
-           for (unsigned int ri=0; ri<reac.n_reactants(); ri++)
+           for (unsigned int ri = r_begin; ri < r_end; ri++)
            {
-              dRfwd_dX_s[reac.reactant_id(ri)] *= (ri == ro) ? dval : val;
+              _dRfwd_dX[ri - r_begin] *= (ri == ro) ? dval : val;
            }
          }
 
         /// calculate now sources and derivatives
 
         // reactants contributions
-        for (unsigned int r = 0; r < reac.n_reactants(); r++)
+        for (unsigned int r = r_begin; r < r_end; r++)
           {
-            const unsigned int s_id = reac.reactant_id(r);
-            const unsigned int r_stoich = reac.reactant_stoichiometric_coefficient(r);
+            const unsigned int s_id = reactants.species[r];
+            const CoeffType r_stoich = static_cast<CoeffType>(reactants.stoi[r]);
             
             // d/dX_s rate contributions, no need to consider other species than reactants
-            for (unsigned int rr=0; rr < reac.n_reactants(); rr++)
+            for (unsigned int rr = r_begin; rr < r_end; rr++)
               {
-                unsigned int s = reac.reactant_id(rr);
-                dmole_dX_s[s_id][s] -= (static_cast<CoeffType>(r_stoich) * dRfwd_dX_s[s]);
+                dmole_dX_s[s_id][reactants.species[rr]] -= r_stoich * _dRfwd_dX[rr - r_begin];
               }
             // sources, loss term
-            mole_sources[reac.reactant_id(r)] -= static_cast<CoeffType>(r_stoich) * facfwd * _rates[rxn];
+            mole_sources[s_id] -= r_stoich * facfwd * _rates[rxn];
           }
         
         // product contributions
-        for (unsigned int p=0; p < reac.n_products(); p++)
+        for (unsigned int p = products.ptr[rxn]; p < products.ptr[rxn + 1]; p++)
           {
-            const unsigned int s_id = reac.product_id(p);
-            const unsigned int p_stoich = reac.product_stoichiometric_coefficient(p);
+            const unsigned int s_id = products.species[p];
+            const CoeffType p_stoich = static_cast<CoeffType>(products.stoi[p]);
             
             // d/dX_s rate contributions, no need to consider other species than reactants
-            for (unsigned int r=0; r < reac.n_reactants(); r++)
+            for (unsigned int r = r_begin; r < r_end; r++)
               {
-                unsigned int s = reac.reactant_id(r);
-                dmole_dX_s[s_id][s] += (static_cast<CoeffType>(p_stoich) * dRfwd_dX_s[s]);
+                dmole_dX_s[s_id][reactants.species[r]] += p_stoich * _dRfwd_dX[r - r_begin];
               }
             // sources, prod term
-            mole_sources[reac.product_id(p)] += static_cast<CoeffType>(p_stoich) * facfwd * _rates[rxn];
+            mole_sources[s_id] += p_stoich * facfwd * _rates[rxn];
           }
     }
   }
 
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  CoeffType AtmosphericSteadyState<CoeffType,VectorCoeffType>::newton_residual()
+  {
+      this->compute_sources_and_jacob(_molar_sources,_dmolar_dX_s);
+
+//TODO what are the different options here?
+// neutral hypothesis for the moment   
+      this->bring_me_closure(_molar_sources,_dmolar_dX_s);
+
+      CoeffType res_mol(0.L);
+      for(unsigned int i = 0; i < _mechanism.n_ss_species(); i++)
+      {
+        res_mol += Antioch::ant_abs(_molar_sources[i]);
+      }
+
+      return res_mol;
+  }
+
   template <typename CoeffType, typename VectorCoeffType>
   inline
   bool AtmosphericSteadyState<CoeffType,VectorCoeffType>::solve()
   {
+   const unsigned int n_ss = _mechanism.n_ss_species();
+   if(this->electron_density() < _thresh)first_approximation();
 
-   bool return_flag(true);
-   unsigned int s_electron(_ionic_map.at(_reactions_system.reaction_set().chemical_mixture().species_name_map().at("e")));
-   if(_molar_concentrations[s_electron] < _thresh)first_approximation();
+   _n_solves++;
+   _newton_residuals.clear();
 
 // Newton solver here
 // Ax + b = 0
 // A is jacobian, b is molar sources
-
-//setup, ionic system syzed
-    VectorCoeffType molar_sources;
-    std::vector<VectorCoeffType> dmolar_dX_s;
-
-    molar_sources.resize(_ss_species.size(),0.L);
-    dmolar_dX_s.resize(_ss_species.size());
-    for(unsigned int s=0; s < _ss_species.size();s++)
-    {
-      dmolar_dX_s[s].resize(_ss_species.size(),0.L);
-    }
+// the step is halved until the l1 norm of the sources decreases (Armijo),
+// a density going negative is divided by ten instead.
+// Converged on the sources or on the undamped Newton step, stalled
+// if the smallest step does not decrease the sources
 
 // shoot
-    CoeffType lim(1.L);
-    CoeffType res_mol(0.L);
-    const unsigned int loop_max(20);
+    CoeffType step(1.L);
+    CoeffType res_mol = this->newton_residual();
     unsigned int nloop(0);
+    bool converged(false);
+    _stalled = false;
 
-    while(lim > _thresh && nloop < loop_max)
+    while(true)
     {
+      _newton_residuals.push_back(res_mol);
+      if(!(boost::math::isfinite)(res_mol))break; //nan or inf
+      if(res_mol < _thresh || step < _thresh)
+      {
+        converged = true;
+        break;
+      }
+      if(_stalled)break;
+      if(nloop >= _newton_max_iterations)break;
 
-      this->compute_sources_and_jacob(molar_sources,dmolar_dX_s);
-
-//TODO what are the different options here?
-// neutral hypothesis for the moment   
-      this->bring_me_closure(molar_sources,dmolar_dX_s);
+      for(unsigned int i = 0; i < n_ss; i++)
+      {
+        b(i) = - _molar_sources[i]; // - first derivative
+      }
 
-      Antioch::set_zero(res_mol);
-      for(unsigned int i = 0; i < _ss_species.size(); i++)
+      bool factorized(false);
+      if(_sparse)
       {
-        for(unsigned int j = 0; j < _ss_species.size(); j++)
+        // numerical factorization only, on the analyzed pattern
+        const std::vector<std::pair<unsigned int,unsigned int> > & entries = _mechanism.sparse_entries();
+        CoeffType * values = _sparse_jacobian.valuePtr();
+        for(unsigned int k = 0; k < entries.size(); k++)
         {
-           A(i,j) = dmolar_dX_s[i][j]; //Jacobian
+           values[k] = _dmolar_dX_s[entries[k].first][entries[k].second]; //Jacobian
         }
-        b(i) = - molar_sources[i]; // - first derivative
-        res_mol += Antioch::ant_abs(molar_sources[i]);
+        _sparse_lu.factorize(_sparse_jacobian);
+        factorized = (_sparse_lu.info() == Eigen::Success);
+        if(factorized)x = _sparse_lu.solve(b);
       }
-      if(res_mol < _thresh)break;
 
-      Eigen::PartialPivLU<Eigen::Matrix<CoeffType,Eigen::Dynamic,Eigen::Dynamic> > mypartialPivLu(A);
-      Eigen::Matrix<CoeffType,Eigen::Dynamic,1> x(_ss_species.size());
-      x = mypartialPivLu.solve(b);
+      // dense path, or sparse numerically singular
+      if(!factorized)
+      {
+        for(unsigned int i = 0; i < n_ss; i++)
+        {
+          for(unsigned int j = 0; j < n_ss; j++)
+          {
+             A(i,j) = _dmolar_dX_s[i][j]; //Jacobian
+          }
+        }
+
+        Eigen::PartialPivLU<Eigen::Matrix<CoeffType,Eigen::Dynamic,Eigen::Dynamic> > mypartialPivLu(A);
+        x = mypartialPivLu.solve(b);
+      }
 
-      Antioch::set_zero(lim);
-      for(unsigned int s = 0; s < _ss_species.size(); s++)
+      // undamped increment
+      Antioch::set_zero(step);
+      for(unsigned int s = 0; s < n_ss; s++)
       {
-        _molar_concentrations[s]  += x(s);
-        if(_molar_concentrations[s] < 0.)Antioch::set_zero(_molar_concentrations[s]);
-        lim += Antioch::ant_abs(x(s)); //absolute increment
+        step += Antioch::ant_abs(x(s));
       }
 
-      nloop++;
-      if(nloop > loop_max || _molar_concentrations[s_electron] < _thresh || !(boost::math::isfinite)(lim)) //nan or inf
+      // line search
+      _newton_start = _molar_concentrations;
+      CoeffType alpha(1.L);
+      for(unsigned int bt = 0; ; bt++)
       {
-/*        std::cerr << "Newton solver failed after " << nloop << "/" << loop_max
-                  << " loops with a residual of " << lim
-                  << ", a molar source total of " << res_mol
-                  << " and a tolerance of " << _thresh << std::endl;*/
-       // antioch_error();
-        Antioch::set_zero(_molar_concentrations);
-        return_flag = false;
-        break;
+        for(unsigned int s = 0; s < n_ss; s++)
+        {
+          _molar_concentrations[s] = _newton_start[s] + alpha * x(s);
+          if(_molar_concentrations[s] < 0.)_molar_concentrations[s] = _newton_start[s] * 0.1L;
+        }
+
+        const CoeffType res_trial = this->newton_residual();
+        const bool decrease = (boost::math::isfinite)(res_trial) && res_trial <= (1.L - 1e-4L * alpha) * res_mol;
+        if(decrease || bt >= _newton_max_backtracks)
+        {
+          // smallest step without decrease, full Newton steps are always taken
+          if(!decrease && _newton_max_backtracks > 0)_stalled = true;
+          res_mol = res_trial;
+          break;
+        }
+        alpha *= 0.5L;
+        _n_backtracks++;
       }
 
+      nloop++;
     } //solver loop
-    return return_flag;
+
+    _newton_iterations = nloop;
+    _total_newton_iterations += nloop;
+
+    if(_stalled && !converged)_n_stalls++;
+
+    if(!converged || this->electron_density() < _thresh)
+    {
+       Antioch::set_zero(_molar_concentrations);
+       _n_failures++;
+       return false;
+    }
+
+    return true;
 
   }
 
@@ -590,34 +852,363 @@ namespace Planet
     return flag;
   }
 
+  template <typename CoeffType, typename VectorCoeffType>
+  template <typename StateType, typename VectorStateType>
+  inline
+  bool AtmosphericSteadyState<CoeffType,VectorCoeffType>::steady_state(VectorStateType & mole_sources, const StateType & z)
+  {
+    this->warm_start(z);
+
+    bool flag(this->steady_state(mole_sources));
+
+    if(flag)
+    {
+       this->store_warm_start(z);
+    }else
+    {
+       _failure_altitudes.push_back(z);
+    }
+
+    return flag;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  template <typename StateType, typename VectorStateType, typename MatrixStateType>
+  inline
+  bool AtmosphericSteadyState<CoeffType,VectorCoeffType>::steady_state_and_derivs(VectorStateType & mole_sources, MatrixStateType & drate_dn, const StateType & z)
+  {
+    this->warm_start(z);
+
+    bool flag(this->steady_state_and_derivs(mole_sources,drate_dn));
+
+    if(flag)
+    {
+       this->store_warm_start(z);
+    }else
+    {
+       _failure_altitudes.push_back(z);
+    }
+
+    return flag;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  void AtmosphericSteadyState<CoeffType,VectorCoeffType>::warm_start(const CoeffType & z)
+  {
+    // closest of the stored altitudes within the tolerance
+    const VectorCoeffType * start = _warm_start.find_near(z,_warm_start_dz);
+    if(start)
+    {
+       _molar_concentrations = *start;
+    }else
+    {
+       this->first_approximation();
+    }
+
+    return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  void AtmosphericSteadyState<CoeffType,VectorCoeffType>::store_warm_start(const CoeffType & z)
+  {
+    // an altitude already stored within the tolerance is overwritten
+    VectorCoeffType * stored = _warm_start.find_near(z,_warm_start_dz);
+    if(stored)
+    {
+       *stored = _molar_concentrations;
+    }else
+    {
+       _warm_start.insert(z) = _molar_concentrations;
+    }
+
+    return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  void AtmosphericSteadyState<CoeffType,VectorCoeffType>::set_warm_start_tolerance(const CoeffType & dz)
+  {
+    _warm_start_dz = dz;
+    return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  void AtmosphericSteadyState<CoeffType,VectorCoeffType>::clear_warm_start()
+  {
+    _warm_start.clear();
+    return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  unsigned int AtmosphericSteadyState<CoeffType,VectorCoeffType>::n_warm_start() const
+  {
+    return _warm_start.size();
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  void AtmosphericSteadyState<CoeffType,VectorCoeffType>::set_altitude_store_size(unsigned int n)
+  {
+    _warm_start.set_capacity(n);
+    _rate_cache.set_capacity(n);
+    return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  const VectorCoeffType & AtmosphericSteadyState<CoeffType,VectorCoeffType>::molar_concentrations() const
+  {
+    return _molar_concentrations;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  const VectorCoeffType & AtmosphericSteadyState<CoeffType,VectorCoeffType>::rate_constants() const
+  {
+    return _rates;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  unsigned int AtmosphericSteadyState<CoeffType,VectorCoeffType>::newton_iterations() const
+  {
+    return _newton_iterations;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  void AtmosphericSteadyState<CoeffType,VectorCoeffType>::set_newton_max_iterations(unsigned int max_iterations)
+  {
+    _newton_max_iterations = max_iterations;
+    return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  void AtmosphericSteadyState<CoeffType,VectorCoeffType>::set_newton_tolerance(const CoeffType & tol)
+  {
+    _thresh = tol;
+    return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  const CoeffType & AtmosphericSteadyState<CoeffType,VectorCoeffType>::newton_tolerance() const
+  {
+    return _thresh;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  void AtmosphericSteadyState<CoeffType,VectorCoeffType>::set_newton_max_backtracks(unsigned int max_backtracks)
+  {
+    _newton_max_backtracks = max_backtracks;
+    return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  const std::vector<CoeffType> & AtmosphericSteadyState<CoeffType,VectorCoeffType>::newton_residuals() const
+  {
+    return _newton_residuals;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  unsigned int AtmosphericSteadyState<CoeffType,VectorCoeffType>::n_solves() const
+  {
+    return _n_solves;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  unsigned int AtmosphericSteadyState<CoeffType,VectorCoeffType>::n_failures() const
+  {
+    return _n_failures;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  unsigned int AtmosphericSteadyState<CoeffType,VectorCoeffType>::total_newton_iterations() const
+  {
+    return _total_newton_iterations;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  unsigned int AtmosphericSteadyState<CoeffType,VectorCoeffType>::n_backtracks() const
+  {
+    return _n_backtracks;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  unsigned int AtmosphericSteadyState<CoeffType,VectorCoeffType>::n_stalls() const
+  {
+    return _n_stalls;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  bool AtmosphericSteadyState<CoeffType,VectorCoeffType>::stalled() const
+  {
+    return _stalled;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  const std::vector<CoeffType> & AtmosphericSteadyState<CoeffType,VectorCoeffType>::failure_altitudes() const
+  {
+    return _failure_altitudes;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  void AtmosphericSteadyState<CoeffType,VectorCoeffType>::reset_newton_statistics()
+  {
+    _n_solves = 0;
+    _n_failures = 0;
+    _total_newton_iterations = 0;
+    _n_backtracks = 0;
+    _n_stalls = 0;
+    _failure_altitudes.clear();
+    return;
+  }
   
   template <typename CoeffType, typename VectorCoeffType>
   inline
   AtmosphericSteadyState<CoeffType,VectorCoeffType>::AtmosphericSteadyState(const std::vector<Antioch::Species> & ss_species, Antioch::KineticsEvaluator<CoeffType> &reactions_system):
-      _reactions_system(reactions_system),
-      _ss_species(ss_species),
-      A(ss_species.size(),ss_species.size()),
-      b(ss_species.size()),
-     _thresh(std::numeric_limits<CoeffType>::epsilon() * 200.)
-  {
-     _updated_rates.resize(_reactions_system.n_reactions(),0.L);
-     _molar_concentrations.resize(_ss_species.size(),-1.L);
-     _rates.resize(_reactions_system.n_reactions(),0.L);
-     _mole_concentrations.resize(reactions_system.n_species(),-1.L);
+      _own_mechanism(new SteadyStateMechanism<CoeffType>(ss_species,reactions_system.reaction_set())),
+      _mechanism(*_own_mechanism),
+      _sparse(true),
+     _thresh(std::numeric_limits<CoeffType>::epsilon() * 200.),
+     _warm_start_dz(1e-6), // km
+     _newton_iterations(0),
+     _newton_max_iterations(20),
+     _newton_max_backtracks(10),
+     _n_solves(0),
+     _n_failures(0),
+     _total_newton_iterations(0),
+     _n_backtracks(0),
+     _n_stalls(0),
+     _stalled(false),
+     _rate_cache(_mechanism.reaction_set())
+  {
+     this->init();
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  AtmosphericSteadyState<CoeffType,VectorCoeffType>::AtmosphericSteadyState(const SteadyStateMechanism<CoeffType> & mechanism):
+      _own_mechanism(NULL),
+      _mechanism(mechanism),
+      _sparse(true),
+     _thresh(std::numeric_limits<CoeffType>::epsilon() * 200.),
+     _warm_start_dz(1e-6), // km
+     _newton_iterations(0),
+     _newton_max_iterations(20),
+     _newton_max_backtracks(10),
+     _n_solves(0),
+     _n_failures(0),
+     _total_newton_iterations(0),
+     _n_backtracks(0),
+     _n_stalls(0),
+     _stalled(false),
+     _rate_cache(_mechanism.reaction_set())
+  {
+     this->init();
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  AtmosphericSteadyState<CoeffType,VectorCoeffType>::~AtmosphericSteadyState()
+  {
+     delete _own_mechanism;
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  void AtmosphericSteadyState<CoeffType,VectorCoeffType>::init()
+  {
+     const unsigned int n_ss = _mechanism.n_ss_species();
+     A.resize(n_ss,n_ss);
+     b.resize(n_ss);
+     x.resize(n_ss);
+     _updated_rates.resize(_mechanism.n_reactions(),0.L);
+     _molar_concentrations.resize(n_ss,-1.L);
+     _molar_sources.resize(n_ss,0.L);
+     _dmolar_dX_s.resize(n_ss);
+     for(unsigned int s = 0; s < n_ss; s++)
+     {
+       _dmolar_dX_s[s].resize(n_ss,0.L);
+     }
+     _newton_start.resize(n_ss,0.L);
+     _sum_forward.resize(n_ss,0.L);
+     _sum_backward.resize(n_ss,0.L);
+     _rates.resize(_mechanism.n_reactions(),0.L);
+     _mole_concentrations.resize(_mechanism.n_species(),-1.L);
+     _dRfwd_dX.resize(_mechanism.max_reactants(),0.L);
 // physically this precision is ridiculous, which is nice
      if(_thresh < 1e-10)_thresh = 1e-10; 
 
-     this->build_map();
+     // own copy of the pattern, the symbolic factorization is done once
+     _sparse_jacobian = _mechanism.sparse_pattern();
+     if(n_ss > 0)_sparse_lu.analyzePattern(_sparse_jacobian);
+
      return;
   }
 
   template <typename CoeffType, typename VectorCoeffType>
   inline
-  AtmosphericSteadyState<CoeffType,VectorCoeffType>::~AtmosphericSteadyState()
+  const SteadyStateMechanism<CoeffType> & AtmosphericSteadyState<CoeffType,VectorCoeffType>::mechanism() const
+  {
+     return _mechanism;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  void AtmosphericSteadyState<CoeffType,VectorCoeffType>::clear_rate_cache()
   {
+     _rate_cache.clear();
      return;
   }
 
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  const RateConstantCache<CoeffType,VectorCoeffType> & AtmosphericSteadyState<CoeffType,VectorCoeffType>::rate_cache() const
+  {
+     return _rate_cache;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  void AtmosphericSteadyState<CoeffType,VectorCoeffType>::set_sparse_solver(bool sparse)
+  {
+     _sparse = sparse;
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  bool AtmosphericSteadyState<CoeffType,VectorCoeffType>::sparse_solver() const
+  {
+     return _sparse;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  unsigned int AtmosphericSteadyState<CoeffType,VectorCoeffType>::jacobian_non_zeros() const
+  {
+     return _sparse_jacobian.nonZeros();
+  }
+
 }
 
 #endif
@@ -0,0 +1,655 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// Planet - An atmospheric code for planetary bodies, adapted to Titan
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+#ifndef PLANET_BATCHED_KINETICS_H
+#define PLANET_BATCHED_KINETICS_H
+
+//Antioch
+#include "antioch/antioch_asserts.h"
+#include "antioch/reaction_set.h"
+#include "antioch/kinetics_conditions.h"
+#include "antioch/cmath_shims.h"
+
+//Planet
+#include "planet/rate_constant_cache.h"
+
+//C++
+#include <vector>
+#include <algorithm>
+#include <iostream>
+
+namespace Planet
+{
+  /*! Neutral chemistry over a batch of points (quadrature points of an
+   *  element, or a column). The densities and the outputs are stored
+   *  points fastest: molar_concentrations[s * n_points + p],
+   *  kin_rates[s * n_points + p], dense jacobian
+   *  dkin_rates_dn[(s * n_species + i) * n_points + p] and sparse jacobian
+   *  values[k * n_points + p], k following jacobian_row_ptr() and jacobian_cols().
+   *
+   *  The reactions are walked once for all the points, the stoichiometry and
+   *  jacobian positions are precompiled at construction, the inner loops run
+   *  over the points. Pressure dependent reactions (three body, falloff)
+   *  keep their rate constant derivatives.
+   *
+   *  Given the altitudes of the points, the rate constants depending on
+   *  the temperature alone are stored by altitude (RateConstantCache) and
+   *  computed only at the first visit of the altitude.
+   *
+   *  Only forward rates are computed, reversible reactions are an error.
+   */
+  template <typename CoeffType, typename VectorCoeffType = std::vector<CoeffType> >
+  class BatchedKinetics
+  {
+      public:
+
+        BatchedKinetics(const Antioch::ReactionSet<CoeffType> &reaction_set, unsigned int n_points);
+        ~BatchedKinetics();
+
+        //! resizes the batch
+        void set_n_points(unsigned int n_points);
+
+        //!\return number of points of the batch
+        unsigned int n_points() const;
+
+        //!\return number of species
+        unsigned int n_species() const;
+
+        //!\return number of stored values of the sparse jacobian, per point
+        unsigned int jacobian_non_zeros() const;
+
+        //!\return row pointer of the sparse jacobian (CSR)
+        const std::vector<unsigned int> & jacobian_row_ptr() const;
+
+        //!\return column of the stored values of the sparse jacobian (CSR)
+        const std::vector<unsigned int> & jacobian_cols() const;
+
+        //! net chemical rates of all the points, one condition per point
+        template <typename StateType, typename VectorStateType>
+        void mole_sources(const std::vector<Antioch::KineticsConditions<StateType> > &conditions,
+                          const VectorStateType &molar_concentrations, VectorStateType &kin_rates);
+
+        //! net chemical rates and dense jacobian of all the points
+        template <typename StateType, typename VectorStateType>
+        void mole_sources_and_derivs(const std::vector<Antioch::KineticsConditions<StateType> > &conditions,
+                                     const VectorStateType &molar_concentrations,
+                                     VectorStateType &kin_rates, VectorStateType &dkin_rates_dn);
+
+        //! net chemical rates and sparse jacobian of all the points
+        template <typename StateType, typename VectorStateType>
+        void mole_sources_and_sparse_derivs(const std::vector<Antioch::KineticsConditions<StateType> > &conditions,
+                                            const VectorStateType &molar_concentrations,
+                                            VectorStateType &kin_rates, VectorStateType &jacobian_values);
+
+        //! net chemical rates of all the points, rate constants stored by altitude \p z
+        template <typename StateType, typename VectorStateType>
+        void mole_sources(const std::vector<Antioch::KineticsConditions<StateType> > &conditions, const VectorStateType &z,
+                          const VectorStateType &molar_concentrations, VectorStateType &kin_rates);
+
+        //! net chemical rates and dense jacobian of all the points, rate constants stored by altitude \p z
+        template <typename StateType, typename VectorStateType>
+        void mole_sources_and_derivs(const std::vector<Antioch::KineticsConditions<StateType> > &conditions, const VectorStateType &z,
+                                     const VectorStateType &molar_concentrations,
+                                     VectorStateType &kin_rates, VectorStateType &dkin_rates_dn);
+
+        //! net chemical rates and sparse jacobian of all the points, rate constants stored by altitude \p z
+        template <typename StateType, typename VectorStateType>
+        void mole_sources_and_sparse_derivs(const std::vector<Antioch::KineticsConditions<StateType> > &conditions, const VectorStateType &z,
+                                            const VectorStateType &molar_concentrations,
+                                            VectorStateType &kin_rates, VectorStateType &jacobian_values);
+
+        //! forgets the stored rate constants, to be called when the rate parameters change
+        void clear_rate_cache();
+
+        //!\return rate constants stored by altitude
+        const RateConstantCache<CoeffType,VectorCoeffType> & rate_cache() const;
+
+        //! at most \p n altitudes in the rate constant cache
+        void set_altitude_store_size(unsigned int n);
+
+      private:
+        //! no default constructor
+        BatchedKinetics();
+
+        //! reactants, participants, pressure dependence
+        void build_topology();
+
+        //! sparse pattern and jacobian positions of every reaction
+        void build_jacobian_positions();
+
+        //! finds or computes the stored rate constants of every point
+        template <typename StateType, typename VectorStateType>
+        void cached_rate_constants(const std::vector<Antioch::KineticsConditions<StateType> > &conditions, const VectorStateType &z);
+
+        //! the sweep, no jacobian if \p jacobian is NULL, no stored rate constants if \p z is NULL
+        template <typename StateType, typename VectorStateType>
+        void sweep(const std::vector<Antioch::KineticsConditions<StateType> > &conditions, const VectorStateType *z,
+                   const VectorStateType &molar_concentrations, VectorStateType &kin_rates,
+                   VectorStateType *jacobian, const std::vector<unsigned int> &position);
+
+        const Antioch::ReactionSet<CoeffType> & _reaction_set;
+        unsigned int                            _n_species;
+        unsigned int                            _n_points;
+
+        // reactants of reaction rxn are from _reactant_ptr[rxn] to _reactant_ptr[rxn + 1] - 1
+        std::vector<unsigned int> _reactant_ptr;
+        std::vector<unsigned int> _reactant_species;
+        std::vector<unsigned int> _reactant_stoi;
+        // reactants then products, signed stoichiometric coefficients
+        std::vector<unsigned int> _participant_ptr;
+        std::vector<unsigned int> _participant_species;
+        VectorCoeffType           _participant_nu;
+        // rate constant depends on the densities
+        std::vector<bool>         _pressure_dependent;
+        unsigned int              _max_reactants;
+
+        // sparse jacobian pattern
+        std::vector<unsigned int> _jac_row_ptr;
+        std::vector<unsigned int> _jac_cols;
+
+        /* jacobian positions of reaction rxn, from _position_ptr[rxn]:
+           (participant, reactant) pairs, then (participant, species) pairs
+           if pressure dependent */
+        std::vector<unsigned int> _position_ptr;
+        std::vector<unsigned int> _dense_position;
+        std::vector<unsigned int> _sparse_position;
+
+        // per point densities for the rate constants, and scratch over the points
+        std::vector<VectorCoeffType> _points;
+        VectorCoeffType              _point_dkfwd_dX;
+        VectorCoeffType              _kfwd;
+        VectorCoeffType              _dkfwd_dX;
+        VectorCoeffType              _concentration_product;
+        VectorCoeffType              _rate;
+        VectorCoeffType              _drate_dX;
+
+        /* rate constants by altitude, and those of the points of the batch
+           copied out of the cache, _point_rate_constants[rxn * n_points + p]:
+           a later insertion of the same batch may drop an altitude already read */
+        RateConstantCache<CoeffType,VectorCoeffType> _rate_cache;
+        VectorCoeffType                              _point_rate_constants;
+  };
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  BatchedKinetics<CoeffType,VectorCoeffType>::BatchedKinetics(const Antioch::ReactionSet<CoeffType> &reaction_set, unsigned int n_points):
+      _reaction_set(reaction_set),
+      _n_species(reaction_set.n_species()),
+      _n_points(0),
+      _max_reactants(0),
+      _rate_cache(reaction_set)
+  {
+     this->build_topology();
+     this->build_jacobian_positions();
+     this->set_n_points(n_points);
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  BatchedKinetics<CoeffType,VectorCoeffType>::~BatchedKinetics()
+  {
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  void BatchedKinetics<CoeffType,VectorCoeffType>::build_topology()
+  {
+     const unsigned int n_reactions = _reaction_set.n_reactions();
+     _reactant_ptr.assign(1,0);
+     _participant_ptr.assign(1,0);
+     _reactant_species.clear();
+     _reactant_stoi.clear();
+     _participant_species.clear();
+     _participant_nu.clear();
+     _pressure_dependent.resize(n_reactions,false);
+     _max_reactants = 0;
+
+     for(unsigned int rxn = 0; rxn < n_reactions; rxn++)
+     {
+        const Antioch::Reaction<CoeffType> & reaction = _reaction_set.reaction(rxn);
+        if(reaction.reversible())
+        {
+           std::cerr << "Error: the batched kinetics has no reverse rates, reaction "
+                     << reaction.equation() << " is reversible" << std::endl;
+           antioch_error();
+        }
+        for(unsigned int r = 0; r < reaction.n_reactants(); r++)
+        {
+           _reactant_species.push_back(reaction.reactant_id(r));
+           _reactant_stoi.push_back(reaction.reactant_stoichiometric_coefficient(r));
+           _participant_species.push_back(reaction.reactant_id(r));
+           _participant_nu.push_back(- static_cast<CoeffType>(reaction.reactant_stoichiometric_coefficient(r)));
+        }
+        for(unsigned int p = 0; p < reaction.n_products(); p++)
+        {
+           _participant_species.push_back(reaction.product_id(p));
+           _participant_nu.push_back(static_cast<CoeffType>(reaction.product_stoichiometric_coefficient(p)));
+        }
+        _reactant_ptr.push_back(_reactant_species.size());
+        _participant_ptr.push_back(_participant_species.size());
+        _max_reactants = std::max(_max_reactants,reaction.n_reactants());
+
+        _pressure_dependent[rxn] = (reaction.type() != Antioch::ReactionType::ELEMENTARY &&
+                                    reaction.type() != Antioch::ReactionType::DUPLICATE);
+     }
+
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  void BatchedKinetics<CoeffType,VectorCoeffType>::build_jacobian_positions()
+  {
+     const unsigned int n_reactions = _reaction_set.n_reactions();
+
+     // pattern, row by row
+     std::vector<std::vector<unsigned int> > rows(_n_species);
+     for(unsigned int rxn = 0; rxn < n_reactions; rxn++)
+     {
+        for(unsigned int a = _participant_ptr[rxn]; a < _participant_ptr[rxn + 1]; a++)
+        {
+           std::vector<unsigned int> & row = rows[_participant_species[a]];
+           if(_pressure_dependent[rxn])
+           {
+              for(unsigned int i = 0; i < _n_species; i++)row.push_back(i);
+           }else
+           {
+              for(unsigned int r = _reactant_ptr[rxn]; r < _reactant_ptr[rxn + 1]; r++)row.push_back(_reactant_species[r]);
+           }
+        }
+     }
+
+     _jac_row_ptr.assign(1,0);
+     _jac_cols.clear();
+     for(unsigned int s = 0; s < _n_species; s++)
+     {
+        std::sort(rows[s].begin(),rows[s].end());
+        rows[s].erase(std::unique(rows[s].begin(),rows[s].end()),rows[s].end());
+        _jac_cols.insert(_jac_cols.end(),rows[s].begin(),rows[s].end());
+        _jac_row_ptr.push_back(_jac_cols.size());
+     }
+
+     // positions, in the order of the sweep
+     _position_ptr.assign(1,0);
+     _dense_position.clear();
+     _sparse_position.clear();
+     for(unsigned int rxn = 0; rxn < n_reactions; rxn++)
+     {
+        for(unsigned int a = _participant_ptr[rxn]; a < _participant_ptr[rxn + 1]; a++)
+        {
+           const unsigned int s = _participant_species[a];
+           for(unsigned int r = _reactant_ptr[rxn]; r < _reactant_ptr[rxn + 1]; r++)
+           {
+              const unsigned int i = _reactant_species[r];
+              _dense_position.push_back(s * _n_species + i);
+              _sparse_position.push_back(std::lower_bound(_jac_cols.begin() + _jac_row_ptr[s],
+                                                          _jac_cols.begin() + _jac_row_ptr[s + 1], i) - _jac_cols.begin());
+           }
+        }
+        if(_pressure_dependent[rxn])
+        {
+           for(unsigned int a = _participant_ptr[rxn]; a < _participant_ptr[rxn + 1]; a++)
+           {
+              const unsigned int s = _participant_species[a];
+              for(unsigned int i = 0; i < _n_species; i++)
+              {
+                 _dense_position.push_back(s * _n_species + i);
+                 _sparse_position.push_back(_jac_row_ptr[s] + i); // full row
+              }
+           }
+        }
+        _position_ptr.push_back(_dense_position.size());
+     }
+
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  void BatchedKinetics<CoeffType,VectorCoeffType>::set_n_points(unsigned int n_points)
+  {
+     if(n_points == _n_points)return;
+
+     // the point densities are kept when the batch shrinks, a batch
+     // alternating between sizes allocates only at its first growth
+     _n_points = n_points;
+     if(_points.size() < _n_points)_points.resize(_n_points,VectorCoeffType(_n_species,0.L));
+     _point_dkfwd_dX.resize(_n_species,0.L);
+     _kfwd.resize(_n_points,0.L);
+     _dkfwd_dX.resize(_n_species * _n_points,0.L);
+     _concentration_product.resize(_n_points,0.L);
+     _rate.resize(_n_points,0.L);
+     _drate_dX.resize(_max_reactants * _n_points,0.L);
+     _point_rate_constants.resize(_reaction_set.n_reactions() * _n_points,0.L);
+
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  unsigned int BatchedKinetics<CoeffType,VectorCoeffType>::n_points() const
+  {
+     return _n_points;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  unsigned int BatchedKinetics<CoeffType,VectorCoeffType>::n_species() const
+  {
+     return _n_species;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  unsigned int BatchedKinetics<CoeffType,VectorCoeffType>::jacobian_non_zeros() const
+  {
+     return _jac_cols.size();
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  const std::vector<unsigned int> & BatchedKinetics<CoeffType,VectorCoeffType>::jacobian_row_ptr() const
+  {
+     return _jac_row_ptr;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  const std::vector<unsigned int> & BatchedKinetics<CoeffType,VectorCoeffType>::jacobian_cols() const
+  {
+     return _jac_cols;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  template <typename StateType, typename VectorStateType>
+  inline
+  void BatchedKinetics<CoeffType,VectorCoeffType>::mole_sources(const std::vector<Antioch::KineticsConditions<StateType> > &conditions,
+                                                                const VectorStateType &molar_concentrations, VectorStateType &kin_rates)
+  {
+     this->sweep(conditions,static_cast<const VectorStateType*>(NULL),molar_concentrations,kin_rates,static_cast<VectorStateType*>(NULL),_dense_position);
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  template <typename StateType, typename VectorStateType>
+  inline
+  void BatchedKinetics<CoeffType,VectorCoeffType>::mole_sources_and_derivs(const std::vector<Antioch::KineticsConditions<StateType> > &conditions,
+                                                                           const VectorStateType &molar_concentrations,
+                                                                           VectorStateType &kin_rates, VectorStateType &dkin_rates_dn)
+  {
+     antioch_assert_equal_to(dkin_rates_dn.size(),_n_species * _n_species * _n_points);
+     this->sweep(conditions,static_cast<const VectorStateType*>(NULL),molar_concentrations,kin_rates,&dkin_rates_dn,_dense_position);
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  template <typename StateType, typename VectorStateType>
+  inline
+  void BatchedKinetics<CoeffType,VectorCoeffType>::mole_sources_and_sparse_derivs(const std::vector<Antioch::KineticsConditions<StateType> > &conditions,
+                                                                                  const VectorStateType &molar_concentrations,
+                                                                                  VectorStateType &kin_rates, VectorStateType &jacobian_values)
+  {
+     antioch_assert_equal_to(jacobian_values.size(),_jac_cols.size() * _n_points);
+     this->sweep(conditions,static_cast<const VectorStateType*>(NULL),molar_concentrations,kin_rates,&jacobian_values,_sparse_position);
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  template <typename StateType, typename VectorStateType>
+  inline
+  void BatchedKinetics<CoeffType,VectorCoeffType>::mole_sources(const std::vector<Antioch::KineticsConditions<StateType> > &conditions,
+                                                                const VectorStateType &z,
+                                                                const VectorStateType &molar_concentrations, VectorStateType &kin_rates)
+  {
+     this->sweep(conditions,&z,molar_concentrations,kin_rates,static_cast<VectorStateType*>(NULL),_dense_position);
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  template <typename StateType, typename VectorStateType>
+  inline
+  void BatchedKinetics<CoeffType,VectorCoeffType>::mole_sources_and_derivs(const std::vector<Antioch::KineticsConditions<StateType> > &conditions,
+                                                                           const VectorStateType &z,
+                                                                           const VectorStateType &molar_concentrations,
+                                                                           VectorStateType &kin_rates, VectorStateType &dkin_rates_dn)
+  {
+     antioch_assert_equal_to(dkin_rates_dn.size(),_n_species * _n_species * _n_points);
+     this->sweep(conditions,&z,molar_concentrations,kin_rates,&dkin_rates_dn,_dense_position);
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  template <typename StateType, typename VectorStateType>
+  inline
+  void BatchedKinetics<CoeffType,VectorCoeffType>::mole_sources_and_sparse_derivs(const std::vector<Antioch::KineticsConditions<StateType> > &conditions,
+                                                                                  const VectorStateType &z,
+                                                                                  const VectorStateType &molar_concentrations,
+                                                                                  VectorStateType &kin_rates, VectorStateType &jacobian_values)
+  {
+     antioch_assert_equal_to(jacobian_values.size(),_jac_cols.size() * _n_points);
+     this->sweep(conditions,&z,molar_concentrations,kin_rates,&jacobian_values,_sparse_position);
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  void BatchedKinetics<CoeffType,VectorCoeffType>::clear_rate_cache()
+  {
+     _rate_cache.clear();
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  const RateConstantCache<CoeffType,VectorCoeffType> & BatchedKinetics<CoeffType,VectorCoeffType>::rate_cache() const
+  {
+     return _rate_cache;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  void BatchedKinetics<CoeffType,VectorCoeffType>::set_altitude_store_size(unsigned int n)
+  {
+     _rate_cache.set_capacity(n);
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  template <typename StateType, typename VectorStateType>
+  inline
+  void BatchedKinetics<CoeffType,VectorCoeffType>::cached_rate_constants(const std::vector<Antioch::KineticsConditions<StateType> > &conditions,
+                                                                         const VectorStateType &z)
+  {
+     antioch_assert_equal_to(z.size(),_n_points);
+
+     const unsigned int M = _n_points;
+     for(unsigned int p = 0; p < M; p++)
+     {
+        // neutral chemistry, no electronic temperature
+        const VectorCoeffType * stored = _rate_cache.find(z[p],conditions[p].T(),0.L);
+        if(!stored)
+        {
+           VectorCoeffType & rate_constants = _rate_cache.insert(z[p],conditions[p].T(),0.L);
+           for(unsigned int rxn = 0; rxn < _reaction_set.n_reactions(); rxn++)
+           {
+              if(!_rate_cache.cacheable(rxn))continue;
+              rate_constants[rxn] = _reaction_set.reaction(rxn).compute_forward_rate_coefficient(_points[p],conditions[p]);
+           }
+           stored = &rate_constants;
+        }
+
+        // copied before the next insertion, which may drop this altitude
+        for(unsigned int rxn = 0; rxn < _reaction_set.n_reactions(); rxn++)
+        {
+           if(_rate_cache.cacheable(rxn))_point_rate_constants[rxn * M + p] = (*stored)[rxn];
+        }
+     }
+
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  template <typename StateType, typename VectorStateType>
+  inline
+  void BatchedKinetics<CoeffType,VectorCoeffType>::sweep(const std::vector<Antioch::KineticsConditions<StateType> > &conditions,
+                                                         const VectorStateType *z,
+                                                         const VectorStateType &molar_concentrations, VectorStateType &kin_rates,
+                                                         VectorStateType *jacobian, const std::vector<unsigned int> &position)
+  {
+     const unsigned int M = _n_points;
+     antioch_assert_equal_to(conditions.size(),M);
+     antioch_assert_equal_to(molar_concentrations.size(),_n_species * M);
+     antioch_assert_equal_to(kin_rates.size(),_n_species * M);
+
+     Antioch::set_zero(kin_rates);
+     if(jacobian)Antioch::set_zero(*jacobian);
+
+     // point by point densities, for the rate constants
+     for(unsigned int s = 0; s < _n_species; s++)
+     {
+        for(unsigned int p = 0; p < M; p++)
+        {
+           _points[p][s] = molar_concentrations[s * M + p];
+        }
+     }
+
+     if(z)this->cached_rate_constants(conditions,*z);
+
+     for(unsigned int rxn = 0; rxn < _reaction_set.n_reactions(); rxn++)
+     {
+        const Antioch::Reaction<CoeffType> & reaction = _reaction_set.reaction(rxn);
+        const unsigned int r_begin = _reactant_ptr[rxn];
+        const unsigned int r_end   = _reactant_ptr[rxn + 1];
+        const bool dk_dX = (jacobian && _pressure_dependent[rxn]);
+        const bool cached = (z && _rate_cache.cacheable(rxn));
+
+        // rate constants, the only point by point evaluation
+        for(unsigned int p = 0; p < M; p++)
+        {
+           if(dk_dX)
+           {
+              StateType kfwd, dkfwd_dT;
+              reaction.compute_forward_rate_coefficient_and_derivatives(_points[p],conditions[p],kfwd,dkfwd_dT,_point_dkfwd_dX);
+              _kfwd[p] = kfwd;
+              for(unsigned int i = 0; i < _n_species; i++)_dkfwd_dX[i * M + p] = _point_dkfwd_dX[i];
+           }else if(cached)
+           {
+              _kfwd[p] = _point_rate_constants[rxn * M + p];
+           }else
+           {
+              _kfwd[p] = reaction.compute_forward_rate_coefficient(_points[p],conditions[p]);
+           }
+           _concentration_product[p] = 1.L;
+        }
+
+        // product of concentrations and its derivatives
+        if(jacobian)
+        {
+           for(unsigned int r = r_begin; r < r_end; r++)
+           {
+              CoeffType * drate = &_drate_dX[(r - r_begin) * M];
+              for(unsigned int p = 0; p < M; p++)drate[p] = _kfwd[p];
+           }
+        }
+        for(unsigned int ro = r_begin; ro < r_end; ro++)
+        {
+           const int stoi = static_cast<int>(_reactant_stoi[ro]);
+           const unsigned int offset = _reactant_species[ro] * M;
+           for(unsigned int p = 0; p < M; p++)
+           {
+              const CoeffType val = (stoi == 1)?molar_concentrations[offset + p]:Antioch::ant_pow(molar_concentrations[offset + p],stoi);
+              _concentration_product[p] *= val;
+           }
+           if(!jacobian)continue;
+           for(unsigned int ri = r_begin; ri < r_end; ri++)
+           {
+              CoeffType * drate = &_drate_dX[(ri - r_begin) * M];
+              if(ri == ro)
+              {
+                 for(unsigned int p = 0; p < M; p++)
+                 {
+                    drate[p] *= (stoi == 1)?CoeffType(1.L):static_cast<CoeffType>(stoi) * Antioch::ant_pow(molar_concentrations[offset + p],stoi - 1);
+                 }
+              }else
+              {
+                 for(unsigned int p = 0; p < M; p++)
+                 {
+                    drate[p] *= (stoi == 1)?molar_concentrations[offset + p]:Antioch::ant_pow(molar_concentrations[offset + p],stoi);
+                 }
+              }
+           }
+        }
+        for(unsigned int p = 0; p < M; p++)_rate[p] = _kfwd[p] * _concentration_product[p];
+
+        // sources
+        for(unsigned int a = _participant_ptr[rxn]; a < _participant_ptr[rxn + 1]; a++)
+        {
+           const CoeffType nu = _participant_nu[a];
+           const unsigned int offset = _participant_species[a] * M;
+           for(unsigned int p = 0; p < M; p++)
+           {
+              kin_rates[offset + p] += nu * _rate[p];
+           }
+        }
+
+        if(!jacobian)continue;
+
+        // jacobian, d/dn through the concentrations
+        unsigned int k = _position_ptr[rxn];
+        for(unsigned int a = _participant_ptr[rxn]; a < _participant_ptr[rxn + 1]; a++)
+        {
+           const CoeffType nu = _participant_nu[a];
+           for(unsigned int r = r_begin; r < r_end; r++, k++)
+           {
+              const unsigned int offset = position[k] * M;
+              const CoeffType * drate = &_drate_dX[(r - r_begin) * M];
+              for(unsigned int p = 0; p < M; p++)
+              {
+                 (*jacobian)[offset + p] += nu * drate[p];
+              }
+           }
+        }
+
+        // and through the rate constant
+        if(!dk_dX)continue;
+        for(unsigned int a = _participant_ptr[rxn]; a < _participant_ptr[rxn + 1]; a++)
+        {
+           const CoeffType nu = _participant_nu[a];
+           for(unsigned int i = 0; i < _n_species; i++, k++)
+           {
+              const unsigned int offset = position[k] * M;
+              for(unsigned int p = 0; p < M; p++)
+              {
+                 (*jacobian)[offset + p] += nu * _concentration_product[p] * _dkfwd_dX[i * M + p];
+              }
+           }
+        }
+     }
+
+     return;
+  }
+
+}
+
+#endif
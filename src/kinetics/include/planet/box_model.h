@@ -0,0 +1,494 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// Planet - An atmospheric code for planetary bodies, adapted to Titan
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+#ifndef PLANET_BOX_MODEL_H
+#define PLANET_BOX_MODEL_H
+
+//Antioch
+#include "antioch/antioch_asserts.h"
+#include "antioch/kinetics_conditions.h"
+
+//Planet
+#include "planet/atmospheric_kinetics.h"
+#include "planet/atmospheric_temperature.h"
+
+//eigen
+#include <Eigen/Dense>
+
+//C++
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <iostream>
+
+namespace Planet
+{
+  /*! Chemistry alone at one altitude (0-D box): integrates
+   *  \f$\mathrm{d}n/\mathrm{d}t = \dot\omega(n,z)\f$ in time with the
+   *  rates and the analytic jacobian of AtmosphericKinetics.
+   *
+   *  The scheme is the two stages L-stable Rosenbrock ROS2
+   *  (Verwer et al. 1999), \f$\gamma = 1 + 1/\sqrt{2}\f$:
+   *  \f[
+   *     (I - \gamma h J) k_1 = f(n_0), \quad
+   *     (I - \gamma h J) k_2 = f(n_0 + h k_1) - 2 k_1, \quad
+   *     n_1 = n_0 + \frac{3}{2} h k_1 + \frac{1}{2} h k_2
+   *  \f]
+   *  the error being estimated against the embedded first order
+   *  \f$n_0 + h k_1\f$. The jacobian is evaluated once per step, a rejected
+   *  step only refactorizes \f$I - \gamma h J\f$. A step making a density
+   *  negative beyond the absolute tolerance is rejected, the smaller
+   *  negative values are set to zero.
+   *
+   *  The box works on its AtmosphericKinetics, one box per thread, see
+   *  integrate_column() for independent altitudes in parallel. The
+   *  temperature profiles are GSL splines whose interpolation accelerators
+   *  are modified at each evaluation: boxes running in parallel need their
+   *  own temperature, and their own kinetics built on their own temperature,
+   *  composition and photon evaluator.
+   */
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  class BoxModel
+  {
+      public:
+
+        BoxModel(AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType> &kinetics,
+                 const AtmosphericTemperature<CoeffType,VectorCoeffType>         &temperature);
+        ~BoxModel();
+
+        //! relative and absolute (cm-3) tolerances on the densities
+        void set_tolerances(const CoeffType &relative, const CoeffType &absolute);
+
+        //! first time step tried (s), 0 for an automatic guess
+        void set_initial_step(const CoeffType &dt);
+
+        //! maximum number of steps (accepted and rejected) of one integration
+        void set_max_steps(unsigned int max_steps);
+
+        /*! integrates the densities \p molar_concentrations (cm-3) at altitude \p z (km)
+         *  from 0 to \p t_end (s), \return false if the maximum number of steps is reached
+         *  or the step vanished
+         */
+        bool integrate(VectorCoeffType &molar_concentrations, const CoeffType &z, const CoeffType &t_end);
+
+        /*! integrates with the photolysis of the J-value engine, the column densities
+         *  \p sum_dens being kept constant
+         */
+        bool integrate(VectorCoeffType &molar_concentrations, const VectorCoeffType &sum_dens,
+                       const CoeffType &z, const CoeffType &t_end);
+
+        //!\return number of accepted steps
+        unsigned int n_steps() const;
+
+        //!\return number of rejected steps
+        unsigned int n_rejected_steps() const;
+
+        //!\return number of jacobian evaluations
+        unsigned int n_jacobians() const;
+
+        //!\return number of LU factorizations of I - gamma h J
+        unsigned int n_factorizations() const;
+
+        //!\return number of rates evaluations (jacobians included)
+        unsigned int n_rate_evaluations() const;
+
+        //! counters to zero
+        void reset_counters();
+
+        //! the kinetics the box integrates
+        const AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType> & kinetics() const;
+
+        //! the temperature of the box
+        const AtmosphericTemperature<CoeffType,VectorCoeffType> & temperature() const;
+
+      private:
+        //! no default constructor
+        BoxModel();
+
+        //! rates, and jacobian if \p jacobian
+        void rates(const VectorCoeffType &molar_concentrations, const VectorCoeffType *sum_dens,
+                   const Antioch::KineticsConditions<CoeffType> &KC, const CoeffType &z,
+                   VectorCoeffType &kin_rates, bool jacobian);
+
+        //! the stepping
+        bool solve(VectorCoeffType &molar_concentrations, const VectorCoeffType *sum_dens,
+                   const CoeffType &z, const CoeffType &t_end);
+
+        AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType> & _kinetics;
+        const AtmosphericTemperature<CoeffType,VectorCoeffType>         & _temperature;
+
+        CoeffType    _rtol;
+        CoeffType    _atol;
+        CoeffType    _dt0;
+        unsigned int _max_steps;
+
+        unsigned int _n_steps;
+        unsigned int _n_rejected;
+        unsigned int _n_jacobians;
+        unsigned int _n_factorizations;
+        unsigned int _n_rates;
+
+        // workspace
+        unsigned int                                         _n_species;
+        VectorCoeffType                                      _f0;
+        VectorCoeffType                                      _f1;
+        VectorCoeffType                                      _stage;
+        VectorCoeffType                                      _n1;
+        MatrixCoeffType                                      _dkin_rates_dn;
+        Eigen::Matrix<CoeffType,Eigen::Dynamic,Eigen::Dynamic> _jacobian;
+        Eigen::Matrix<CoeffType,Eigen::Dynamic,1>              _k1;
+        Eigen::Matrix<CoeffType,Eigen::Dynamic,1>              _k2;
+        Eigen::Matrix<CoeffType,Eigen::Dynamic,1>              _rhs;
+        Eigen::PartialPivLU<Eigen::Matrix<CoeffType,Eigen::Dynamic,Eigen::Dynamic> > _lu;
+  };
+
+  /*! Integrates the independent altitudes \p z of a column, densities
+   *  \p columns[a] at altitude \p z[a], over the boxes \p boxes (one per
+   *  thread, each on its own AtmosphericKinetics): box b takes the altitudes
+   *  b, b + n_boxes, ... The boxes run in parallel if OpenMP is enabled,
+   *  they must not share their kinetics nor their temperature, neither the
+   *  temperature, composition and photon evaluator of their kinetics
+   *  (see BoxModel), two boxes on the same kinetics or temperature are
+   *  an error.
+   *  \return false if any altitude failed.
+   */
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  bool integrate_column(std::vector<BoxModel<CoeffType,VectorCoeffType,MatrixCoeffType> *> &boxes,
+                        std::vector<VectorCoeffType> &columns, const VectorCoeffType &z, const CoeffType &t_end);
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  BoxModel<CoeffType,VectorCoeffType,MatrixCoeffType>::BoxModel(AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType> &kinetics,
+                                                                const AtmosphericTemperature<CoeffType,VectorCoeffType>         &temperature):
+      _kinetics(kinetics),
+      _temperature(temperature),
+      _rtol(1e-4),
+      _atol(1e-3), // cm-3
+      _dt0(0.),
+      _max_steps(100000),
+      _n_steps(0),
+      _n_rejected(0),
+      _n_jacobians(0),
+      _n_factorizations(0),
+      _n_rates(0),
+      _n_species(kinetics.neutral_kinetics().n_species())
+  {
+     _f0.resize(_n_species,0.L);
+     _f1.resize(_n_species,0.L);
+     _stage.resize(_n_species,0.L);
+     _n1.resize(_n_species,0.L);
+     _dkin_rates_dn.resize(_n_species);
+     for(unsigned int s = 0; s < _n_species; s++)
+     {
+        _dkin_rates_dn[s].resize(_n_species,0.L);
+     }
+     _jacobian.resize(_n_species,_n_species);
+     _k1.resize(_n_species);
+     _k2.resize(_n_species);
+     _rhs.resize(_n_species);
+
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  BoxModel<CoeffType,VectorCoeffType,MatrixCoeffType>::~BoxModel()
+  {
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  void BoxModel<CoeffType,VectorCoeffType,MatrixCoeffType>::set_tolerances(const CoeffType &relative, const CoeffType &absolute)
+  {
+     antioch_assert_greater(relative,0.);
+     antioch_assert_greater(absolute,0.);
+     _rtol = relative;
+     _atol = absolute;
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  void BoxModel<CoeffType,VectorCoeffType,MatrixCoeffType>::set_initial_step(const CoeffType &dt)
+  {
+     _dt0 = dt;
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  void BoxModel<CoeffType,VectorCoeffType,MatrixCoeffType>::set_max_steps(unsigned int max_steps)
+  {
+     _max_steps = max_steps;
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  bool BoxModel<CoeffType,VectorCoeffType,MatrixCoeffType>::integrate(VectorCoeffType &molar_concentrations, const CoeffType &z, const CoeffType &t_end)
+  {
+     return this->solve(molar_concentrations,NULL,z,t_end);
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  bool BoxModel<CoeffType,VectorCoeffType,MatrixCoeffType>::integrate(VectorCoeffType &molar_concentrations, const VectorCoeffType &sum_dens,
+                                                                      const CoeffType &z, const CoeffType &t_end)
+  {
+     antioch_assert(_kinetics.photolysis_engine());
+     return this->solve(molar_concentrations,&sum_dens,z,t_end);
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  void BoxModel<CoeffType,VectorCoeffType,MatrixCoeffType>::rates(const VectorCoeffType &molar_concentrations, const VectorCoeffType *sum_dens,
+                                                                  const Antioch::KineticsConditions<CoeffType> &KC, const CoeffType &z,
+                                                                  VectorCoeffType &kin_rates, bool jacobian)
+  {
+     _n_rates++;
+     if(jacobian)
+     {
+        _n_jacobians++;
+        if(sum_dens)
+        {
+           _kinetics.chemical_rate_and_derivs(molar_concentrations,*sum_dens,KC,z,kin_rates,_dkin_rates_dn);
+        }else
+        {
+           _kinetics.chemical_rate_and_derivs(molar_concentrations,KC,z,kin_rates,_dkin_rates_dn);
+        }
+        for(unsigned int s = 0; s < _n_species; s++)
+        {
+           for(unsigned int i = 0; i < _n_species; i++)
+           {
+              _jacobian(s,i) = _dkin_rates_dn[s][i];
+           }
+        }
+     }else
+     {
+        if(sum_dens)
+        {
+           _kinetics.chemical_rate(molar_concentrations,*sum_dens,KC,z,kin_rates);
+        }else
+        {
+           _kinetics.chemical_rate(molar_concentrations,KC,z,kin_rates);
+        }
+     }
+
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  bool BoxModel<CoeffType,VectorCoeffType,MatrixCoeffType>::solve(VectorCoeffType &molar_concentrations, const VectorCoeffType *sum_dens,
+                                                                  const CoeffType &z, const CoeffType &t_end)
+  {
+     antioch_assert_equal_to(molar_concentrations.size(),_n_species);
+
+     const CoeffType gamma = CoeffType(1.L) + CoeffType(1.L) / std::sqrt(CoeffType(2.L));
+     const Antioch::KineticsConditions<CoeffType> KC(_temperature.neutral_temperature(z));
+     const Eigen::Matrix<CoeffType,Eigen::Dynamic,Eigen::Dynamic> identity =
+                        Eigen::Matrix<CoeffType,Eigen::Dynamic,Eigen::Dynamic>::Identity(_n_species,_n_species);
+
+     CoeffType t(0.);
+     CoeffType h(_dt0);
+     bool new_jacobian(true);
+     unsigned int n_tries(0);
+
+     while(t < t_end)
+     {
+        if(n_tries++ >= _max_steps)return false;
+
+        if(new_jacobian)
+        {
+           this->rates(molar_concentrations,sum_dens,KC,z,_f0,true);
+           new_jacobian = false;
+
+           if(h <= CoeffType(0.))
+           {
+              // densities changing by the relative tolerance in the first step
+              CoeffType rate(0.);
+              for(unsigned int s = 0; s < _n_species; s++)
+              {
+                 rate = std::max(rate,std::abs(_f0[s]) / (_atol + _rtol * std::abs(molar_concentrations[s])));
+              }
+              h = (rate > CoeffType(0.))?std::sqrt(_rtol) / rate:t_end;
+           }
+        }
+        h = std::min(h,t_end - t);
+        if(t + h == t)return false;
+
+        _lu.compute(identity - gamma * h * _jacobian);
+        _n_factorizations++;
+
+        // first stage
+        for(unsigned int s = 0; s < _n_species; s++)_rhs(s) = _f0[s];
+        _k1 = _lu.solve(_rhs);
+
+        // second stage
+        for(unsigned int s = 0; s < _n_species; s++)_stage[s] = molar_concentrations[s] + h * _k1(s);
+        this->rates(_stage,sum_dens,KC,z,_f1,false);
+        for(unsigned int s = 0; s < _n_species; s++)_rhs(s) = _f1[s] - CoeffType(2.) * _k1(s);
+        _k2 = _lu.solve(_rhs);
+
+        // solution and error against n0 + h k1
+        CoeffType error(0.);
+        bool negative(false);
+        for(unsigned int s = 0; s < _n_species; s++)
+        {
+           _n1[s] = molar_concentrations[s] + h * (CoeffType(1.5) * _k1(s) + CoeffType(0.5) * _k2(s));
+           const CoeffType scale = _atol + _rtol * std::max(std::abs(molar_concentrations[s]),std::abs(_n1[s]));
+           const CoeffType e = h * CoeffType(0.5) * (_k1(s) + _k2(s)) / scale;
+           error += e * e;
+           if(_n1[s] < - _atol)negative = true;
+        }
+        error = std::sqrt(error / CoeffType(_n_species));
+
+        // second order, safety 0.9, factors between 0.2 and 5
+        CoeffType factor = (error > CoeffType(0.))?CoeffType(0.9) / std::sqrt(error):CoeffType(5.);
+        factor = std::max(CoeffType(0.2),std::min(CoeffType(5.),factor));
+
+        if(error > CoeffType(1.) || negative)
+        {
+           _n_rejected++;
+           h *= (negative)?std::min(factor,CoeffType(0.5)):factor;
+           continue;
+        }
+
+        _n_steps++;
+        t += h;
+        h *= factor;
+        for(unsigned int s = 0; s < _n_species; s++)
+        {
+           molar_concentrations[s] = std::max(_n1[s],CoeffType(0.));
+        }
+        new_jacobian = true;
+     }
+
+     return true;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  const AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType> & BoxModel<CoeffType,VectorCoeffType,MatrixCoeffType>::kinetics() const
+  {
+     return _kinetics;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  const AtmosphericTemperature<CoeffType,VectorCoeffType> & BoxModel<CoeffType,VectorCoeffType,MatrixCoeffType>::temperature() const
+  {
+     return _temperature;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  unsigned int BoxModel<CoeffType,VectorCoeffType,MatrixCoeffType>::n_steps() const
+  {
+     return _n_steps;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  unsigned int BoxModel<CoeffType,VectorCoeffType,MatrixCoeffType>::n_rejected_steps() const
+  {
+     return _n_rejected;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  unsigned int BoxModel<CoeffType,VectorCoeffType,MatrixCoeffType>::n_jacobians() const
+  {
+     return _n_jacobians;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  unsigned int BoxModel<CoeffType,VectorCoeffType,MatrixCoeffType>::n_factorizations() const
+  {
+     return _n_factorizations;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  unsigned int BoxModel<CoeffType,VectorCoeffType,MatrixCoeffType>::n_rate_evaluations() const
+  {
+     return _n_rates;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  void BoxModel<CoeffType,VectorCoeffType,MatrixCoeffType>::reset_counters()
+  {
+     _n_steps          = 0;
+     _n_rejected       = 0;
+     _n_jacobians      = 0;
+     _n_factorizations = 0;
+     _n_rates          = 0;
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  bool integrate_column(std::vector<BoxModel<CoeffType,VectorCoeffType,MatrixCoeffType> *> &boxes,
+                        std::vector<VectorCoeffType> &columns, const VectorCoeffType &z, const CoeffType &t_end)
+  {
+     antioch_assert_equal_to(columns.size(),z.size());
+     antioch_assert(!boxes.empty());
+
+     const int n_boxes = boxes.size();
+     std::vector<int> success(n_boxes,1);
+
+// the splines of the temperature are not thread-safe
+     for(int b = 0; b < n_boxes; b++)
+     {
+        for(int c = b + 1; c < n_boxes; c++)
+        {
+           if(&boxes[b]->kinetics() == &boxes[c]->kinetics() ||
+              &boxes[b]->temperature() == &boxes[c]->temperature())
+           {
+              std::cerr << "Boxes " << b << " and " << c << " share their kinetics or their temperature,\n"
+                        << "each box needs its own kinetics, temperature, composition and photon evaluator" << std::endl;
+              antioch_error();
+           }
+        }
+     }
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static,1)
+#endif
+     for(int b = 0; b < n_boxes; b++)
+     {
+        for(unsigned int a = b; a < z.size(); a += n_boxes)
+        {
+           if(!boxes[b]->integrate(columns[a],z[a],t_end))success[b] = 0;
+        }
+     }
+
+     return (std::find(success.begin(),success.end(),0) == success.end());
+  }
+
+}
+
+#endif
@@ -0,0 +1,680 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// Planet - An atmospheric code for planetary bodies, adapted to Titan
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+#ifndef PLANET_MECHANISM_REDUCTION_H
+#define PLANET_MECHANISM_REDUCTION_H
+
+//Antioch
+#include "antioch/antioch_asserts.h"
+#include "antioch/kinetics_conditions.h"
+
+//Planet
+#include "planet/atmospheric_kinetics.h"
+#include "planet/atmospheric_mixture.h"
+
+//C++
+#include <vector>
+#include <string>
+#include <ostream>
+#include <algorithm>
+
+namespace Planet
+{
+  /*! Offline reduction of the neutral and ionic mechanisms by directed
+   *  relation graph (DRG). The rates of progress of all the reactions are
+   *  stored over a reference profile, the interaction coefficient of A
+   *  with B being the part of the production and loss of A due to the
+   *  reactions involving B, maximum over the profile.
+   *  The species reached from the targets through coefficients above
+   *  the threshold are kept, and the reactions of kept species only.
+   *
+   *  The species are indexed as in the ionic composition, neutral
+   *  reactions come first, then ionic ones and the channels of the J-value
+   *  engine. The engine photolysis is part of the graph and of error() for
+   *  the points given with their column densities, the participants of
+   *  the channels are linked together otherwise.
+   */
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  class MechanismReduction
+  {
+      private:
+        //! no default constructor
+        MechanismReduction();
+
+        AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>      & _kinetics;
+        const AtmosphericMixture<CoeffType,VectorCoeffType,MatrixCoeffType> & _composition;
+
+        unsigned int _n_species;
+        unsigned int _n_neutral_reactions;
+        //! neutral and ionic reactions, the J-value engine channels follow
+        unsigned int _n_chemical_reactions;
+        unsigned int _n_reactions;
+
+        //! neutral index to composition index
+        std::vector<unsigned int> _neutral_to_full;
+        //! species involved in each reaction (CSR), net stoichiometric coefficient
+        std::vector<unsigned int> _ptr;
+        std::vector<unsigned int> _species;
+        std::vector<CoeffType>    _nu;
+
+        //! rates of progress, by point of the profile
+        std::vector<VectorCoeffType> _rates_of_progress;
+        //! interaction coefficients, maximum over the profile, _n_species * _n_species
+        std::vector<CoeffType>       _interaction;
+
+        std::vector<bool> _kept_species;
+        std::vector<bool> _kept_reactions;
+
+        //scratch
+        VectorCoeffType        _full_concentrations;
+        VectorCoeffType        _kin_rates;
+        std::vector<CoeffType> _point_interaction;
+        std::vector<CoeffType> _point_flux;
+
+        //! the photolysis participants are linked together
+        void link_photolysis();
+
+        //! rates of progress of the neutral reactions
+        template<typename StateType, typename VectorStateType>
+        void neutral_rates(const VectorStateType & molar_concentrations, const Antioch::KineticsConditions<StateType> & KC,
+                           VectorCoeffType & rates);
+
+        //! rates of progress of the ionic reactions, ions at steady state
+        template<typename StateType, typename VectorStateType>
+        void ionic_rates(const VectorStateType & molar_concentrations, const Antioch::KineticsConditions<StateType> & KC,
+                         const StateType & z, VectorCoeffType & rates);
+
+        //! stores the rates of progress of the chemical reactions at a new point, the photolysis ones to zero
+        template<typename StateType, typename VectorStateType>
+        VectorCoeffType & new_point(const VectorStateType & molar_concentrations, const Antioch::KineticsConditions<StateType> & KC,
+                                    const StateType & z);
+
+        //! interaction coefficients updated by the rates of progress of a point
+        void add_interactions(const VectorCoeffType & rates);
+
+      public:
+        MechanismReduction(AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>      & kinetics,
+                           const AtmosphericMixture<CoeffType,VectorCoeffType,MatrixCoeffType> & composition);
+        ~MechanismReduction();
+
+        //! stores the rates of progress at a point of the reference profile, neutral densities
+        template<typename StateType, typename VectorStateType>
+        void add_point(const VectorStateType & molar_concentrations, const Antioch::KineticsConditions<StateType> & KC,
+                       const StateType & z);
+
+        //! stores the rates of progress at a point of the reference profile, the J-value engine photolysis
+        //! by the column densities \p sum_dens
+        template<typename StateType, typename VectorStateType>
+        void add_point(const VectorStateType & molar_concentrations, const VectorStateType & sum_dens,
+                       const Antioch::KineticsConditions<StateType> & KC, const StateType & z);
+
+        //! forgets the reference profile
+        void clear_points();
+
+        //! keeps the species reached from the neutral \p targets through coefficients above \p threshold
+        void reduce(const std::vector<unsigned int> & targets, const CoeffType & threshold);
+
+        /*! reduces with the largest interaction coefficient as threshold keeping
+         *  error() within \p tolerance, all the coefficients are tried
+         *  \return the threshold
+         */
+        CoeffType reduce_within(const std::vector<unsigned int> & targets, const CoeffType & tolerance);
+
+        /*! maximum over the profile and the kept species of the net rate difference
+         *  between the full and the reduced mechanisms, relative to the total
+         *  production and loss of the species
+         */
+        CoeffType error() const;
+
+        //!\return interaction coefficient of \p A with \p B, composition indices
+        const CoeffType & interaction(unsigned int A, unsigned int B) const;
+
+        //!\return number of points of the reference profile
+        unsigned int n_points() const;
+
+        //!\return kept species, composition indices
+        const std::vector<bool> & kept_species() const;
+
+        //!\return kept reactions, neutral ones first, then ionic ones and the J-value engine channels
+        const std::vector<bool> & kept_reactions() const;
+
+        //!\return number of neutral reactions
+        unsigned int n_neutral_reactions() const;
+
+        //!\return number of kept species
+        unsigned int n_kept_species() const;
+
+        //!\return number of kept reactions
+        unsigned int n_kept_reactions() const;
+
+        //! writes the kept species as input lines and the kept reactions as comments
+        void print_reduced_set(std::ostream & out) const;
+  };
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  MechanismReduction<CoeffType,VectorCoeffType,MatrixCoeffType>::MechanismReduction(AtmosphericKinetics<CoeffType,VectorCoeffType,MatrixCoeffType>      & kinetics,
+                                                                                    const AtmosphericMixture<CoeffType,VectorCoeffType,MatrixCoeffType> & composition):
+     _kinetics(kinetics),
+     _composition(composition),
+     _n_species(composition.ionic_composition().n_species()),
+     _n_neutral_reactions(kinetics.neutral_kinetics().reaction_set().n_reactions()),
+     _n_chemical_reactions(_n_neutral_reactions),
+     _n_reactions(_n_neutral_reactions)
+  {
+     const Antioch::ReactionSet<CoeffType> & neutral_set = _kinetics.neutral_kinetics().reaction_set();
+     const Antioch::ReactionSet<CoeffType> & ionic_set   = _kinetics.ionic_kinetics().reaction_set();
+     const PhotolysisEvaluator<CoeffType,VectorCoeffType> * photolysis = _kinetics.photolysis();
+     if(_kinetics.ionic_coupling())_n_chemical_reactions += ionic_set.n_reactions();
+     _n_reactions = _n_chemical_reactions;
+     if(photolysis)_n_reactions += photolysis->n_photolysis();
+
+     _neutral_to_full.resize(_composition.neutral_composition().n_species());
+     for(unsigned int s = 0; s < _neutral_to_full.size(); s++)
+     {
+        _neutral_to_full[s] = _composition.ionic_composition().species_list()[_composition.neutral_composition().species_list()[s]];
+     }
+
+     // net stoichiometry, a species both reactant and product is involved with its net coefficient
+     std::vector<CoeffType> nu(_n_species,0.L);
+     std::vector<bool> involved(_n_species,false);
+     _ptr.resize(_n_reactions + 1,0);
+     for(unsigned int rxn = 0; rxn < _n_reactions; rxn++)
+     {
+        std::vector<unsigned int> participants;
+        if(rxn < _n_chemical_reactions)
+        {
+           const bool neutral(rxn < _n_neutral_reactions);
+           const Antioch::Reaction<CoeffType> & reaction = (neutral)?neutral_set.reaction(rxn):
+                                                                     ionic_set.reaction(rxn - _n_neutral_reactions);
+           for(unsigned int r = 0; r < reaction.n_reactants(); r++)
+           {
+              const unsigned int s = (neutral)?_neutral_to_full[reaction.reactant_id(r)]:reaction.reactant_id(r);
+              nu[s] -= static_cast<CoeffType>(reaction.reactant_stoichiometric_coefficient(r));
+              if(!involved[s])participants.push_back(s);
+              involved[s] = true;
+           }
+           for(unsigned int p = 0; p < reaction.n_products(); p++)
+           {
+              const unsigned int s = (neutral)?_neutral_to_full[reaction.product_id(p)]:reaction.product_id(p);
+              nu[s] += static_cast<CoeffType>(reaction.product_stoichiometric_coefficient(p));
+              if(!involved[s])participants.push_back(s);
+              involved[s] = true;
+           }
+        }else
+        {
+           const unsigned int channel = rxn - _n_chemical_reactions;
+           const unsigned int s = _neutral_to_full[photolysis->reactant(channel)];
+           nu[s] -= 1.L;
+           participants.push_back(s);
+           involved[s] = true;
+           for(unsigned int p = 0; p < photolysis->products(channel).size(); p++)
+           {
+              const unsigned int sp = _neutral_to_full[photolysis->products(channel)[p]];
+              nu[sp] += static_cast<CoeffType>(photolysis->products_stoichiometry(channel)[p]);
+              if(!involved[sp])participants.push_back(sp);
+              involved[sp] = true;
+           }
+        }
+        for(unsigned int i = 0; i < participants.size(); i++)
+        {
+           _species.push_back(participants[i]);
+           _nu.push_back(nu[participants[i]]);
+           nu[participants[i]] = 0.L;
+           involved[participants[i]] = false;
+        }
+        _ptr[rxn + 1] = _species.size();
+     }
+
+     _interaction.resize(_n_species * _n_species,0.L);
+     _point_interaction.resize(_n_species * _n_species,0.L);
+     _point_flux.resize(_n_species,0.L);
+     _full_concentrations.resize(_n_species,0.L);
+     _kin_rates.resize(_neutral_to_full.size(),0.L);
+     _kept_species.resize(_n_species,true);
+     _kept_reactions.resize(_n_reactions,true);
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  MechanismReduction<CoeffType,VectorCoeffType,MatrixCoeffType>::~MechanismReduction()
+  {
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  void MechanismReduction<CoeffType,VectorCoeffType,MatrixCoeffType>::link_photolysis()
+  {
+     const PhotolysisEvaluator<CoeffType,VectorCoeffType> * photolysis = _kinetics.photolysis();
+     if(!photolysis)return;
+
+     for(unsigned int r = 0; r < photolysis->n_photolysis(); r++)
+     {
+        std::vector<unsigned int> participants(1,_neutral_to_full[photolysis->reactant(r)]);
+        for(unsigned int p = 0; p < photolysis->products(r).size(); p++)
+        {
+           participants.push_back(_neutral_to_full[photolysis->products(r)[p]]);
+        }
+        for(unsigned int a = 0; a < participants.size(); a++)
+        {
+           for(unsigned int b = 0; b < participants.size(); b++)
+           {
+              _interaction[participants[a] * _n_species + participants[b]] = 1.L;
+           }
+        }
+     }
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType>
+  inline
+  void MechanismReduction<CoeffType,VectorCoeffType,MatrixCoeffType>::neutral_rates(const VectorStateType & molar_concentrations,
+                                                                                    const Antioch::KineticsConditions<StateType> & KC,
+                                                                                    VectorCoeffType & rates)
+  {
+     const Antioch::ReactionSet<CoeffType> & reaction_set = _kinetics.neutral_kinetics().reaction_set();
+     for(unsigned int rxn = 0; rxn < _n_neutral_reactions; rxn++)
+     {
+        const Antioch::Reaction<CoeffType> & reaction = reaction_set.reaction(rxn);
+        rates[rxn] = reaction.compute_forward_rate_coefficient(molar_concentrations,KC);
+        for(unsigned int r = 0; r < reaction.n_reactants(); r++)
+        {
+           rates[rxn] *= Antioch::ant_pow(molar_concentrations[reaction.reactant_id(r)],
+                                          static_cast<int>(reaction.reactant_stoichiometric_coefficient(r)));
+        }
+     }
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType>
+  inline
+  void MechanismReduction<CoeffType,VectorCoeffType,MatrixCoeffType>::ionic_rates(const VectorStateType & molar_concentrations,
+                                                                                  const Antioch::KineticsConditions<StateType> & KC,
+                                                                                  const StateType & z,
+                                                                                  VectorCoeffType & rates)
+  {
+     if(!_kinetics.ionic_coupling())return;
+
+     // the ions are solved along the chemical rates, zero if the solve fails
+     Antioch::set_zero(_kin_rates);
+     _kinetics.chemical_rate(molar_concentrations,KC,z,_kin_rates);
+
+     const AtmosphericSteadyState<CoeffType,VectorCoeffType> & solver = _kinetics.ionic_solver();
+     Antioch::set_zero(_full_concentrations);
+     for(unsigned int s = 0; s < _neutral_to_full.size(); s++)
+     {
+        _full_concentrations[_neutral_to_full[s]] = molar_concentrations[s];
+     }
+     for(unsigned int ss = 0; ss < solver.mechanism().n_ss_species(); ss++)
+     {
+        _full_concentrations[solver.mechanism().ss_to_species()[ss]] = solver.molar_concentrations()[ss];
+     }
+
+     const Antioch::ReactionSet<CoeffType> & reaction_set = _kinetics.ionic_kinetics().reaction_set();
+     for(unsigned int rxn = 0; rxn < reaction_set.n_reactions(); rxn++)
+     {
+        const Antioch::Reaction<CoeffType> & reaction = reaction_set.reaction(rxn);
+        CoeffType & rate = rates[_n_neutral_reactions + rxn];
+        rate = solver.rate_constants()[rxn];
+        for(unsigned int r = 0; r < reaction.n_reactants(); r++)
+        {
+           rate *= Antioch::ant_pow(_full_concentrations[reaction.reactant_id(r)],
+                                    static_cast<int>(reaction.reactant_stoichiometric_coefficient(r)));
+        }
+     }
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType>
+  inline
+  VectorCoeffType & MechanismReduction<CoeffType,VectorCoeffType,MatrixCoeffType>::new_point(const VectorStateType & molar_concentrations,
+                                                                                            const Antioch::KineticsConditions<StateType> & KC,
+                                                                                            const StateType & z)
+  {
+     antioch_assert_equal_to(molar_concentrations.size(),_neutral_to_full.size());
+
+     _rates_of_progress.push_back(VectorCoeffType());
+     VectorCoeffType & rates = _rates_of_progress.back();
+     rates.resize(_n_reactions,0.L);
+
+     this->neutral_rates(molar_concentrations,KC,rates);
+     this->ionic_rates(molar_concentrations,KC,z,rates);
+
+     return rates;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  void MechanismReduction<CoeffType,VectorCoeffType,MatrixCoeffType>::add_interactions(const VectorCoeffType & rates)
+  {
+// r_AB = sum_j |nu_Aj w_j| delta_Bj / sum_j |nu_Aj w_j|
+     std::fill(_point_interaction.begin(),_point_interaction.end(),0.L);
+     std::fill(_point_flux.begin(),_point_flux.end(),0.L);
+     for(unsigned int rxn = 0; rxn < _n_reactions; rxn++)
+     {
+        for(unsigned int a = _ptr[rxn]; a < _ptr[rxn + 1]; a++)
+        {
+           const CoeffType flux = Antioch::ant_abs(_nu[a] * rates[rxn]);
+           _point_flux[_species[a]] += flux;
+           for(unsigned int b = _ptr[rxn]; b < _ptr[rxn + 1]; b++)
+           {
+              _point_interaction[_species[a] * _n_species + _species[b]] += flux;
+           }
+        }
+     }
+
+     for(unsigned int A = 0; A < _n_species; A++)
+     {
+        if(!(_point_flux[A] > 0.))continue;
+        for(unsigned int B = 0; B < _n_species; B++)
+        {
+           const CoeffType r_AB = _point_interaction[A * _n_species + B] / _point_flux[A];
+           if(r_AB > _interaction[A * _n_species + B])_interaction[A * _n_species + B] = r_AB;
+        }
+     }
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType>
+  inline
+  void MechanismReduction<CoeffType,VectorCoeffType,MatrixCoeffType>::add_point(const VectorStateType & molar_concentrations,
+                                                                                const Antioch::KineticsConditions<StateType> & KC,
+                                                                                const StateType & z)
+  {
+     // no photon flux for the J-value engine, its channels are linked
+     this->add_interactions(this->new_point(molar_concentrations,KC,z));
+     this->link_photolysis();
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType>
+  inline
+  void MechanismReduction<CoeffType,VectorCoeffType,MatrixCoeffType>::add_point(const VectorStateType & molar_concentrations,
+                                                                                const VectorStateType & sum_dens,
+                                                                                const Antioch::KineticsConditions<StateType> & KC,
+                                                                                const StateType & z)
+  {
+     VectorCoeffType & rates = this->new_point(molar_concentrations,KC,z);
+
+     const PhotolysisEvaluator<CoeffType,VectorCoeffType> * photolysis = _kinetics.photolysis();
+     if(photolysis)
+     {
+        VectorStateType J(photolysis->n_photolysis(),0.L);
+        _kinetics.photolysis_rates(molar_concentrations,sum_dens,z,J);
+        for(unsigned int r = 0; r < photolysis->n_photolysis(); r++)
+        {
+           rates[_n_chemical_reactions + r] = J[r] * molar_concentrations[photolysis->reactant(r)];
+        }
+     }
+
+     this->add_interactions(rates);
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  void MechanismReduction<CoeffType,VectorCoeffType,MatrixCoeffType>::clear_points()
+  {
+     _rates_of_progress.clear();
+     std::fill(_interaction.begin(),_interaction.end(),0.L);
+     std::fill(_kept_species.begin(),_kept_species.end(),true);
+     std::fill(_kept_reactions.begin(),_kept_reactions.end(),true);
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  void MechanismReduction<CoeffType,VectorCoeffType,MatrixCoeffType>::reduce(const std::vector<unsigned int> & targets, const CoeffType & threshold)
+  {
+     std::fill(_kept_species.begin(),_kept_species.end(),false);
+
+     // graph search from the targets
+     std::vector<unsigned int> to_visit;
+     for(unsigned int t = 0; t < targets.size(); t++)
+     {
+        const unsigned int s = _neutral_to_full[targets[t]];
+        if(!_kept_species[s])to_visit.push_back(s);
+        _kept_species[s] = true;
+     }
+     while(!to_visit.empty())
+     {
+        const unsigned int A = to_visit.back();
+        to_visit.pop_back();
+        for(unsigned int B = 0; B < _n_species; B++)
+        {
+           if(_kept_species[B] || !(_interaction[A * _n_species + B] > threshold))continue;
+           _kept_species[B] = true;
+           to_visit.push_back(B);
+        }
+     }
+
+     // the ions need the electrons for closure
+     if(_kinetics.ionic_coupling())
+     {
+        const SteadyStateMechanism<CoeffType> & mechanism = _kinetics.ionic_solver().mechanism();
+        bool ions(false);
+        for(unsigned int ss = 0; ss < mechanism.n_ss_species(); ss++)
+        {
+           if(_kept_species[mechanism.ss_to_species()[ss]])ions = true;
+        }
+        if(ions && mechanism.s_electron() < mechanism.n_ss_species())
+           _kept_species[mechanism.ss_to_species()[mechanism.s_electron()]] = true;
+     }
+
+     for(unsigned int rxn = 0; rxn < _n_reactions; rxn++)
+     {
+        _kept_reactions[rxn] = true;
+        for(unsigned int a = _ptr[rxn]; a < _ptr[rxn + 1]; a++)
+        {
+           if(!_kept_species[_species[a]])_kept_reactions[rxn] = false;
+        }
+     }
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  CoeffType MechanismReduction<CoeffType,VectorCoeffType,MatrixCoeffType>::reduce_within(const std::vector<unsigned int> & targets, const CoeffType & tolerance)
+  {
+     // candidate thresholds, the kept set changes only when a coefficient is crossed
+     std::vector<CoeffType> thresholds(1,0.L);
+     for(unsigned int i = 0; i < _interaction.size(); i++)
+     {
+        if(_interaction[i] > 0.)thresholds.push_back(_interaction[i]);
+     }
+     std::sort(thresholds.begin(),thresholds.end());
+     thresholds.erase(std::unique(thresholds.begin(),thresholds.end()),thresholds.end());
+
+     // the error is not monotonous in the threshold: scan from the largest one,
+     // the first passing is kept, 0 keeps every linked species
+     std::vector<bool> failed;
+     for(unsigned int t = thresholds.size() - 1; t > 0; t--)
+     {
+        this->reduce(targets,thresholds[t]);
+        if(_kept_species == failed)continue;
+        if(this->error() <= tolerance)return thresholds[t];
+        failed = _kept_species;
+     }
+
+     this->reduce(targets,thresholds[0]);
+
+     return thresholds[0];
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  CoeffType MechanismReduction<CoeffType,VectorCoeffType,MatrixCoeffType>::error() const
+  {
+     CoeffType max_error(0.L);
+     std::vector<CoeffType> full_rate(_n_species), reduced_rate(_n_species), total(_n_species);
+     for(unsigned int p = 0; p < _rates_of_progress.size(); p++)
+     {
+        std::fill(full_rate.begin(),full_rate.end(),0.L);
+        std::fill(reduced_rate.begin(),reduced_rate.end(),0.L);
+        std::fill(total.begin(),total.end(),0.L);
+        for(unsigned int rxn = 0; rxn < _n_reactions; rxn++)
+        {
+           for(unsigned int a = _ptr[rxn]; a < _ptr[rxn + 1]; a++)
+           {
+              const CoeffType rate = _nu[a] * _rates_of_progress[p][rxn];
+              full_rate[_species[a]] += rate;
+              total[_species[a]] += Antioch::ant_abs(rate);
+              if(_kept_reactions[rxn])reduced_rate[_species[a]] += rate;
+           }
+        }
+        for(unsigned int s = 0; s < _n_species; s++)
+        {
+           if(!_kept_species[s] || !(total[s] > 0.))continue;
+           max_error = std::max(max_error,CoeffType(Antioch::ant_abs(full_rate[s] - reduced_rate[s]) / total[s]));
+        }
+     }
+
+     return max_error;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  const CoeffType & MechanismReduction<CoeffType,VectorCoeffType,MatrixCoeffType>::interaction(unsigned int A, unsigned int B) const
+  {
+     return _interaction[A * _n_species + B];
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  unsigned int MechanismReduction<CoeffType,VectorCoeffType,MatrixCoeffType>::n_points() const
+  {
+     return _rates_of_progress.size();
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  const std::vector<bool> & MechanismReduction<CoeffType,VectorCoeffType,MatrixCoeffType>::kept_species() const
+  {
+     return _kept_species;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  const std::vector<bool> & MechanismReduction<CoeffType,VectorCoeffType,MatrixCoeffType>::kept_reactions() const
+  {
+     return _kept_reactions;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  unsigned int MechanismReduction<CoeffType,VectorCoeffType,MatrixCoeffType>::n_neutral_reactions() const
+  {
+     return _n_neutral_reactions;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  unsigned int MechanismReduction<CoeffType,VectorCoeffType,MatrixCoeffType>::n_kept_species() const
+  {
+     return std::count(_kept_species.begin(),_kept_species.end(),true);
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  unsigned int MechanismReduction<CoeffType,VectorCoeffType,MatrixCoeffType>::n_kept_reactions() const
+  {
+     return std::count(_kept_reactions.begin(),_kept_reactions.end(),true);
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  void MechanismReduction<CoeffType,VectorCoeffType,MatrixCoeffType>::print_reduced_set(std::ostream & out) const
+  {
+     const Antioch::ChemicalMixture<CoeffType> & mixture = _composition.ionic_composition();
+     std::vector<bool> ion(_n_species,false);
+     if(_kinetics.ionic_coupling())
+     {
+        const SteadyStateMechanism<CoeffType> & mechanism = _kinetics.ionic_solver().mechanism();
+        for(unsigned int ss = 0; ss < mechanism.n_ss_species(); ss++)ion[mechanism.ss_to_species()[ss]] = true;
+     }
+
+     out << "# reduced mechanism, " << this->n_kept_reactions() << "/" << _n_reactions << " reactions, "
+         << this->n_kept_species() << "/" << _n_species << " species, maximum error " << this->error() << std::endl;
+
+     out << "neutral_species = '";
+     bool first(true);
+     for(unsigned int s = 0; s < _neutral_to_full.size(); s++)
+     {
+        if(!_kept_species[_neutral_to_full[s]])continue;
+        out << ((first)?"":" ") << _composition.neutral_composition().species_inverse_name_map().at(s);
+        first = false;
+     }
+     out << "'" << std::endl;
+
+     if(_kinetics.ionic_coupling())
+     {
+        out << "ionic_species = '";
+        first = true;
+        for(unsigned int s = 0; s < _n_species; s++)
+        {
+           if(!ion[s] || !_kept_species[s])continue;
+           out << ((first)?"":" ") << mixture.species_inverse_name_map().at(s);
+           first = false;
+        }
+        out << "'" << std::endl;
+     }
+
+     // the reactions of absent species are skipped when parsing, the kept ones are listed for the record
+     const Antioch::ReactionSet<CoeffType> & neutral_set = _kinetics.neutral_kinetics().reaction_set();
+     const Antioch::ReactionSet<CoeffType> & ionic_set   = _kinetics.ionic_kinetics().reaction_set();
+     for(unsigned int rxn = 0; rxn < _n_reactions; rxn++)
+     {
+        if(!_kept_reactions[rxn])continue;
+        if(rxn < _n_neutral_reactions)
+        {
+           out << "# " << neutral_set.reaction(rxn).equation() << std::endl;
+        }else if(rxn < _n_chemical_reactions)
+        {
+           out << "# " << ionic_set.reaction(rxn - _n_neutral_reactions).equation() << std::endl;
+        }else
+        {
+           out << "# " << _kinetics.photolysis()->equation(rxn - _n_chemical_reactions) << std::endl;
+        }
+     }
+
+     return;
+  }
+
+}
+
+#endif
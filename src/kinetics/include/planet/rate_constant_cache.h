@@ -0,0 +1,209 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// Planet - An atmospheric code for planetary bodies, adapted to Titan
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+#ifndef PLANET_RATE_CONSTANT_CACHE_H
+#define PLANET_RATE_CONSTANT_CACHE_H
+
+//Antioch
+#include "antioch/antioch_asserts.h"
+#include "antioch/reaction_set.h"
+
+//Planet
+#include "planet/altitude_store.h"
+
+//C++
+#include <vector>
+
+namespace Planet
+{
+  /*! Forward rate constants of a reaction set stored by altitude. The
+   *  temperature is a fixed function of the altitude, so the rate
+   *  constants at a quadrature point are the same for every Newton
+   *  iteration: they are computed at the first visit and read afterwards.
+   *  An entry remembers the neutral and electronic temperatures it was
+   *  computed with and is stale if they changed, clear() has to be called
+   *  when the rate parameters change. At most capacity() altitudes are
+   *  kept, the least recently used are dropped (AltitudeStore).
+   *
+   *  Only the reactions whose rate constant depends on the temperatures
+   *  alone are cached: photolysis and pressure dependent reactions are
+   *  left to the caller, see cacheable().
+   */
+  template <typename CoeffType, typename VectorCoeffType = std::vector<CoeffType> >
+  class RateConstantCache
+  {
+      public:
+
+        RateConstantCache(const Antioch::ReactionSet<CoeffType> &reaction_set);
+        ~RateConstantCache();
+
+        //!\return true if the rate constant of reaction \p rxn is stored
+        bool cacheable(unsigned int rxn) const;
+
+        //!\return rate constants stored at \p z for the temperatures \p T and \p T_electrons, NULL if none or stale
+        const VectorCoeffType * find(const CoeffType &z, const CoeffType &T, const CoeffType &T_electrons) const;
+
+        //!\return storage of the rate constants at \p z for \p T and \p T_electrons, to be filled by the caller
+        VectorCoeffType & insert(const CoeffType &z, const CoeffType &T, const CoeffType &T_electrons);
+
+        //! forgets everything, rate parameters changed
+        void clear();
+
+        //!\return number of altitudes stored
+        unsigned int size() const;
+
+        //!\return maximum number of altitudes stored
+        unsigned int capacity() const;
+
+        //! maximum number of altitudes stored
+        void set_capacity(unsigned int capacity);
+
+        //!\return number of successful find()
+        unsigned int hits() const;
+
+        //!\return number of find() that missed
+        unsigned int misses() const;
+
+      private:
+        //! no default constructor
+        RateConstantCache();
+
+        struct Entry
+        {
+           CoeffType       T;
+           CoeffType       T_electrons;
+           VectorCoeffType rate_constants;
+        };
+
+        std::vector<bool>                         _cacheable;
+        mutable AltitudeStore<CoeffType,Entry>    _entries;
+        mutable unsigned int                      _hits;
+        mutable unsigned int                      _misses;
+  };
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  RateConstantCache<CoeffType,VectorCoeffType>::RateConstantCache(const Antioch::ReactionSet<CoeffType> &reaction_set):
+      _hits(0),
+      _misses(0)
+  {
+     _cacheable.resize(reaction_set.n_reactions(),false);
+     for(unsigned int rxn = 0; rxn < reaction_set.n_reactions(); rxn++)
+     {
+        const Antioch::Reaction<CoeffType> & reaction = reaction_set.reaction(rxn);
+        _cacheable[rxn] = (reaction.kinetics_model() != Antioch::KineticsModel::PHOTOCHEM &&
+                           (reaction.type() == Antioch::ReactionType::ELEMENTARY ||
+                            reaction.type() == Antioch::ReactionType::DUPLICATE));
+     }
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  RateConstantCache<CoeffType,VectorCoeffType>::~RateConstantCache()
+  {
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  bool RateConstantCache<CoeffType,VectorCoeffType>::cacheable(unsigned int rxn) const
+  {
+     return _cacheable[rxn];
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  const VectorCoeffType * RateConstantCache<CoeffType,VectorCoeffType>::find(const CoeffType &z, const CoeffType &T, const CoeffType &T_electrons) const
+  {
+     const Entry * entry = _entries.find(z);
+     if(!entry || entry->T != T || entry->T_electrons != T_electrons)
+     {
+        _misses++;
+        return NULL;
+     }
+
+     _hits++;
+     return &(entry->rate_constants);
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  VectorCoeffType & RateConstantCache<CoeffType,VectorCoeffType>::insert(const CoeffType &z, const CoeffType &T, const CoeffType &T_electrons)
+  {
+     Entry & entry = _entries.insert(z);
+     entry.T           = T;
+     entry.T_electrons = T_electrons;
+     entry.rate_constants.resize(_cacheable.size(),0.L);
+
+     return entry.rate_constants;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  void RateConstantCache<CoeffType,VectorCoeffType>::clear()
+  {
+     _entries.clear();
+     _hits   = 0;
+     _misses = 0;
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  unsigned int RateConstantCache<CoeffType,VectorCoeffType>::size() const
+  {
+     return _entries.size();
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  unsigned int RateConstantCache<CoeffType,VectorCoeffType>::capacity() const
+  {
+     return _entries.capacity();
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  void RateConstantCache<CoeffType,VectorCoeffType>::set_capacity(unsigned int capacity)
+  {
+     _entries.set_capacity(capacity);
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  unsigned int RateConstantCache<CoeffType,VectorCoeffType>::hits() const
+  {
+     return _hits;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  unsigned int RateConstantCache<CoeffType,VectorCoeffType>::misses() const
+  {
+     return _misses;
+  }
+
+}
+
+#endif
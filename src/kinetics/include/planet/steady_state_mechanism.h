@@ -0,0 +1,387 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// Planet - An atmospheric code for planetary bodies, adapted to Titan
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+#ifndef PLANET_STEADY_STATE_MECHANISM_H
+#define PLANET_STEADY_STATE_MECHANISM_H
+
+//Antioch
+#include "antioch/antioch_asserts.h"
+#include "antioch/reaction_set.h"
+
+//eigen
+#include <Eigen/Sparse>
+
+//C++
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <utility>
+
+namespace Planet
+{
+  /*! Immutable part of the ionospheric steady state: the reaction set,
+   *  the steady state species, the precompiled reaction topology and the
+   *  nonzero pattern of the ionic jacobian. Everything is built once at
+   *  construction and only read afterwards, one mechanism can therefore be
+   *  shared by all the AtmosphericSteadyState workspaces, one per thread.
+   */
+  template <typename CoeffType>
+  class SteadyStateMechanism
+  {
+      public:
+
+        /*! flat reaction -> species table (CSR), the species of reaction rxn
+         *  are species[ptr[rxn]] to species[ptr[rxn+1] - 1]
+         */
+        struct ReactionTopology
+        {
+           std::vector<unsigned int> ptr;
+           std::vector<unsigned int> species;
+           std::vector<unsigned int> stoi;
+        };
+
+        SteadyStateMechanism(const std::vector<Antioch::Species> &ss_species, const Antioch::ReactionSet<CoeffType> &reaction_set);
+        ~SteadyStateMechanism();
+
+        //!\return the reaction set
+        const Antioch::ReactionSet<CoeffType> & reaction_set() const;
+
+        //!\return the steady state species
+        const std::vector<Antioch::Species> & ss_species() const;
+
+        //!\return number of steady state species
+        unsigned int n_ss_species() const;
+
+        //!\return number of reactions
+        unsigned int n_reactions() const;
+
+        //!\return number of species of the full system
+        unsigned int n_species() const;
+
+        //!\return steady state reactants, ss_species indexes
+        const ReactionTopology & ss_reactants() const;
+
+        //!\return steady state products, ss_species indexes
+        const ReactionTopology & ss_products() const;
+
+        //!\return other reactants, n_species indexes
+        const ReactionTopology & neutral_reactants() const;
+
+        //!\return all reactants, n_species indexes
+        const ReactionTopology & reactants() const;
+
+        //!\return all products, n_species indexes
+        const ReactionTopology & products() const;
+
+        //!\return ss_species to n_species
+        const std::vector<unsigned int> & ss_to_species() const;
+
+        //!\return electron in ss_species, n_ss_species() if none
+        unsigned int s_electron() const;
+
+        //!\return largest number of reactants of a reaction
+        unsigned int max_reactants() const;
+
+        //!\return nonzero pattern of the ionic jacobian, closure included
+        const Eigen::SparseMatrix<CoeffType> & sparse_pattern() const;
+
+        //!\return (row,col) of the stored values of the pattern
+        const std::vector<std::pair<unsigned int,unsigned int> > & sparse_entries() const;
+
+      private:
+        //don't use it
+        SteadyStateMechanism();
+
+        //! maps and topology
+        void build_map();
+
+        //! fills a CSR table, \p ss selects the steady state species, \p reactants the side of the reaction
+        void build_topology(ReactionTopology & topology, bool reactants, bool ss, bool all = false);
+
+        //! nonzero pattern of the ionic jacobian, closure included
+        void build_sparse_pattern();
+
+        //!contains all the system
+        const Antioch::ReactionSet<CoeffType> & _reaction_set; 
+        //!targets only the species at steady state
+        const std::vector<Antioch::Species>     _ss_species;
+
+        std::map<unsigned int,unsigned int> _ionic_map;         //from n_species to ss_species
+
+        ReactionTopology _ss_reactants;      //steady state reactants, ss_species indexes
+        ReactionTopology _ss_products;       //steady state products, ss_species indexes
+        ReactionTopology _neutral_reactants; //other reactants, n_species indexes
+        ReactionTopology _reactants;         //all reactants, n_species indexes
+        ReactionTopology _products;          //all products, n_species indexes
+        std::vector<unsigned int> _ss_to_species; //ss_species to n_species
+        unsigned int _s_electron;                 //electron in ss_species
+        unsigned int _max_reactants;
+
+        Eigen::SparseMatrix<CoeffType>                     _sparse_pattern;
+        std::vector<std::pair<unsigned int,unsigned int> > _sparse_entries; //(row,col) of the stored values
+  };
+
+  template <typename CoeffType>
+  inline
+  SteadyStateMechanism<CoeffType>::SteadyStateMechanism(const std::vector<Antioch::Species> &ss_species, const Antioch::ReactionSet<CoeffType> &reaction_set):
+      _reaction_set(reaction_set),
+      _ss_species(ss_species),
+      _s_electron(ss_species.size()),
+      _max_reactants(0)
+  {
+     this->build_map();
+     return;
+  }
+
+  template <typename CoeffType>
+  inline
+  SteadyStateMechanism<CoeffType>::~SteadyStateMechanism()
+  {
+     return;
+  }
+
+  template <typename CoeffType>
+  inline
+  void SteadyStateMechanism<CoeffType>::build_map()
+  {
+     const Antioch::ChemicalMixture<CoeffType> & mixture = _reaction_set.chemical_mixture();
+     _ionic_map.clear();
+     _ss_to_species.resize(_ss_species.size());
+     for(unsigned int s = 0; s < _ss_species.size(); s++)
+     {
+         _ionic_map[mixture.species_list()[_ss_species[s]]] = s;
+         _ss_to_species[s] = mixture.species_list()[_ss_species[s]];
+     }
+
+     this->build_topology(_ss_reactants,      true,  true);
+     this->build_topology(_ss_products,       false, true);
+     this->build_topology(_neutral_reactants, true,  false);
+     this->build_topology(_reactants,         true,  false, true);
+     this->build_topology(_products,          false, false, true);
+
+     _max_reactants = 0;
+     for(unsigned int rxn = 0; rxn + 1 < _reactants.ptr.size(); rxn++)
+     {
+        _max_reactants = std::max(_max_reactants, _reactants.ptr[rxn + 1] - _reactants.ptr[rxn]);
+     }
+
+     _s_electron = _ss_species.size();
+     if(mixture.species_name_map().count("e") && _ionic_map.count(mixture.species_name_map().at("e")))
+        _s_electron = _ionic_map.at(mixture.species_name_map().at("e"));
+
+     this->build_sparse_pattern();
+
+     return;
+  }
+
+  template <typename CoeffType>
+  inline
+  void SteadyStateMechanism<CoeffType>::build_topology(ReactionTopology & topology, bool reactants, bool ss, bool all)
+  {
+     const unsigned int n_reactions = _reaction_set.n_reactions();
+     topology.ptr.assign(1,0);
+     topology.ptr.reserve(n_reactions + 1);
+     topology.species.clear();
+     topology.stoi.clear();
+
+     for(unsigned int rxn = 0; rxn < n_reactions; rxn++)
+     {
+        const Antioch::Reaction<CoeffType> & reac = _reaction_set.reaction(rxn);
+        const unsigned int n = (reactants)?reac.n_reactants():reac.n_products();
+        for(unsigned int i = 0; i < n; i++)
+        {
+           const unsigned int id   = (reactants)?reac.reactant_id(i):reac.product_id(i);
+           const unsigned int stoi = (reactants)?reac.reactant_stoichiometric_coefficient(i):reac.product_stoichiometric_coefficient(i);
+           const bool is_ss = _ionic_map.count(id);
+           if(!all && is_ss != ss)continue;
+           topology.species.push_back((ss)?_ionic_map.at(id):id);
+           topology.stoi.push_back(stoi);
+        }
+        topology.ptr.push_back(topology.species.size());
+     }
+
+     return;
+  }
+
+  template <typename CoeffType>
+  inline
+  void SteadyStateMechanism<CoeffType>::build_sparse_pattern()
+  {
+     const unsigned int n_ss = _ss_species.size();
+     std::vector<Eigen::Triplet<CoeffType> > pattern;
+
+     // diagonal, whatever the reactions
+     for(unsigned int s = 0; s < n_ss; s++)
+     {
+        pattern.push_back(Eigen::Triplet<CoeffType>(s,s,1.L));
+     }
+
+     // reactants and products of a reaction depend on its steady state reactants
+     for(unsigned int rxn = 0; rxn + 1 < _ss_reactants.ptr.size(); rxn++)
+     {
+        for(unsigned int r = _ss_reactants.ptr[rxn]; r < _ss_reactants.ptr[rxn + 1]; r++)
+        {
+           for(unsigned int rr = _ss_reactants.ptr[rxn]; rr < _ss_reactants.ptr[rxn + 1]; rr++)
+           {
+              pattern.push_back(Eigen::Triplet<CoeffType>(_ss_reactants.species[r],_ss_reactants.species[rr],1.L));
+           }
+           for(unsigned int p = _ss_products.ptr[rxn]; p < _ss_products.ptr[rxn + 1]; p++)
+           {
+              pattern.push_back(Eigen::Triplet<CoeffType>(_ss_products.species[p],_ss_reactants.species[r],1.L));
+           }
+        }
+     }
+
+     // closure, electron row is full
+     if(_s_electron < n_ss)
+     {
+        for(unsigned int s = 0; s < n_ss; s++)
+        {
+           pattern.push_back(Eigen::Triplet<CoeffType>(_s_electron,s,1.L));
+        }
+     }
+
+     _sparse_pattern.resize(n_ss,n_ss);
+     _sparse_pattern.setFromTriplets(pattern.begin(),pattern.end());
+     _sparse_pattern.makeCompressed();
+
+     _sparse_entries.clear();
+     _sparse_entries.reserve(_sparse_pattern.nonZeros());
+     for(int j = 0; j < _sparse_pattern.outerSize(); j++)
+     {
+        for(typename Eigen::SparseMatrix<CoeffType>::InnerIterator it(_sparse_pattern,j); it; ++it)
+        {
+           _sparse_entries.push_back(std::make_pair(it.row(),it.col()));
+        }
+     }
+
+     return;
+  }
+
+  template <typename CoeffType>
+  inline
+  const Antioch::ReactionSet<CoeffType> & SteadyStateMechanism<CoeffType>::reaction_set() const
+  {
+     return _reaction_set;
+  }
+
+  template <typename CoeffType>
+  inline
+  const std::vector<Antioch::Species> & SteadyStateMechanism<CoeffType>::ss_species() const
+  {
+     return _ss_species;
+  }
+
+  template <typename CoeffType>
+  inline
+  unsigned int SteadyStateMechanism<CoeffType>::n_ss_species() const
+  {
+     return _ss_species.size();
+  }
+
+  template <typename CoeffType>
+  inline
+  unsigned int SteadyStateMechanism<CoeffType>::n_reactions() const
+  {
+     return _reaction_set.n_reactions();
+  }
+
+  template <typename CoeffType>
+  inline
+  unsigned int SteadyStateMechanism<CoeffType>::n_species() const
+  {
+     return _reaction_set.n_species();
+  }
+
+  template <typename CoeffType>
+  inline
+  const typename SteadyStateMechanism<CoeffType>::ReactionTopology & SteadyStateMechanism<CoeffType>::ss_reactants() const
+  {
+     return _ss_reactants;
+  }
+
+  template <typename CoeffType>
+  inline
+  const typename SteadyStateMechanism<CoeffType>::ReactionTopology & SteadyStateMechanism<CoeffType>::ss_products() const
+  {
+     return _ss_products;
+  }
+
+  template <typename CoeffType>
+  inline
+  const typename SteadyStateMechanism<CoeffType>::ReactionTopology & SteadyStateMechanism<CoeffType>::neutral_reactants() const
+  {
+     return _neutral_reactants;
+  }
+
+  template <typename CoeffType>
+  inline
+  const typename SteadyStateMechanism<CoeffType>::ReactionTopology & SteadyStateMechanism<CoeffType>::reactants() const
+  {
+     return _reactants;
+  }
+
+  template <typename CoeffType>
+  inline
+  const typename SteadyStateMechanism<CoeffType>::ReactionTopology & SteadyStateMechanism<CoeffType>::products() const
+  {
+     return _products;
+  }
+
+  template <typename CoeffType>
+  inline
+  const std::vector<unsigned int> & SteadyStateMechanism<CoeffType>::ss_to_species() const
+  {
+     return _ss_to_species;
+  }
+
+  template <typename CoeffType>
+  inline
+  unsigned int SteadyStateMechanism<CoeffType>::s_electron() const
+  {
+     return _s_electron;
+  }
+
+  template <typename CoeffType>
+  inline
+  unsigned int SteadyStateMechanism<CoeffType>::max_reactants() const
+  {
+     return _max_reactants;
+  }
+
+  template <typename CoeffType>
+  inline
+  const Eigen::SparseMatrix<CoeffType> & SteadyStateMechanism<CoeffType>::sparse_pattern() const
+  {
+     return _sparse_pattern;
+  }
+
+  template <typename CoeffType>
+  inline
+  const std::vector<std::pair<unsigned int,unsigned int> > & SteadyStateMechanism<CoeffType>::sparse_entries() const
+  {
+     return _sparse_entries;
+  }
+
+}
+
+#endif
@@ -31,9 +31,14 @@
 //
 //Planet
 #include "planet/math_constants.h"
+#include "planet/chapman_table.h"
+
+//Eigen
+#include <Eigen/Dense>
 
 //C++
 #include <cmath>
+#include <algorithm>
 
 namespace Planet{
 
@@ -43,6 +48,26 @@ template <typename CoeffType = double>
 
      CoeffType _chi;
 
+//chi-dependent terms, cached by set_chi
+     CoeffType _abs_cos_chi;
+     CoeffType _cos2_chi;
+     CoeffType _sin_chi;
+     CoeffType _sqrt_sin_chi;
+     CoeffType _low_chapman;
+
+//optional (chi,x) table
+     ChapmanTable<CoeffType> _table;
+     bool                    _tabulated;
+     unsigned int            _table_cell;
+     CoeffType               _table_weight;
+     CoeffType               _table_growth;
+
+     //! lambda block size of the batch evaluation
+     static const unsigned int _block_size = 256;
+
+     //! updates the chi-dependent terms
+     void update_chi_terms();
+
      //! degrees to gradians
      template <typename StateType = CoeffType>
      ANTIOCH_AUTO(StateType)
@@ -64,21 +89,42 @@ template <typename CoeffType = double>
      template <typename StateType>
      ANTIOCH_AUTO(StateType)
      chapman_medium_angles(const StateType &x) const;
-     
-     //! The approximation from Abramowitz and Stegun, Eq. 7.1.26
+
+     //! the polynomial P(t) of Abramowitz and Stegun, Eq. 7.1.26, 1 - erf(x) = P(t) exp(-x^2), t = 1/(1 + p x)
      template <typename StateType>
-     ANTIOCH_AUTO(StateType)
-     erf(StateType x) const;
+     StateType erfc_scaled(const StateType &x) const;
+
+     //! the polynomial P(t) of Abramowitz and Stegun and dP/dt
+     template <typename StateType>
+     void erfc_scaled_and_deriv(const StateType &x, StateType &t, StateType &P, StateType &dP_dt) const;
+
+     //! derivative of chapman for high angles
+     template <typename StateType>
+     StateType dchapman_high_angles_dx(const StateType &x) const;
+
+     //! derivative of chapman for medium angles
+     template <typename StateType>
+     StateType dchapman_medium_angles_dx(const StateType &x) const;
+
+     //! chapman on a block of x, no allocation
+     template <typename ArrayType>
+     void chapman_block(const ArrayType &x, ArrayType &chap) const;
+
+     //! approximation used at chi, 0 low, 1 medium, 2 high angles
+     unsigned int approximation() const;
+
+     //! exponential growth rate in x, 1 - sin(chi) at high angles, 0 otherwise
+     CoeffType growth_rate() const;
 
    public:
 
-     Chapman(){return;}
-     Chapman(const CoeffType &chi):_chi(rad(chi)){return;}
+     Chapman();
+     Chapman(const CoeffType &chi);
      ~Chapman(){return;}
 
      //!
      template <typename StateType>
-     void set_chi(const StateType &chi) {_chi = rad(chi);}
+     void set_chi(const StateType &chi);
 
      //!
      CoeffType chapman() const ;
@@ -86,6 +132,18 @@ template <typename CoeffType = double>
      template <typename StateType>
      StateType chapman(const StateType &x) const; // x = (R + z)/H
 
+     //! chapman on many x, chap[i] = chapman(x[i])
+     template <typename VectorStateType>
+     void chapman(const VectorStateType &x, VectorStateType &chap) const;
+
+     //! chapman with the analytical approximations, the table is not used
+     template <typename StateType>
+     StateType chapman_analytical(const StateType &x) const;
+
+     //! \return d chapman / d x, zero at low angles, derivative of the interpolated value where chapman(x) uses the table
+     template <typename StateType>
+     StateType dchapman_dx(const StateType &x) const;
+
      //! \return the rate evaluated at low angle.
      CoeffType operator()() const;
 
@@ -97,8 +155,95 @@ template <typename CoeffType = double>
 
      //! Approach angle
      CoeffType chi() const;
+
+     /*! tabulates ln(chapman) - x (1 - sin(chi)) on [chi_min,chi_max] x [x_min,x_max], chi in degrees,
+      *  the exponential growth at high angles being removed, and kept exact, as it is the largest
+      *  curvature. The chi cells are split where needed and the x grid refined until the relative
+      *  interpolation error is below \p tolerance or the number of nodes reaches \p max_nodes. chapman(x) then interpolates for
+      *  (chi,x) in the table, the achieved error is given by table_error().
+      */
+     void build_table(const CoeffType &chi_min, const CoeffType &chi_max, 
+                      const CoeffType &x_min,   const CoeffType &x_max, 
+                      const CoeffType &tolerance, unsigned int max_nodes = 1048576);
+
+     //! back to the analytical approximations
+     void clear_table();
+
+     //! \return true if a table is built
+     bool tabulated() const;
+
+     //! \return the table
+     const ChapmanTable<CoeffType> &table() const;
+
+     //! \return the maximum relative interpolation error of the table
+     CoeffType table_error() const;
   };
 
+  template<typename CoeffType>
+  inline
+  Chapman<CoeffType>::Chapman():
+    _chi(0.L),
+    _tabulated(false),
+    _table_cell(0),
+    _table_weight(0.L),
+    _table_growth(0.L)
+  {
+    this->update_chi_terms();
+    return;
+  }
+
+  template<typename CoeffType>
+  inline
+  Chapman<CoeffType>::Chapman(const CoeffType &chi):
+    _chi(rad(chi)),
+    _tabulated(false),
+    _table_cell(0),
+    _table_weight(0.L),
+    _table_growth(0.L)
+  {
+    this->update_chi_terms();
+    return;
+  }
+
+  template<typename CoeffType>
+  template<typename StateType>
+  inline
+  void Chapman<CoeffType>::set_chi(const StateType &chi)
+  {
+    _chi = rad(chi);
+    this->update_chi_terms();
+  }
+
+  template<typename CoeffType>
+  inline
+  void Chapman<CoeffType>::update_chi_terms()
+  {
+    _abs_cos_chi  = Antioch::ant_abs(Antioch::ant_cos(_chi));
+    _cos2_chi     = Antioch::ant_pow(Antioch::ant_cos(_chi),2);
+    _sin_chi      = Antioch::ant_sin(_chi);
+    _sqrt_sin_chi = (_sin_chi > CoeffType(0.L))?Antioch::ant_sqrt(_sin_chi):CoeffType(0.L);
+    _low_chapman  = CoeffType(1.L)/Antioch::ant_cos(_chi);
+
+    _tabulated    = (!_table.empty() && _table.locate_chi(deg(_chi),_table_cell,_table_weight));
+    _table_growth = this->growth_rate();
+  }
+
+  template<typename CoeffType>
+  inline
+  unsigned int Chapman<CoeffType>::approximation() const
+  {
+    if(_chi < rad(75.1L))return 0;
+    if(_chi < rad(90.1L))return 1;
+                         return 2;
+  }
+
+  template<typename CoeffType>
+  inline
+  CoeffType Chapman<CoeffType>::growth_rate() const
+  {
+    return (_chi < rad(90.1L))?CoeffType(0.L):CoeffType(1.L) - _sin_chi;
+  }
+
   template<typename CoeffType>
   inline
   CoeffType Chapman<CoeffType>::operator()() const
@@ -111,19 +256,98 @@ template <typename CoeffType = double>
   CoeffType Chapman<CoeffType>::chapman() const
   {
      antioch_assert_less(_chi,rad(75.1L));
-     return CoeffType(1.L)/Antioch::ant_cos(_chi);
+     return _low_chapman;
   }
 
   template<typename CoeffType>
   template<typename StateType>
   inline
   StateType Chapman<CoeffType>::chapman(const StateType & x) const
+  {
+    if(_tabulated && _table.in_range(x))return Antioch::ant_exp(_table.interpolate(_table_cell,_table_weight,x) + x * StateType(_table_growth));
+    return this->chapman_analytical(x);
+  }
+
+  template<typename CoeffType>
+  template<typename StateType>
+  inline
+  StateType Chapman<CoeffType>::chapman_analytical(const StateType & x) const
   {
     if(_chi < rad(75.1L))return this->chapman();
     if(_chi < rad(90.1L))return this->chapman_medium_angles(x);
                          return this->chapman_high_angles(x);
   }
 
+  template<typename CoeffType>
+  template<typename VectorStateType>
+  inline
+  void Chapman<CoeffType>::chapman(const VectorStateType & x, VectorStateType & chap) const
+  {
+    typedef typename Antioch::value_type<VectorStateType>::type Scalar;
+    // fixed maximum size, the blocks live on the stack
+    typedef Eigen::Array<Scalar,Eigen::Dynamic,1,Eigen::ColMajor,_block_size,1> ArrayBlock;
+
+    chap.resize(x.size());
+
+    if(_chi < rad(75.1L))
+    {
+      for(unsigned int i = 0; i < x.size(); i++)chap[i] = _low_chapman;
+      return;
+    }
+
+    if(_tabulated)
+    {
+      for(unsigned int i = 0; i < x.size(); i++)chap[i] = this->chapman(x[i]);
+      return;
+    }
+
+    ArrayBlock chap_block;
+    for(unsigned int i = 0; i < x.size(); i += _block_size)
+    {
+       const unsigned int n = (i + _block_size < x.size())?_block_size:x.size() - i;
+       const ArrayBlock x_block = Eigen::Map<const Eigen::Array<Scalar,Eigen::Dynamic,1> >(&x[i],n);
+       this->chapman_block(x_block,chap_block);
+       Eigen::Map<Eigen::Array<Scalar,Eigen::Dynamic,1> >(&chap[i],n) = chap_block;
+    }
+  }
+
+  template<typename CoeffType>
+  template<typename ArrayType>
+  inline
+  void Chapman<CoeffType>::chapman_block(const ArrayType & x, ArrayType & chap) const
+  {
+    typedef typename ArrayType::Scalar Scalar;
+
+    // u = sqrt(x/2) |cos(chi)|, t = 1/(1 + p u), chap holds t then P(t)
+    const ArrayType u = (x / Scalar(2.L)).sqrt() * Scalar(_abs_cos_chi);
+    chap = (Scalar(1.L) + Scalar(0.3275911L) * u).inverse();
+    chap = chap * (Scalar( 0.254829592L) + chap * (Scalar(-0.284496736L) + chap * (Scalar( 1.421413741L) + 
+           chap * (Scalar(-1.453152027L) + chap *  Scalar( 1.061405429L)))));
+
+    if(_chi < rad(90.1L))
+    {
+      // (1 - erf(u)) exp(u^2) = P(t)
+      chap *= (Constants::pi<Scalar>() * x / Scalar(2.L)).sqrt();
+    }else
+    {
+      chap = (Scalar(2.L) * Constants::pi<Scalar>() * x).sqrt() *
+             ( Scalar(_sqrt_sin_chi) * (x * Scalar(CoeffType(1.L) - _sin_chi)).exp() -
+               Scalar(0.5L) * (u.square() * (-u.square()).exp() * chap).exp() );
+    }
+  }
+
+  template<typename CoeffType>
+  template<typename StateType>
+  inline
+  StateType Chapman<CoeffType>::dchapman_dx(const StateType & x) const
+  {
+    // same approximation as chapman(x), Chap = exp(f(x) + g x)
+    if(_tabulated && _table.in_range(x))return this->chapman(x) * (_table.interpolate_dx(_table_cell,_table_weight,x) + StateType(_table_growth));
+    if(_chi < rad(75.1L))return StateType(0.L);
+    if(_chi < rad(90.1L))return this->dchapman_medium_angles_dx(x);
+                         return this->dchapman_high_angles_dx(x);
+  }
+
   template <typename CoeffType>
   inline
   CoeffType Chapman<CoeffType>::chi() const
@@ -137,18 +361,13 @@ template <typename CoeffType = double>
   ANTIOCH_AUTO(StateType) Chapman<CoeffType>::chapman_high_angles(const StateType &x) const
   {
      antioch_assert_greater(_chi,rad(90.L));antioch_assert_less(_chi,rad(180.L));
+     const StateType u2 = x / StateType(2.L) * StateType(_cos2_chi);
      return Antioch::ant_sqrt(StateType(2.L) * Constants::pi<StateType>() * x) * 
-                                (  Antioch::ant_sqrt(Antioch::ant_sin(_chi)) * 
-                                   Antioch::ant_exp( x * (StateType(1.L) - Antioch::ant_sin(_chi))) -
+                                (  StateType(_sqrt_sin_chi) * 
+                                   Antioch::ant_exp( x * StateType(CoeffType(1.L) - _sin_chi)) -
                                    StateType(0.5L) *
-                                   Antioch::ant_exp( x/StateType(2.L) *
-                                            Antioch::ant_pow(Antioch::ant_cos(_chi),2) * 
-                                            (StateType(1.L) - this->erf(
-                                                                        Antioch::ant_sqrt( x / StateType(2.L)) * 
-                                                                        Antioch::ant_abs(Antioch::ant_cos(_chi))
-                                                                       )
-                                            )
-                                                   )
+                                   Antioch::ant_exp( u2 * Antioch::ant_exp(-u2) * 
+                                                     this->erfc_scaled(Antioch::ant_sqrt(x / StateType(2.L)) * StateType(_abs_cos_chi)) )
                                 );
   }
 
@@ -159,23 +378,210 @@ template <typename CoeffType = double>
   ANTIOCH_AUTO(StateType) Chapman<CoeffType>::chapman_medium_angles(const StateType &x) const
   {
      antioch_assert_less(_chi,rad(90.1L));antioch_assert_greater(_chi,rad(75.L));
+     // (1 - erf(u)) exp(u^2) = P(t), u^2 = x cos^2(chi) / 2
      return Antioch::ant_sqrt(Constants::pi<StateType>() * x/StateType(2.L)) * 
-            (StateType(1.L) - this->erf(Antioch::ant_sqrt(x/StateType(2.L))  * Antioch::ant_abs(Antioch::ant_cos(_chi)))) *
-            Antioch::ant_exp(x/StateType(2.L) * Antioch::ant_pow(Antioch::ant_cos(_chi),2));
+            this->erfc_scaled(Antioch::ant_sqrt(x/StateType(2.L)) * StateType(_abs_cos_chi));
   }
 
 
   template <typename CoeffType>
   template <typename StateType>
-  ANTIOCH_AUTO(StateType) Chapman<CoeffType>::erf(StateType x) const
-  {
-    if(x < 0.)x = -x;
-    return StateType(1.L) - (StateType( 0.254829592L)  * (StateType(1.L)/(StateType(1.L)                 + StateType(0.3275911L) * x))   +
-                             StateType(-0.284496736L)  * Antioch::ant_pow(StateType(1.L)/(StateType(1.L) + StateType(0.3275911L) * x),2) + 
-                             StateType( 1.421413741L)  * Antioch::ant_pow(StateType(1.L)/(StateType(1.L) + StateType(0.3275911L) * x),3) + 
-                             StateType(-1.453152027L)  * Antioch::ant_pow(StateType(1.L)/(StateType(1.L) + StateType(0.3275911L) * x),4) + 
-                             StateType( 1.061405429L)  * Antioch::ant_pow(StateType(1.L)/(StateType(1.L) + StateType(0.3275911L) * x),5)
-                            ) * Antioch::ant_exp(-Antioch::ant_pow(x,2));
+  inline
+  StateType Chapman<CoeffType>::erfc_scaled(const StateType &x) const
+  {
+    antioch_assert_greater_equal(x,StateType(0.L));
+    const StateType t = StateType(1.L)/(StateType(1.L) + StateType(0.3275911L) * x);
+    return t * (StateType( 0.254829592L) + t * (StateType(-0.284496736L) + t * (StateType( 1.421413741L) + 
+                t * (StateType(-1.453152027L) + t *  StateType( 1.061405429L)))));
+  }
+
+  template <typename CoeffType>
+  template <typename StateType>
+  inline
+  void Chapman<CoeffType>::erfc_scaled_and_deriv(const StateType &x, StateType &t, StateType &P, StateType &dP_dt) const
+  {
+    antioch_assert_greater_equal(x,StateType(0.L));
+    t = StateType(1.L)/(StateType(1.L) + StateType(0.3275911L) * x);
+    P = t * (StateType( 0.254829592L) + t * (StateType(-0.284496736L) + t * (StateType( 1.421413741L) + 
+             t * (StateType(-1.453152027L) + t *  StateType( 1.061405429L)))));
+    dP_dt = StateType( 0.254829592L) + t * (StateType(-0.284496736L) * StateType(2.L) + t * (StateType( 1.421413741L) * StateType(3.L) + 
+            t * (StateType(-1.453152027L) * StateType(4.L) + t *  StateType( 1.061405429L) * StateType(5.L))));
+  }
+
+  template <typename CoeffType>
+  template <typename StateType>
+  inline
+  StateType Chapman<CoeffType>::dchapman_medium_angles_dx(const StateType &x) const
+  {
+     antioch_assert_less(_chi,rad(90.1L));antioch_assert_greater(_chi,rad(75.L));
+     const StateType u = Antioch::ant_sqrt(x/StateType(2.L)) * StateType(_abs_cos_chi);
+     StateType t,P,dP_dt;
+     this->erfc_scaled_and_deriv(u,t,P,dP_dt);
+
+     // d/dx [sqrt(pi x / 2) P(t)], dt/du = - p t^2, du/dx = u / (2x)
+     return Antioch::ant_sqrt(Constants::pi<StateType>() * x/StateType(2.L)) / (StateType(2.L) * x) *
+            (P - dP_dt * StateType(0.3275911L) * t * t * u);
+  }
+
+  template <typename CoeffType>
+  template <typename StateType>
+  inline
+  StateType Chapman<CoeffType>::dchapman_high_angles_dx(const StateType &x) const
+  {
+     antioch_assert_greater(_chi,rad(90.L));antioch_assert_less(_chi,rad(180.L));
+     const StateType u  = Antioch::ant_sqrt(x/StateType(2.L)) * StateType(_abs_cos_chi);
+     const StateType u2 = u * u;
+     StateType t,P,dP_dt;
+     this->erfc_scaled_and_deriv(u,t,P,dP_dt);
+
+     // g = u^2 exp(-u^2) P(t), dg/dx = u^2 exp(-u^2) / x (P (1 - u^2) - u p t^2 P'(t) / 2)
+     const StateType g     = u2 * Antioch::ant_exp(-u2) * P;
+     const StateType dg_dx = u2 * Antioch::ant_exp(-u2) / x * 
+                             (P * (StateType(1.L) - u2) - u * StateType(0.3275911L) * t * t * dP_dt / StateType(2.L));
+
+     return this->chapman_high_angles(x) / (StateType(2.L) * x) +
+            Antioch::ant_sqrt(StateType(2.L) * Constants::pi<StateType>() * x) * 
+                       ( StateType(_sqrt_sin_chi) * StateType(CoeffType(1.L) - _sin_chi) * Antioch::ant_exp(x * StateType(CoeffType(1.L) - _sin_chi)) -
+                         StateType(0.5L) * dg_dx * Antioch::ant_exp(g) );
+  }
+
+  template <typename CoeffType>
+  inline
+  void Chapman<CoeffType>::build_table(const CoeffType &chi_min, const CoeffType &chi_max, 
+                                       const CoeffType &x_min,   const CoeffType &x_max, 
+                                       const CoeffType &tolerance, unsigned int max_nodes)
+  {
+     antioch_assert_greater(tolerance,CoeffType(0.L));
+     antioch_assert_less(chi_min,chi_max);
+
+     // approximations boundaries, degrees, surrounded by nodes so
+     // the cells changing of approximation are narrow, and kept analytical
+     const CoeffType boundaries[2] = {75.1L, 90.1L};
+     const CoeffType gap(1e-3L);
+
+     std::vector<CoeffType> chi_nodes;
+     for(unsigned int i = 0; i < 17; i++)chi_nodes.push_back(chi_min + (chi_max - chi_min) * CoeffType(i) / CoeffType(16));
+     for(unsigned int b = 0; b < 2; b++)
+     {
+        if(boundaries[b] - gap > chi_min && boundaries[b] + gap < chi_max)
+        {
+           chi_nodes.push_back(boundaries[b] - gap);
+           chi_nodes.push_back(boundaries[b]);
+           chi_nodes.push_back(boundaries[b] + gap);
+        }
+     }
+     std::sort(chi_nodes.begin(),chi_nodes.end());
+     chi_nodes.erase(std::unique(chi_nodes.begin(),chi_nodes.end()),chi_nodes.end());
+
+     Chapman<CoeffType> analytical;
+     unsigned int n_x(17);
+     std::vector<bool> split;
+     while(true)
+     {
+        _table.set_grid(chi_nodes,x_min,x_max,n_x);
+        for(unsigned int ichi = 0; ichi < _table.n_chi(); ichi++)
+        {
+           analytical.set_chi(_table.chi(ichi));
+           for(unsigned int ix = 0; ix < n_x; ix++)
+           {
+              _table.value(ichi,ix) = Antioch::ant_log(analytical.chapman(_table.x(ix))) - _table.x(ix) * analytical.growth_rate();
+           }
+        }
+        for(unsigned int icell = 0; icell < _table.n_chi() - 1; icell++)
+        {
+           analytical.set_chi(_table.chi(icell));
+           const unsigned int approx = analytical.approximation();
+           analytical.set_chi(_table.chi(icell + 1));
+           _table.set_exact_cell(icell,approx != analytical.approximation());
+        }
+
+        // errors at the middle of the x intervals on the chi nodes (x refinement),
+        // at the middle of the chi cells on the x nodes and at the centers (chi cell refinement)
+        CoeffType error_x(0.L), error(0.L);
+        split.assign(_table.n_chi() - 1,false);
+        for(unsigned int icell = 0; icell < _table.n_chi() - 1; icell++)
+        {
+           unsigned int cell;
+           CoeffType weight;
+           const CoeffType chi_mid = (_table.chi(icell) + _table.chi(icell + 1)) / CoeffType(2.L);
+           if(!_table.locate_chi(chi_mid,cell,weight))continue;
+           CoeffType error_cell(0.L);
+           for(unsigned int ix = 0; ix < n_x; ix++)
+           {
+              const CoeffType x_mid = (ix + 1 < n_x)?(_table.x(ix) + _table.x(ix + 1)) / CoeffType(2.L):_table.x(ix);
+
+              analytical.set_chi(chi_mid);
+              CoeffType growth = analytical.growth_rate();
+              CoeffType exact  = analytical.chapman(_table.x(ix));
+              CoeffType interp = Antioch::ant_exp(_table.interpolate(cell,weight,_table.x(ix)) + _table.x(ix) * growth);
+              error_cell = std::max(error_cell,Antioch::ant_abs(interp - exact) / exact);
+              exact  = analytical.chapman(x_mid);
+              interp = Antioch::ant_exp(_table.interpolate(cell,weight,x_mid) + x_mid * growth);
+              error_cell = std::max(error_cell,Antioch::ant_abs(interp - exact) / exact);
+
+              for(unsigned int inode = 0; inode < 2; inode++)
+              {
+                 analytical.set_chi(_table.chi(icell + inode));
+                 growth = analytical.growth_rate();
+                 exact  = analytical.chapman(x_mid);
+                 interp = Antioch::ant_exp(_table.interpolate(icell,CoeffType(inode),x_mid) + x_mid * growth);
+                 error_x = std::max(error_x,Antioch::ant_abs(interp - exact) / exact);
+              }
+           }
+           split[icell] = (error_cell > tolerance / CoeffType(2.L));
+           error = std::max(error,error_cell);
+        }
+        _table.set_error(std::max(error,error_x));
+
+        if(_table.error() < tolerance)break;
+
+        // chi cells are split where needed, the x grid is refined as a whole
+        std::vector<CoeffType> next_chi;
+        for(unsigned int icell = 0; icell < _table.n_chi() - 1; icell++)
+        {
+           next_chi.push_back(_table.chi(icell));
+           if(split[icell])next_chi.push_back((_table.chi(icell) + _table.chi(icell + 1)) / CoeffType(2.L));
+        }
+        next_chi.push_back(_table.chi(_table.n_chi() - 1));
+        const unsigned int next_x = (error_x > tolerance / CoeffType(2.L))?2 * n_x - 1:n_x;
+
+        if(next_chi.size() * next_x > max_nodes || (next_chi.size() == chi_nodes.size() && next_x == n_x))break;
+        chi_nodes.swap(next_chi);
+        n_x = next_x;
+     }
+
+     this->update_chi_terms();
+
+     return;
+  }
+
+  template <typename CoeffType>
+  inline
+  void Chapman<CoeffType>::clear_table()
+  {
+     _table = ChapmanTable<CoeffType>();
+     this->update_chi_terms();
+  }
+
+  template <typename CoeffType>
+  inline
+  bool Chapman<CoeffType>::tabulated() const
+  {
+     return !_table.empty();
+  }
+
+  template <typename CoeffType>
+  inline
+  const ChapmanTable<CoeffType> & Chapman<CoeffType>::table() const
+  {
+     return _table;
+  }
+
+  template <typename CoeffType>
+  inline
+  CoeffType Chapman<CoeffType>::table_error() const
+  {
+     return _table.error();
   }
 
 }
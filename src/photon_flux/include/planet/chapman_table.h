@@ -0,0 +1,298 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// Planet - An atmospheric code for planetary bodies, adapted to Titan
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+
+#ifndef PLANET_CHAPMAN_TABLE_H
+#define PLANET_CHAPMAN_TABLE_H
+
+//Antioch
+#include "antioch/antioch_asserts.h"
+
+//C++
+#include <vector>
+#include <algorithm>
+
+namespace Planet{
+
+  /*!
+   * Tabulated Chapman function on a (chi,x) grid, chi in degrees, with
+   * bilinear interpolation. The x nodes are uniform, the chi nodes are
+   * refined where needed and located once per angle. The table is filled
+   * and its interpolation error controlled by Chapman::build_table(), which
+   * stores ln(Chap) minus its exponential growth at high angles.
+   *
+   * The Chapman function is not continuous between the low, medium and
+   * high angles approximations (chi = 75.1 and 90.1 degrees), the chi cells
+   * changing of approximation are flagged and not interpolated.
+   */
+  template <typename CoeffType = double>
+  class ChapmanTable{
+     private:
+
+//grid
+        std::vector<CoeffType> _chi_nodes;
+        CoeffType _x_min, _x_max;
+        CoeffType _dx;
+        unsigned int _n_x;
+
+//store, chi x x, x fastest
+        std::vector<CoeffType> _values;
+        std::vector<bool>      _exact_cell;
+
+        CoeffType _error;
+
+     public:
+        ChapmanTable();
+        ~ChapmanTable();
+
+        //! sets the grid, increasing chi nodes and n_x uniform x nodes
+        void set_grid(const std::vector<CoeffType> &chi_nodes,
+                      const CoeffType &x_min, const CoeffType &x_max, unsigned int n_x);
+
+        //! value at node (ichi,ix), writable
+        CoeffType &value(unsigned int ichi, unsigned int ix);
+
+        //! value at node (ichi,ix)
+        const CoeffType &value(unsigned int ichi, unsigned int ix) const;
+
+        //! chi cell icell is not interpolated
+        void set_exact_cell(unsigned int icell, bool exact);
+
+        //! chi cell and weight, false if chi is out of range or in a non interpolated cell
+        bool locate_chi(const CoeffType &chi, unsigned int &icell, CoeffType &weight) const;
+
+        //! x in range
+        template <typename StateType>
+        bool in_range(const StateType &x) const;
+
+        //! interpolated value at x in the chi cell located by locate_chi()
+        template <typename StateType>
+        StateType interpolate(unsigned int icell, const CoeffType &weight, const StateType &x) const;
+
+        //! derivative in x of the interpolated value, constant on each x cell
+        template <typename StateType>
+        StateType interpolate_dx(unsigned int icell, const CoeffType &weight, const StateType &x) const;
+
+        //! stores the interpolation error
+        void set_error(const CoeffType &error);
+
+        //!\return the maximum relative interpolation error measured at build
+        CoeffType error() const;
+
+        //!\return true if the table is filled
+        bool empty() const;
+
+        //!\return number of chi nodes
+        unsigned int n_chi() const;
+
+        //!\return number of x nodes
+        unsigned int n_x() const;
+
+        //!\return chi of node ichi, degrees
+        CoeffType chi(unsigned int ichi) const;
+
+        //!\return chi nodes, degrees
+        const std::vector<CoeffType> &chi_nodes() const;
+
+        //!\return x of node ix
+        CoeffType x(unsigned int ix) const;
+  };
+
+  template <typename CoeffType>
+  inline
+  ChapmanTable<CoeffType>::ChapmanTable():
+     _x_min(0.L),_x_max(0.L),
+     _dx(0.L),
+     _n_x(0),
+     _error(0.L)
+  {
+     return;
+  }
+
+  template <typename CoeffType>
+  inline
+  ChapmanTable<CoeffType>::~ChapmanTable()
+  {
+     return;
+  }
+
+  template <typename CoeffType>
+  inline
+  void ChapmanTable<CoeffType>::set_grid(const std::vector<CoeffType> &chi_nodes,
+                                         const CoeffType &x_min, const CoeffType &x_max, unsigned int n_x)
+  {
+     antioch_assert_greater(chi_nodes.size(),1);
+     antioch_assert_greater(n_x,1);
+     antioch_assert_less(x_min,x_max);
+
+     _chi_nodes = chi_nodes;
+     _x_min     = x_min;
+     _x_max     = x_max;
+     _n_x       = n_x;
+     _dx        = (_x_max - _x_min) / CoeffType(_n_x - 1);
+
+     _values.assign(_chi_nodes.size() * _n_x,0.L);
+     _exact_cell.assign(_chi_nodes.size() - 1,false);
+     _error = 0.L;
+
+     return;
+  }
+
+  template <typename CoeffType>
+  inline
+  CoeffType &ChapmanTable<CoeffType>::value(unsigned int ichi, unsigned int ix)
+  {
+     return _values[ichi * _n_x + ix];
+  }
+
+  template <typename CoeffType>
+  inline
+  const CoeffType &ChapmanTable<CoeffType>::value(unsigned int ichi, unsigned int ix) const
+  {
+     return _values[ichi * _n_x + ix];
+  }
+
+  template <typename CoeffType>
+  inline
+  void ChapmanTable<CoeffType>::set_exact_cell(unsigned int icell, bool exact)
+  {
+     _exact_cell[icell] = exact;
+  }
+
+  template <typename CoeffType>
+  inline
+  bool ChapmanTable<CoeffType>::locate_chi(const CoeffType &chi, unsigned int &icell, CoeffType &weight) const
+  {
+     if(this->empty() || chi < _chi_nodes.front() || chi > _chi_nodes.back())return false;
+
+     icell = std::upper_bound(_chi_nodes.begin(),_chi_nodes.end(),chi) - _chi_nodes.begin();
+     icell = (icell > 0)?icell - 1:0;
+     if(icell >= _chi_nodes.size() - 1)icell = _chi_nodes.size() - 2;
+     weight = (chi - _chi_nodes[icell]) / (_chi_nodes[icell + 1] - _chi_nodes[icell]);
+
+     return !_exact_cell[icell];
+  }
+
+  template <typename CoeffType>
+  template <typename StateType>
+  inline
+  bool ChapmanTable<CoeffType>::in_range(const StateType &x) const
+  {
+     return (x >= _x_min && x <= _x_max);
+  }
+
+  template <typename CoeffType>
+  template <typename StateType>
+  inline
+  StateType ChapmanTable<CoeffType>::interpolate(unsigned int icell, const CoeffType &weight, const StateType &x) const
+  {
+     StateType pos = (x - _x_min) / _dx;
+     unsigned int ix = (unsigned int)(pos);
+     if(ix >= _n_x - 1)ix = _n_x - 2;
+     const StateType wx = pos - StateType(ix);
+
+     const CoeffType * low  = &_values[icell * _n_x + ix];
+     const CoeffType * high = low + _n_x;
+
+     const StateType value_low  = StateType(low[0])  + wx * StateType(low[1]  - low[0]);
+     const StateType value_high = StateType(high[0]) + wx * StateType(high[1] - high[0]);
+
+     return value_low + StateType(weight) * (value_high - value_low);
+  }
+
+  template <typename CoeffType>
+  template <typename StateType>
+  inline
+  StateType ChapmanTable<CoeffType>::interpolate_dx(unsigned int icell, const CoeffType &weight, const StateType &x) const
+  {
+     StateType pos = (x - _x_min) / _dx;
+     unsigned int ix = (unsigned int)(pos);
+     if(ix >= _n_x - 1)ix = _n_x - 2;
+
+     const CoeffType * low  = &_values[icell * _n_x + ix];
+     const CoeffType * high = low + _n_x;
+
+     const StateType slope_low  = StateType(low[1]  - low[0]);
+     const StateType slope_high = StateType(high[1] - high[0]);
+
+     return (slope_low + StateType(weight) * (slope_high - slope_low)) / StateType(_dx);
+  }
+
+  template <typename CoeffType>
+  inline
+  void ChapmanTable<CoeffType>::set_error(const CoeffType &error)
+  {
+     _error = error;
+  }
+
+  template <typename CoeffType>
+  inline
+  CoeffType ChapmanTable<CoeffType>::error() const
+  {
+     return _error;
+  }
+
+  template <typename CoeffType>
+  inline
+  bool ChapmanTable<CoeffType>::empty() const
+  {
+     return _values.empty();
+  }
+
+  template <typename CoeffType>
+  inline
+  unsigned int ChapmanTable<CoeffType>::n_chi() const
+  {
+     return _chi_nodes.size();
+  }
+
+  template <typename CoeffType>
+  inline
+  unsigned int ChapmanTable<CoeffType>::n_x() const
+  {
+     return _n_x;
+  }
+
+  template <typename CoeffType>
+  inline
+  CoeffType ChapmanTable<CoeffType>::chi(unsigned int ichi) const
+  {
+     return _chi_nodes[ichi];
+  }
+
+  template <typename CoeffType>
+  inline
+  const std::vector<CoeffType> &ChapmanTable<CoeffType>::chi_nodes() const
+  {
+     return _chi_nodes;
+  }
+
+  template <typename CoeffType>
+  inline
+  CoeffType ChapmanTable<CoeffType>::x(unsigned int ix) const
+  {
+     return _x_min + CoeffType(ix) * _dx;
+  }
+
+}
+
+#endif
@@ -0,0 +1,581 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// Planet - An atmospheric code for planetary bodies, adapted to Titan
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+
+#ifndef PLANET_PHOTOLYSIS_EVALUATOR_H
+#define PLANET_PHOTOLYSIS_EVALUATOR_H
+
+//Antioch
+#include "antioch/antioch_asserts.h"
+#include "antioch/metaprogramming_decl.h"
+
+//Planet
+#include "planet/cross_section.h"
+#include "planet/photon_opacity.h"
+
+//Eigen
+#include <Eigen/Dense>
+
+//C++
+#include <vector>
+#include <string>
+#include <type_traits>
+
+namespace Planet
+{
+  /*!
+   * J-value engine: the photolysis channels cross-sections are
+   * brought once on the photon flux grid, along with the
+   * quadrature weights, to give the weight matrix
+   *
+   * \f$W_{r,l} = \sigma_r(\lambda_l) (\lambda_{l+1} - \lambda_l)\f$
+   *
+   * the last bin having no weight (left point rule, as in Antioch's
+   * photochemical rate). All the photolysis rate constants at a point
+   * are then one matrix-vector product with the photon flux
+   * at this point, \f$J = W \phi(z)\f$.
+   *
+   * The flux depends on the densities through the opacity,
+   * \f$\phi = \phi_\text{top} \exp(-\tau)\f$, so
+   * \f$\partial J / \partial n_i = - W (\phi \partial\tau/\partial n_i)\f$
+   * with \f$\partial\tau/\partial n_i = \tau \partial\ln\text{Chap}/\partial n_i
+   * + \text{Chap}\,\sigma_i \partial N_i/\partial n_i\f$, \f$N_i\f$ being the
+   * column density.
+   *
+   * Mixed precision: a PhotolysisEvaluator<float> (see copy_photolysis())
+   * given a float flux and double rates does the products in float,
+   * accumulated by lambda blocks in double. The rates only are mixed,
+   * the derivatives need the flux and tau in the precision of the state:
+   * PlanetPhysicsHelper builds no float evaluator, the solver evaluating
+   * the jacobian at each call.
+   */
+  template <typename CoeffType, typename VectorCoeffType>
+  class PhotolysisEvaluator
+  {
+        private:
+
+//store
+          std::vector<CrossSection<VectorCoeffType> >  _channels_cs;
+          std::vector<std::string>                     _equations;
+          std::vector<unsigned int>                    _reactant;
+          std::vector<std::vector<unsigned int> >      _products;
+          std::vector<std::vector<unsigned int> >      _products_stoi;
+
+//precomputed, channels x lambda
+          Eigen::Matrix<CoeffType,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor> _weights;
+
+          //! lambda block size of the mixed precision product
+          static const unsigned int _block_size = 256;
+
+          //! weights from the cross-sections on the custom grid
+          template<typename VectorStateType>
+          void build_weights(const VectorStateType &custom_grid);
+
+          //! J = W phy in the precision of the rates
+          template<typename VectorFluxType, typename VectorStateType>
+          void rates_product(const VectorFluxType &flux_at_z, VectorStateType &rates, std::true_type) const;
+
+          //! W phy in the precision of the flux by lambda blocks, accumulated in the precision of the rates
+          template<typename VectorFluxType, typename VectorStateType>
+          void rates_product(const VectorFluxType &flux_at_z, VectorStateType &rates, std::false_type) const;
+
+          template <typename OtherCoeffType, typename OtherVectorCoeffType>
+          friend class PhotolysisEvaluator;
+
+        public:
+          PhotolysisEvaluator();
+          ~PhotolysisEvaluator();
+
+          //!adds a photolysis channel, reactant -> products
+          template<typename VectorStateType>
+          void add_photolysis(const std::string &equation,
+                              const VectorStateType &lambda, const VectorStateType &cs, unsigned int reactant,
+                              const std::vector<unsigned int> &products, const std::vector<unsigned int> &products_stoi);
+
+          //!brings the cross-sections on the custom grid and builds the weights
+          template<typename VectorStateType>
+          void update_cross_section(const VectorStateType &custom_grid);
+
+          //!merges the bins of the custom grid and rebuilds the weights, see CrossSection::coarsen_cross_section()
+          template<typename VectorStateType>
+          void coarsen_cross_section(const std::vector<unsigned int> &bin_starts, const VectorStateType &custom_grid);
+
+          /*! replaces the channels by the ones of \p rhs, cross-sections and
+           *  weights rounded to CoeffType, e.g. a float evaluator from the double one
+           */
+          template<typename OtherCoeffType, typename OtherVectorCoeffType>
+          void copy_photolysis(const PhotolysisEvaluator<OtherCoeffType,OtherVectorCoeffType> &rhs);
+
+          //! J = W phy, one matrix-vector product
+          template<typename VectorFluxType, typename VectorStateType>
+          void photolysis_rates(const VectorFluxType &flux_at_z, VectorStateType &rates) const;
+
+          /*! J and dJ/dn through the Chapman factor, drates_dn[r][i] = - (W (phy tau))_r d ln(Chap)/d n_i
+           *
+           *  \p dlog_chapman_dn is given by PhotonEvaluator::update_photon_flux_and_derivs()
+           */
+          template<typename VectorStateType, typename MatrixStateType>
+          void photolysis_rates_and_derivs(const VectorStateType &flux_at_z, const VectorStateType &tau_at_z, 
+                                           const VectorStateType &dlog_chapman_dn,
+                                           VectorStateType &rates, MatrixStateType &drates_dn) const;
+
+          /*! adds the column densities contribution to dJ/dn,
+           *  drates_dn[r][i] -= dcolumn_dn[i] (W (phy sigma_i))_r
+           *
+           *  with dcolumn_dn[i] = Chap * d N_i / d n_i
+           */
+          template<typename VectorStateType, typename MatrixStateType>
+          void add_column_derivs(const VectorStateType &flux_at_z, const PhotonOpacity<CoeffType,VectorCoeffType> &opacity,
+                                 const VectorStateType &dcolumn_dn, MatrixStateType &drates_dn) const;
+
+          //! adds the photolysis sources to kin_rates
+          template<typename VectorStateType>
+          void add_mole_sources(const VectorStateType &rates, const VectorStateType &molar_concentrations, 
+                                VectorStateType &kin_rates) const;
+
+          //! adds the photolysis sources to kin_rates and their derivatives at fixed photon flux
+          template<typename VectorStateType, typename MatrixStateType>
+          void add_mole_sources_and_derivs(const VectorStateType &rates, const VectorStateType &molar_concentrations, 
+                                           VectorStateType &kin_rates, MatrixStateType &dkin_rates_dn) const;
+
+          //! adds the photolysis sources to kin_rates and their derivatives, photon flux included
+          template<typename VectorStateType, typename MatrixStateType>
+          void add_mole_sources_and_derivs(const VectorStateType &rates, const MatrixStateType &drates_dn,
+                                           const VectorStateType &molar_concentrations, 
+                                           VectorStateType &kin_rates, MatrixStateType &dkin_rates_dn) const;
+
+          /*! adds the photolysis sources to kin_rates and their derivatives, photon flux included,
+           *  in the CSR pattern \p row_ptr where the rows of the reactants and products are full
+           */
+          template<typename VectorStateType, typename MatrixStateType>
+          void add_mole_sources_and_sparse_derivs(const VectorStateType &rates, const MatrixStateType &drates_dn,
+                                                  const VectorStateType &molar_concentrations, VectorStateType &kin_rates,
+                                                  const std::vector<unsigned int> &row_ptr, VectorStateType &jacobian_values) const;
+
+          //!\return number of photolysis channels
+          unsigned int n_photolysis() const;
+
+          //!\return reactant of channel r
+          unsigned int reactant(unsigned int r) const;
+
+          //!\return products of channel r
+          const std::vector<unsigned int> &products(unsigned int r) const;
+
+          //!\return stoichiometric coefficients of the products of channel r
+          const std::vector<unsigned int> &products_stoichiometry(unsigned int r) const;
+
+          //!\return equation of channel r
+          const std::string &equation(unsigned int r) const;
+
+          //!\return the weights matrix, channels x lambda
+          const Eigen::Matrix<CoeffType,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor> &weights() const;
+
+  };
+
+  template<typename CoeffType, typename VectorCoeffType>
+  inline
+  PhotolysisEvaluator<CoeffType,VectorCoeffType>::PhotolysisEvaluator()
+  {
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  inline
+  PhotolysisEvaluator<CoeffType,VectorCoeffType>::~PhotolysisEvaluator()
+  {
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  template<typename VectorStateType>
+  inline
+  void PhotolysisEvaluator<CoeffType,VectorCoeffType>::add_photolysis(const std::string &equation,
+                                                                      const VectorStateType &lambda, const VectorStateType &cs, unsigned int reactant,
+                                                                      const std::vector<unsigned int> &products, const std::vector<unsigned int> &products_stoi)
+  {
+     antioch_assert_equal_to(lambda.size(),cs.size());
+     antioch_assert_equal_to(products.size(),products_stoi.size());
+
+     _equations.push_back(equation);
+     _channels_cs.emplace_back(lambda,cs);
+     _reactant.push_back(reactant);
+     _products.push_back(products);
+     _products_stoi.push_back(products_stoi);
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  template<typename VectorStateType>
+  inline
+  void PhotolysisEvaluator<CoeffType,VectorCoeffType>::update_cross_section(const VectorStateType &custom_grid)
+  {
+     for(unsigned int r = 0; r < _channels_cs.size(); r++)
+     {
+        _channels_cs[r].update_cross_section(custom_grid);
+     }
+
+     this->build_weights(custom_grid);
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  template<typename VectorStateType>
+  inline
+  void PhotolysisEvaluator<CoeffType,VectorCoeffType>::coarsen_cross_section(const std::vector<unsigned int> &bin_starts, const VectorStateType &custom_grid)
+  {
+     for(unsigned int r = 0; r < _channels_cs.size(); r++)
+     {
+        _channels_cs[r].coarsen_cross_section(bin_starts,custom_grid);
+     }
+
+     VectorStateType coarse_grid(bin_starts.size());
+     for(unsigned int k = 0; k < bin_starts.size(); k++)
+     {
+        coarse_grid[k] = custom_grid[bin_starts[k]];
+     }
+
+     this->build_weights(coarse_grid);
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  template<typename VectorStateType>
+  inline
+  void PhotolysisEvaluator<CoeffType,VectorCoeffType>::build_weights(const VectorStateType &custom_grid)
+  {
+     _weights.resize(_channels_cs.size(),custom_grid.size());
+     _weights.setZero();
+
+     for(unsigned int r = 0; r < _channels_cs.size(); r++)
+     {
+        antioch_assert_equal_to(_channels_cs[r].cross_section_on_custom_grid().size(),custom_grid.size());
+        for(unsigned int il = 0; il + 1 < custom_grid.size(); il++)
+        {
+          _weights(r,il) = _channels_cs[r].cross_section_on_custom_grid()[il] * (custom_grid[il+1] - custom_grid[il]);
+        }
+     }
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  template<typename OtherCoeffType, typename OtherVectorCoeffType>
+  inline
+  void PhotolysisEvaluator<CoeffType,VectorCoeffType>::copy_photolysis(const PhotolysisEvaluator<OtherCoeffType,OtherVectorCoeffType> &rhs)
+  {
+     _equations     = rhs._equations;
+     _reactant      = rhs._reactant;
+     _products      = rhs._products;
+     _products_stoi = rhs._products_stoi;
+
+     _channels_cs.clear();
+     _channels_cs.reserve(rhs._channels_cs.size());
+     for(unsigned int r = 0; r < rhs._channels_cs.size(); r++)
+     {
+        _channels_cs.emplace_back(rhs._channels_cs[r]);
+     }
+
+     // weights built in the precision of rhs, then rounded
+     _weights = rhs._weights.template cast<CoeffType>();
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  template<typename VectorFluxType, typename VectorStateType>
+  inline
+  void PhotolysisEvaluator<CoeffType,VectorCoeffType>::photolysis_rates(const VectorFluxType &flux_at_z, VectorStateType &rates) const
+  {
+     antioch_assert_equal_to(flux_at_z.size(),(std::size_t)_weights.cols());
+
+     typedef typename Antioch::value_type<VectorStateType>::type Scalar;
+     typedef typename Antioch::value_type<VectorFluxType>::type  FluxScalar;
+
+     rates.resize(_channels_cs.size());
+     if(_channels_cs.empty())return;
+
+     this->rates_product(flux_at_z,rates,std::is_same<Scalar,FluxScalar>());
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  template<typename VectorFluxType, typename VectorStateType>
+  inline
+  void PhotolysisEvaluator<CoeffType,VectorCoeffType>::rates_product(const VectorFluxType &flux_at_z, VectorStateType &rates, std::true_type) const
+  {
+     typedef typename Antioch::value_type<VectorStateType>::type Scalar;
+
+     Eigen::Map<Eigen::Matrix<Scalar,Eigen::Dynamic,1> >(&rates[0],rates.size()).noalias() = 
+                 _weights.template cast<Scalar>() * Eigen::Map<const Eigen::Matrix<Scalar,Eigen::Dynamic,1> >(&flux_at_z[0],flux_at_z.size());
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  template<typename VectorFluxType, typename VectorStateType>
+  inline
+  void PhotolysisEvaluator<CoeffType,VectorCoeffType>::rates_product(const VectorFluxType &flux_at_z, VectorStateType &rates, std::false_type) const
+  {
+     typedef typename Antioch::value_type<VectorStateType>::type Scalar;
+     typedef typename Antioch::value_type<VectorFluxType>::type  FluxScalar;
+     typedef Eigen::Array<FluxScalar,Eigen::Dynamic,1>           ArrayFlux;
+
+     const unsigned int n_lambda = flux_at_z.size();
+     for(unsigned int r = 0; r < rates.size(); r++)
+     {
+        Scalar rate(0.L);
+        for(unsigned int il = 0; il < n_lambda; il += _block_size) //lambda blocks
+        {
+           const unsigned int nl = (il + _block_size < n_lambda)?_block_size:n_lambda - il;
+           rate += Scalar((_weights.row(r).segment(il,nl).transpose().array().template cast<FluxScalar>() * 
+                           Eigen::Map<const ArrayFlux>(&flux_at_z[il],nl)).sum());
+        }
+        rates[r] = rate;
+     }
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  template<typename VectorStateType, typename MatrixStateType>
+  inline
+  void PhotolysisEvaluator<CoeffType,VectorCoeffType>::photolysis_rates_and_derivs(const VectorStateType &flux_at_z, const VectorStateType &tau_at_z, 
+                                                                                   const VectorStateType &dlog_chapman_dn,
+                                                                                   VectorStateType &rates, MatrixStateType &drates_dn) const
+  {
+     antioch_assert_equal_to(tau_at_z.size(),flux_at_z.size());
+     antioch_assert_equal_to(drates_dn.size(),_channels_cs.size());
+
+     typedef typename Antioch::value_type<VectorStateType>::type Scalar;
+     typedef Eigen::Array<Scalar,Eigen::Dynamic,1> ArrayState;
+
+     this->photolysis_rates(flux_at_z,rates);
+
+     const Eigen::Map<const ArrayState> phy(&flux_at_z[0],flux_at_z.size());
+     const Eigen::Map<const ArrayState> tau(&tau_at_z[0],tau_at_z.size());
+     for(unsigned int r = 0; r < _channels_cs.size(); r++)
+     {
+        antioch_assert_equal_to(drates_dn[r].size(),dlog_chapman_dn.size());
+        const Scalar W_phy_tau = (_weights.row(r).transpose().array().template cast<Scalar>() * phy * tau).sum();
+        for(unsigned int i = 0; i < dlog_chapman_dn.size(); i++)
+        {
+           drates_dn[r][i] = - W_phy_tau * dlog_chapman_dn[i];
+        }
+     }
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  template<typename VectorStateType, typename MatrixStateType>
+  inline
+  void PhotolysisEvaluator<CoeffType,VectorCoeffType>::add_column_derivs(const VectorStateType &flux_at_z, const PhotonOpacity<CoeffType,VectorCoeffType> &opacity,
+                                                                         const VectorStateType &dcolumn_dn, MatrixStateType &drates_dn) const
+  {
+     antioch_assert_equal_to(opacity.n_lambda(),flux_at_z.size());
+     antioch_assert_equal_to(drates_dn.size(),_channels_cs.size());
+
+     typedef typename Antioch::value_type<VectorStateType>::type Scalar;
+     typedef Eigen::Array<Scalar,Eigen::Dynamic,1>    ArrayState;
+     typedef Eigen::Array<CoeffType,Eigen::Dynamic,1> ArrayCoeff;
+
+     const Eigen::Map<const ArrayState> phy(&flux_at_z[0],flux_at_z.size());
+     for(unsigned int k = 0; k < opacity.absorbing_species_id().size(); k++)
+     {
+        const unsigned int i = opacity.absorbing_species_id()[k];
+        if(dcolumn_dn[i] == Scalar(0.))continue;
+
+        const Eigen::Map<const ArrayCoeff,Eigen::Aligned> sigma(&opacity.packed_cross_sections()[k * opacity.lambda_stride()],opacity.n_lambda());
+        for(unsigned int r = 0; r < _channels_cs.size(); r++)
+        {
+           drates_dn[r][i] -= dcolumn_dn[i] * (_weights.row(r).transpose().array().template cast<Scalar>() * phy * sigma.template cast<Scalar>()).sum();
+        }
+     }
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  template<typename VectorStateType>
+  inline
+  void PhotolysisEvaluator<CoeffType,VectorCoeffType>::add_mole_sources(const VectorStateType &rates, const VectorStateType &molar_concentrations, 
+                                                                        VectorStateType &kin_rates) const
+  {
+     antioch_assert_equal_to(rates.size(),_channels_cs.size());
+
+     for(unsigned int r = 0; r < _channels_cs.size(); r++)
+     {
+        const typename Antioch::value_type<VectorStateType>::type rate = rates[r] * molar_concentrations[_reactant[r]];
+        kin_rates[_reactant[r]] -= rate;
+        for(unsigned int p = 0; p < _products[r].size(); p++)
+        {
+           kin_rates[_products[r][p]] += rate * typename Antioch::value_type<VectorStateType>::type(_products_stoi[r][p]);
+        }
+     }
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  template<typename VectorStateType, typename MatrixStateType>
+  inline
+  void PhotolysisEvaluator<CoeffType,VectorCoeffType>::add_mole_sources_and_derivs(const VectorStateType &rates, const VectorStateType &molar_concentrations, 
+                                                                                   VectorStateType &kin_rates, MatrixStateType &dkin_rates_dn) const
+  {
+     antioch_assert_equal_to(rates.size(),_channels_cs.size());
+
+     for(unsigned int r = 0; r < _channels_cs.size(); r++)
+     {
+        const unsigned int reac = _reactant[r];
+        const typename Antioch::value_type<VectorStateType>::type rate = rates[r] * molar_concentrations[reac];
+        kin_rates[reac]           -= rate;
+        dkin_rates_dn[reac][reac] -= rates[r];
+        for(unsigned int p = 0; p < _products[r].size(); p++)
+        {
+           kin_rates[_products[r][p]]           += rate     * typename Antioch::value_type<VectorStateType>::type(_products_stoi[r][p]);
+           dkin_rates_dn[_products[r][p]][reac] += rates[r] * typename Antioch::value_type<VectorStateType>::type(_products_stoi[r][p]);
+        }
+     }
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  template<typename VectorStateType, typename MatrixStateType>
+  inline
+  void PhotolysisEvaluator<CoeffType,VectorCoeffType>::add_mole_sources_and_derivs(const VectorStateType &rates, const MatrixStateType &drates_dn,
+                                                                                   const VectorStateType &molar_concentrations, 
+                                                                                   VectorStateType &kin_rates, MatrixStateType &dkin_rates_dn) const
+  {
+     antioch_assert_equal_to(drates_dn.size(),_channels_cs.size());
+
+     this->add_mole_sources_and_derivs(rates,molar_concentrations,kin_rates,dkin_rates_dn);
+
+     for(unsigned int r = 0; r < _channels_cs.size(); r++)
+     {
+        const unsigned int reac = _reactant[r];
+        for(unsigned int i = 0; i < drates_dn[r].size(); i++)
+        {
+           const typename Antioch::value_type<VectorStateType>::type drate = drates_dn[r][i] * molar_concentrations[reac];
+           dkin_rates_dn[reac][i] -= drate;
+           for(unsigned int p = 0; p < _products[r].size(); p++)
+           {
+              dkin_rates_dn[_products[r][p]][i] += drate * typename Antioch::value_type<VectorStateType>::type(_products_stoi[r][p]);
+           }
+        }
+     }
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  template<typename VectorStateType, typename MatrixStateType>
+  inline
+  void PhotolysisEvaluator<CoeffType,VectorCoeffType>::add_mole_sources_and_sparse_derivs(const VectorStateType &rates, const MatrixStateType &drates_dn,
+                                                                                          const VectorStateType &molar_concentrations, VectorStateType &kin_rates,
+                                                                                          const std::vector<unsigned int> &row_ptr, VectorStateType &jacobian_values) const
+  {
+     antioch_assert_equal_to(rates.size(),_channels_cs.size());
+     antioch_assert_equal_to(drates_dn.size(),_channels_cs.size());
+
+     // full rows, column i of row s is at row_ptr[s] + i
+     for(unsigned int r = 0; r < _channels_cs.size(); r++)
+     {
+        const unsigned int reac = _reactant[r];
+        antioch_assert_equal_to(row_ptr[reac + 1] - row_ptr[reac],molar_concentrations.size());
+        const typename Antioch::value_type<VectorStateType>::type rate = rates[r] * molar_concentrations[reac];
+        kin_rates[reac]                        -= rate;
+        jacobian_values[row_ptr[reac] + reac]  -= rates[r];
+        for(unsigned int p = 0; p < _products[r].size(); p++)
+        {
+           antioch_assert_equal_to(row_ptr[_products[r][p] + 1] - row_ptr[_products[r][p]],molar_concentrations.size());
+           kin_rates[_products[r][p]]                       += rate     * typename Antioch::value_type<VectorStateType>::type(_products_stoi[r][p]);
+           jacobian_values[row_ptr[_products[r][p]] + reac] += rates[r] * typename Antioch::value_type<VectorStateType>::type(_products_stoi[r][p]);
+        }
+     }
+
+     for(unsigned int r = 0; r < _channels_cs.size(); r++)
+     {
+        const unsigned int reac = _reactant[r];
+        for(unsigned int i = 0; i < drates_dn[r].size(); i++)
+        {
+           const typename Antioch::value_type<VectorStateType>::type drate = drates_dn[r][i] * molar_concentrations[reac];
+           jacobian_values[row_ptr[reac] + i] -= drate;
+           for(unsigned int p = 0; p < _products[r].size(); p++)
+           {
+              jacobian_values[row_ptr[_products[r][p]] + i] += drate * typename Antioch::value_type<VectorStateType>::type(_products_stoi[r][p]);
+           }
+        }
+     }
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  inline
+  unsigned int PhotolysisEvaluator<CoeffType,VectorCoeffType>::n_photolysis() const
+  {
+     return _channels_cs.size();
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  inline
+  unsigned int PhotolysisEvaluator<CoeffType,VectorCoeffType>::reactant(unsigned int r) const
+  {
+     return _reactant[r];
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  inline
+  const std::vector<unsigned int> &PhotolysisEvaluator<CoeffType,VectorCoeffType>::products(unsigned int r) const
+  {
+     return _products[r];
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  inline
+  const std::vector<unsigned int> &PhotolysisEvaluator<CoeffType,VectorCoeffType>::products_stoichiometry(unsigned int r) const
+  {
+     return _products_stoi[r];
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  inline
+  const std::string &PhotolysisEvaluator<CoeffType,VectorCoeffType>::equation(unsigned int r) const
+  {
+     return _equations[r];
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  inline
+  const Eigen::Matrix<CoeffType,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor> &PhotolysisEvaluator<CoeffType,VectorCoeffType>::weights() const
+  {
+     return _weights;
+  }
+
+}
+
+#endif
@@ -50,6 +50,10 @@ namespace Planet
         const PhotonOpacity<CoeffType,VectorCoeffType>                      & _hv_tau;
         const AtmosphericMixture<CoeffType,VectorCoeffType,MatrixCoeffType> & _mixture;
 
+//scratch of the flux derivatives
+        VectorCoeffType _tau_at_z;
+        VectorCoeffType _dlog_chapman_dn;
+
      public:
         PhotonEvaluator(const Antioch::ParticleFlux<VectorCoeffType>                        &phy_at_top,
                         const PhotonOpacity<CoeffType,VectorCoeffType>                      &hv_tau, 
@@ -59,11 +63,54 @@ namespace Planet
         //!\return photon flux at top of atmosphere
         const Antioch::ParticleFlux<VectorCoeffType> &photon_flux_at_top() const;
 
+        //!\return opacity
+        const PhotonOpacity<CoeffType,VectorCoeffType> &photon_opacity() const;
+
+        //!\return Chap(a) * 1e5 at these densities
+        template<typename StateType, typename VectorStateType>
+        StateType chapman_factor(const VectorStateType &molar_densities, const StateType &z) const;
+
         //!calculate photon flux
         template<typename StateType, typename VectorStateType>
         void update_photon_flux(const VectorStateType &molar_densities, const VectorStateType &sum_dens, 
                                 const StateType &z, VectorStateType & flux_at_z) const;
 
+        //!calculate photon flux, and opacity for diagnostics
+        template<typename StateType, typename VectorStateType>
+        void update_photon_flux(const VectorStateType &molar_densities, const VectorStateType &sum_dens, 
+                                const StateType &z, VectorStateType & flux_at_z, VectorStateType & tau_at_z) const;
+
+        /*! calculate photon flux averaged over the zenith angles of the opacity,
+         *  see PhotonOpacity::set_zenith_angles()
+         */
+        template<typename StateType, typename VectorStateType>
+        void update_averaged_photon_flux(const VectorStateType &molar_densities, const VectorStateType &sum_dens, 
+                                         const StateType &z, VectorStateType & flux_at_z) const;
+
+        /*! calculate photon flux, opacity and d ln(Chap) / d n_i
+         *
+         *  The local densities change the opacity through a = (R + z) / H_a:
+         *  d tau / d n_i = tau * d ln(Chap)/d a * d a / d n_i, with
+         *  d a / d n_i = - a / H_a * d H_a / d n_i
+         */
+        template<typename StateType, typename VectorStateType>
+        void update_photon_flux_and_derivs(const VectorStateType &molar_densities, const VectorStateType &sum_dens, 
+                                           const StateType &z, VectorStateType & flux_at_z, VectorStateType & tau_at_z,
+                                           VectorStateType & dlog_chapman_dn) const;
+
+        /*! calculate photon flux and its derivatives, dflux_dn[i][lambda]
+         *
+         *  d phy / d n_i = - phy * (tau * d ln(Chap) / d n_i + Chap * sigma_i * d sum_dens_i / d n_i)
+         *
+         *  \p dsum_dens_dn is the local dependence of the column densities on the densities,
+         *  zero if the column densities are frozen. tau and d ln(Chap) / d n are kept in
+         *  the evaluator between calls.
+         */
+        template<typename StateType, typename VectorStateType, typename MatrixStateType>
+        void dphoton_flux_dn(const VectorStateType &molar_densities, const VectorStateType &sum_dens, 
+                             const VectorStateType &dsum_dens_dn, const StateType &z,
+                             VectorStateType & flux_at_z, MatrixStateType & dflux_dn);
+
   };
 
   template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
@@ -99,26 +146,144 @@ namespace Planet
      antioch_assert(!_phy_at_top.flux().empty());
      antioch_assert_equal_to(_phy_at_top.flux().size(),flux_at_z.size());
 
-     VectorCoeffType tau;
-     _hv_tau.compute_tau(_mixture.a(molar_densities,z),sum_dens,tau);
+     antioch_assert_equal_to(_hv_tau.n_lambda(), _phy_at_top.abscissa().size());
+
+     // tau and exp(-tau) in one pass, no allocation
+     _hv_tau.compute_attenuated_flux(_mixture.a(molar_densities,z),sum_dens,_phy_at_top.flux(),flux_at_z);
+
+     return; 
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType>
+  inline
+  void PhotonEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::update_photon_flux(const VectorStateType &molar_densities, 
+                                                                      const VectorStateType &sum_dens, const StateType &z,
+                                                                      VectorStateType & flux_at_z, VectorStateType & tau_at_z) const
+  {
+     antioch_assert_equal_to(molar_densities.size(), _mixture.neutral_composition().n_species());
+     antioch_assert_equal_to(sum_dens.size(), _mixture.neutral_composition().n_species());
+     antioch_assert(!_phy_at_top.abscissa().empty());
+     antioch_assert(!_phy_at_top.flux().empty());
+     antioch_assert_equal_to(_phy_at_top.flux().size(),flux_at_z.size());
+     antioch_assert_equal_to(_hv_tau.n_lambda(), _phy_at_top.abscissa().size());
+
+     _hv_tau.compute_attenuated_flux(_mixture.a(molar_densities,z),sum_dens,_phy_at_top.flux(),flux_at_z,tau_at_z);
+
+     return; 
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType>
+  inline
+  void PhotonEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::update_averaged_photon_flux(const VectorStateType &molar_densities, 
+                                                                      const VectorStateType &sum_dens, const StateType &z,
+                                                                      VectorStateType & flux_at_z) const
+  {
+     antioch_assert_equal_to(molar_densities.size(), _mixture.neutral_composition().n_species());
+     antioch_assert_equal_to(sum_dens.size(), _mixture.neutral_composition().n_species());
+     antioch_assert(!_phy_at_top.flux().empty());
+     antioch_assert_equal_to(_phy_at_top.flux().size(),flux_at_z.size());
+     antioch_assert_equal_to(_hv_tau.n_lambda(), _phy_at_top.abscissa().size());
 
-     antioch_assert_equal_to(tau.size(), _phy_at_top.abscissa().size());
+     // one column opacity for all the angles
+     _hv_tau.compute_averaged_attenuated_flux(_mixture.a(molar_densities,z),sum_dens,_phy_at_top.flux(),flux_at_z);
 
-     for(unsigned int ilambda = 0; ilambda < _phy_at_top.abscissa().size(); ilambda++)
+     return; 
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType>
+  inline
+  void PhotonEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::update_photon_flux_and_derivs(const VectorStateType &molar_densities, 
+                                                                      const VectorStateType &sum_dens, const StateType &z,
+                                                                      VectorStateType & flux_at_z, VectorStateType & tau_at_z,
+                                                                      VectorStateType & dlog_chapman_dn) const
+  {
+     antioch_assert_equal_to(molar_densities.size(), _mixture.neutral_composition().n_species());
+     antioch_assert_equal_to(sum_dens.size(), _mixture.neutral_composition().n_species());
+     antioch_assert_equal_to(dlog_chapman_dn.size(), _mixture.neutral_composition().n_species());
+     antioch_assert(!_phy_at_top.flux().empty());
+     antioch_assert_equal_to(_phy_at_top.flux().size(),flux_at_z.size());
+     antioch_assert_equal_to(_hv_tau.n_lambda(), _phy_at_top.abscissa().size());
+
+     // H_a and d H_a / d n_i in dlog_chapman_dn
+     StateType Ha;
+     _mixture.datmospheric_scale_height_dn_i(molar_densities,z,Ha,dlog_chapman_dn);
+     const StateType a = (Constants::Titan::radius<StateType>() + z) / Ha;
+
+     _hv_tau.compute_attenuated_flux(a,sum_dens,_phy_at_top.flux(),flux_at_z,tau_at_z);
+
+     const StateType dlog_chap_dHa = - _hv_tau.dlog_chapman_da(a) * a / Ha;
+     for(unsigned int s = 0; s < dlog_chapman_dn.size(); s++)
      {
-       flux_at_z[ilambda] = _phy_at_top.flux()[ilambda] * Antioch::ant_exp(- tau[ilambda]);
+        dlog_chapman_dn[s] *= dlog_chap_dHa;
      }
 
-
      return; 
   }
 
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType, typename MatrixStateType>
+  inline
+  void PhotonEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::dphoton_flux_dn(const VectorStateType &molar_densities, 
+                                                                      const VectorStateType &sum_dens, const VectorStateType &dsum_dens_dn,
+                                                                      const StateType &z, VectorStateType & flux_at_z, 
+                                                                      MatrixStateType & dflux_dn)
+  {
+     antioch_assert_equal_to(dsum_dens_dn.size(), _mixture.neutral_composition().n_species());
+
+     flux_at_z.resize(_phy_at_top.flux().size());
+     _dlog_chapman_dn.resize(_mixture.neutral_composition().n_species(),0.L);
+     this->update_photon_flux_and_derivs(molar_densities,sum_dens,z,flux_at_z,_tau_at_z,_dlog_chapman_dn);
+
+     const StateType chap = this->chapman_factor(molar_densities,z);
+
+     dflux_dn.resize(_mixture.neutral_composition().n_species());
+     for(unsigned int s = 0; s < _mixture.neutral_composition().n_species(); s++)
+     {
+        dflux_dn[s].resize(flux_at_z.size());
+        for(unsigned int il = 0; il < flux_at_z.size(); il++)
+        {
+           dflux_dn[s][il] = - flux_at_z[il] * _tau_at_z[il] * _dlog_chapman_dn[s];
+        }
+     }
+
+     // column densities, packed row k is species absorbing_species_id()[k]
+     for(unsigned int k = 0; k < _hv_tau.absorbing_species_id().size(); k++)
+     {
+        const unsigned int s = _hv_tau.absorbing_species_id()[k];
+        const StateType chap_dcolumn = chap * dsum_dens_dn[s];
+        for(unsigned int il = 0; il < flux_at_z.size(); il++)
+        {
+           dflux_dn[s][il] -= flux_at_z[il] * (chap_dcolumn * _hv_tau.packed_cross_sections()[k * _hv_tau.lambda_stride() + il]);
+        }
+     }
+
+     return;
+  }
+
   template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
   inline
   const Antioch::ParticleFlux<VectorCoeffType> & PhotonEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::photon_flux_at_top() const
   {
      return _phy_at_top;
   }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  inline
+  const PhotonOpacity<CoeffType,VectorCoeffType> & PhotonEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::photon_opacity() const
+  {
+     return _hv_tau;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename MatrixCoeffType>
+  template<typename StateType, typename VectorStateType>
+  inline
+  StateType PhotonEvaluator<CoeffType,VectorCoeffType,MatrixCoeffType>::chapman_factor(const VectorStateType &molar_densities, const StateType &z) const
+  {
+     return _hv_tau.chapman_factor(_mixture.a(molar_densities,z));
+  }
   
 
 }
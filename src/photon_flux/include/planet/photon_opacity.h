@@ -32,9 +32,29 @@
 #include "antioch/antioch_asserts.h"
 #include "antioch/cmath_shims.h"
 
+//Eigen
+#include <Eigen/Dense>
+
 //C++
 #include <vector>
 #include <map>
+#include <cstddef>
+#include <utility>
+
+/*!
+ * compute_tau and compute_attenuated_flux use the packed
+ * cross-sections kernel, define PLANET_REFERENCE_OPACITY to
+ * use the loop over the CrossSection objects instead, the
+ * flux being then attenuated wavelength by wavelength
+ *
+ * Mixed precision: the attenuated flux kernels take the column
+ * densities, the flux at the top and the computed flux in their
+ * own precision. A PhotonOpacity<float> (see copy_cross_sections())
+ * with double column densities and a float flux stores and
+ * attenuates in float, the column densities being rounded once
+ * per species. It is built by the caller, as the float
+ * PhotolysisEvaluator, PlanetPhysicsHelper stays in its precision.
+ */
 
 namespace Planet
 {
@@ -54,6 +74,32 @@ namespace Planet
           std::vector<unsigned int>               _absorbing_species;
           std::vector<unsigned int>                   _absorbing_species_id;
 
+//packed cross-sections, species x lambda, lambda fastest
+          std::vector<CoeffType,Eigen::aligned_allocator<CoeffType> > _packed_cs;
+          unsigned int                                                 _n_lambda;
+          unsigned int                                                 _lambda_stride;
+
+//zenith angles quadrature, one Chapman function per angle
+          std::vector<Chapman<CoeffType> > _zenith_chapman;
+          VectorCoeffType                  _zenith_weights;
+
+          //! lambda block size of the packed kernel
+          static const unsigned int _block_size = 256;
+
+          //! pads the rows to keep them aligned
+          static const unsigned int _pad_size = 16;
+
+          //! fills the packed store from the cross-sections on custom grid
+          void pack_cross_sections();
+
+          //! fused tau and attenuation by lambda blocks, tau is not stored if null
+          template<typename StateType, typename VectorDensType, typename VectorFluxType, typename VectorStateType>
+          void attenuated_flux_kernel(const StateType &a, const VectorDensType &sum_dens, const VectorFluxType &flux_top,
+                                      VectorStateType &flux, VectorStateType *tau) const;
+
+          template <typename OtherCoeffType, typename OtherVectorCoeffType>
+          friend class PhotonOpacity;
+
         public:
           PhotonOpacity(Chapman<CoeffType> &chapman);
           ~PhotonOpacity();
@@ -62,30 +108,104 @@ namespace Planet
           template<typename StateType, typename VectorStateType>
           void compute_tau(const StateType &a, const VectorStateType &sum_dens, VectorStateType &tau) const;
 
+          //! tau on the packed cross-sections, by lambda blocks
+          template<typename StateType, typename VectorStateType>
+          void compute_tau_packed(const StateType &a, const VectorStateType &sum_dens, VectorStateType &tau) const;
+
+          //! tau looping over the cross-sections objects
+          template<typename StateType, typename VectorDensType, typename VectorStateType>
+          void compute_tau_reference(const StateType &a, const VectorDensType &sum_dens, VectorStateType &tau) const;
+
+          //! flux = flux_top * exp(-tau) in one pass, flux is used as scratch for tau
+          template<typename StateType, typename VectorDensType, typename VectorFluxType, typename VectorStateType>
+          void compute_attenuated_flux(const StateType &a, const VectorDensType &sum_dens, const VectorFluxType &flux_top,
+                                       VectorStateType &flux) const;
+
+          //! flux = flux_top * exp(-tau) in one pass, tau is also given
+          template<typename StateType, typename VectorDensType, typename VectorFluxType, typename VectorStateType>
+          void compute_attenuated_flux(const StateType &a, const VectorDensType &sum_dens, const VectorFluxType &flux_top,
+                                       VectorStateType &flux, VectorStateType &tau) const;
+
+          /*! sets the zenith angles (degrees) and their quadrature weights
+           *  of the averaged flux, e.g. a diurnal average
+           */
+          void set_zenith_angles(const VectorCoeffType &chi, const VectorCoeffType &weights);
+
+          //!\return number of zenith angles of the averaged flux
+          unsigned int n_zenith_angles() const;
+
+          /*! flux = sum_k w_k flux_top * exp(-tau_k) over the zenith angles,
+           *  tau_k = Chap_k(a) * 1e5 * sum_species sigma(lambda) int_z^top n_s(z')dz'.
+           *  The column opacity does not depend on the angle, it is computed
+           *  once by lambda block and only the exponential is done per angle.
+           */
+          template<typename StateType, typename VectorDensType, typename VectorFluxType, typename VectorStateType>
+          void compute_averaged_attenuated_flux(const StateType &a, const VectorDensType &sum_dens, const VectorFluxType &flux_top,
+                                                VectorStateType &flux) const;
+
+          //! Chap(a) * 1e5, tau = chapman_factor * sum_species sigma(lambda) int_z^top n_s(z')dz'
+          template<typename StateType>
+          StateType chapman_factor(const StateType &a) const;
+
+          //! Chap_k(a) * 1e5 for the zenith angle k of the averaged flux
+          template<typename StateType>
+          StateType zenith_chapman_factor(unsigned int k, const StateType &a) const;
+
+          //! d ln(Chap) / d a, tau varies with a only through the Chapman function
+          template<typename StateType>
+          StateType dlog_chapman_da(const StateType &a) const;
+
+          //!\return number of wavelengths of the custom grid
+          unsigned int n_lambda() const;
+
+          //!\return packed cross-sections, species row s starts at s * lambda_stride()
+          const std::vector<CoeffType,Eigen::aligned_allocator<CoeffType> > &packed_cross_sections() const;
+
+          //!\return row length of the packed cross-sections
+          unsigned int lambda_stride() const;
+
           //!\return absorbing species
-          const std::vector<unsigned int> absorbing_species() const;
+          const std::vector<unsigned int> &absorbing_species() const;
+
+          //!\return absorbing species index in the densities, packed row s is absorbing_species_id()[s]
+          const std::vector<unsigned int> &absorbing_species_id() const;
 
           //!\return absorbing species cross-section
           const std::vector<CrossSection<VectorCoeffType> > &absorbing_species_cs() const;
 
           //!\return absorbing species cross-section map
-          const std::map<unsigned int, unsigned int> cross_sections_map() const;
+          const std::map<unsigned int, unsigned int> &cross_sections_map() const;
 
-          //!adds a photon cross-section
+          //!adds a photon cross-section, built in place
           template<typename VectorStateType>
           void add_cross_section(const VectorStateType &lambda, const VectorStateType &cs, const unsigned int &sp, unsigned int id);
 
+          //!adds a photon cross-section, lambda and cs are moved in
+          void add_cross_section(VectorCoeffType &&lambda, VectorCoeffType &&cs, const unsigned int &sp, unsigned int id);
+
           //!update cross-section
           template<typename VectorStateType>
           void update_cross_section(const VectorStateType &custom_grid);
 
+          //!merges the bins of the custom grid, see CrossSection::coarsen_cross_section()
+          template<typename VectorStateType>
+          void coarsen_cross_section(const std::vector<unsigned int> &bin_starts, const VectorStateType &custom_grid);
+
+          /*! replaces the cross-sections by the ones of \p rhs, already on the custom
+           *  grid, rounded to CoeffType, e.g. a float opacity from the double one
+           */
+          template<typename OtherCoeffType, typename OtherVectorCoeffType>
+          void copy_cross_sections(const PhotonOpacity<OtherCoeffType,OtherVectorCoeffType> &rhs);
+
 
   };
 
   template<typename CoeffType, typename VectorCoeffType>
   inline
   PhotonOpacity<CoeffType,VectorCoeffType>::PhotonOpacity(Chapman<CoeffType> &chapman):
-  _chapman(chapman)
+  _chapman(chapman),
+  _n_lambda(0),
+  _lambda_stride(0)
   {
      return;
   }
@@ -105,17 +225,35 @@ namespace Planet
   {
      _absorbing_species.push_back(sp);
      _absorbing_species_id.push_back(id);
-     _absorbing_species_cs.push_back(CrossSection<VectorCoeffType>(lambda,cs));
+     _absorbing_species_cs.emplace_back(lambda,cs);
+     _cross_sections_map[sp] = _absorbing_species.size() - 1;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  inline
+  void PhotonOpacity<CoeffType,VectorCoeffType>::add_cross_section(VectorCoeffType &&lambda, VectorCoeffType &&cs, 
+                                                                   const unsigned int &sp, unsigned int id)
+  {
+     _absorbing_species.push_back(sp);
+     _absorbing_species_id.push_back(id);
+     _absorbing_species_cs.emplace_back(std::move(lambda),std::move(cs));
      _cross_sections_map[sp] = _absorbing_species.size() - 1;
   }
 
   template<typename CoeffType, typename VectorCoeffType>
   inline
-  const std::vector<unsigned int> PhotonOpacity<CoeffType,VectorCoeffType>::absorbing_species() const
+  const std::vector<unsigned int> &PhotonOpacity<CoeffType,VectorCoeffType>::absorbing_species() const
   {
      return _absorbing_species;
   }
 
+  template<typename CoeffType, typename VectorCoeffType>
+  inline
+  const std::vector<unsigned int> &PhotonOpacity<CoeffType,VectorCoeffType>::absorbing_species_id() const
+  {
+     return _absorbing_species_id;
+  }
+
   template<typename CoeffType, typename VectorCoeffType>
   inline
   const std::vector<CrossSection<VectorCoeffType> > &PhotonOpacity<CoeffType,VectorCoeffType>::absorbing_species_cs() const
@@ -126,7 +264,7 @@ namespace Planet
 
   template<typename CoeffType, typename VectorCoeffType>
   inline
-  const std::map<unsigned int, unsigned int> PhotonOpacity<CoeffType,VectorCoeffType>::cross_sections_map() const
+  const std::map<unsigned int, unsigned int> &PhotonOpacity<CoeffType,VectorCoeffType>::cross_sections_map() const
   {
      return _cross_sections_map;
   }
@@ -141,20 +279,324 @@ namespace Planet
         _absorbing_species_cs[i].update_cross_section(custom_grid);
      }
 
+     this->pack_cross_sections();
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  template<typename VectorStateType>
+  inline
+  void PhotonOpacity<CoeffType,VectorCoeffType>::coarsen_cross_section(const std::vector<unsigned int> &bin_starts, const VectorStateType &custom_grid)
+  {
+     for(unsigned int i = 0; i < _absorbing_species.size(); i++)
+     {
+        _absorbing_species_cs[i].coarsen_cross_section(bin_starts,custom_grid);
+     }
+
+     this->pack_cross_sections();
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  template<typename OtherCoeffType, typename OtherVectorCoeffType>
+  inline
+  void PhotonOpacity<CoeffType,VectorCoeffType>::copy_cross_sections(const PhotonOpacity<OtherCoeffType,OtherVectorCoeffType> &rhs)
+  {
+     _absorbing_species    = rhs._absorbing_species;
+     _absorbing_species_id = rhs._absorbing_species_id;
+     _cross_sections_map   = rhs._cross_sections_map;
+
+     _absorbing_species_cs.clear();
+     _absorbing_species_cs.reserve(rhs._absorbing_species_cs.size());
+     for(unsigned int s = 0; s < rhs._absorbing_species_cs.size(); s++)
+     {
+        _absorbing_species_cs.emplace_back(rhs._absorbing_species_cs[s]);
+     }
+
+     this->pack_cross_sections();
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  inline
+  void PhotonOpacity<CoeffType,VectorCoeffType>::pack_cross_sections()
+  {
+     _n_lambda = (_absorbing_species_cs.empty())?0:_absorbing_species_cs[0].cross_section_on_custom_grid().size();
+     _lambda_stride = ((_n_lambda + _pad_size - 1) / _pad_size) * _pad_size;
+
+     _packed_cs.assign(_absorbing_species_cs.size() * _lambda_stride, 0.L);
+     for(unsigned int s = 0; s < _absorbing_species_cs.size(); s++)
+     {
+        antioch_assert_equal_to(_absorbing_species_cs[s].cross_section_on_custom_grid().size(),_n_lambda);
+        for(unsigned int il = 0; il < _n_lambda; il++)
+        {
+           _packed_cs[s * _lambda_stride + il] = _absorbing_species_cs[s].cross_section_on_custom_grid()[il];
+        }
+     }
+
+     return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  template<typename StateType>
+  inline
+  StateType PhotonOpacity<CoeffType,VectorCoeffType>::chapman_factor(const StateType &a) const
+  {
+     return _chapman(a) * Antioch::constant_clone(a,1e5); //cm-1.km  -> no unit
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  template<typename StateType>
+  inline
+  StateType PhotonOpacity<CoeffType,VectorCoeffType>::zenith_chapman_factor(unsigned int k, const StateType &a) const
+  {
+     antioch_assert_less(k,_zenith_chapman.size());
+     return _zenith_chapman[k](a) * Antioch::constant_clone(a,1e5); //cm-1.km  -> no unit
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  inline
+  void PhotonOpacity<CoeffType,VectorCoeffType>::set_zenith_angles(const VectorCoeffType &chi, const VectorCoeffType &weights)
+  {
+     antioch_assert_equal_to(chi.size(),weights.size());
+
+     _zenith_chapman.clear();
+     for(unsigned int k = 0; k < chi.size(); k++)
+     {
+        _zenith_chapman.push_back(Chapman<CoeffType>(chi[k]));
+     }
+     _zenith_weights = weights;
+
      return;
   }
 
+  template<typename CoeffType, typename VectorCoeffType>
+  inline
+  unsigned int PhotonOpacity<CoeffType,VectorCoeffType>::n_zenith_angles() const
+  {
+     return _zenith_chapman.size();
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  template<typename StateType>
+  inline
+  StateType PhotonOpacity<CoeffType,VectorCoeffType>::dlog_chapman_da(const StateType &a) const
+  {
+     return _chapman.dchapman_dx(a) / _chapman(a);
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  inline
+  unsigned int PhotonOpacity<CoeffType,VectorCoeffType>::n_lambda() const
+  {
+     return _n_lambda;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  inline
+  const std::vector<CoeffType,Eigen::aligned_allocator<CoeffType> > &PhotonOpacity<CoeffType,VectorCoeffType>::packed_cross_sections() const
+  {
+     return _packed_cs;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  inline
+  unsigned int PhotonOpacity<CoeffType,VectorCoeffType>::lambda_stride() const
+  {
+     return _lambda_stride;
+  }
+
   template<typename CoeffType, typename VectorCoeffType>
   template<typename StateType, typename VectorStateType>
   inline
   void PhotonOpacity<CoeffType,VectorCoeffType>::compute_tau(const StateType &a, const VectorStateType &sum_dens, VectorStateType &tau) const
+  {
+#ifdef PLANET_REFERENCE_OPACITY
+      this->compute_tau_reference(a,sum_dens,tau);
+#else
+      this->compute_tau_packed(a,sum_dens,tau);
+#endif
+      return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  template<typename StateType, typename VectorStateType>
+  inline
+  void PhotonOpacity<CoeffType,VectorCoeffType>::compute_tau_packed(const StateType &a, const VectorStateType &sum_dens, VectorStateType &tau) const
+  {
+      antioch_assert(!_absorbing_species_cs.empty());
+      antioch_assert_equal_to(_packed_cs.size(),_absorbing_species_cs.size() * _lambda_stride);
+
+      typedef typename Antioch::value_type<VectorStateType>::type Scalar;
+      typedef Eigen::Array<Scalar,Eigen::Dynamic,1>    ArrayState;
+      typedef Eigen::Array<CoeffType,Eigen::Dynamic,1> ArrayCoeff;
+
+      tau.resize(_n_lambda);
+
+      // Chapman factor does not depend on lambda
+      const StateType chap = this->chapman_factor(a);
+
+      for(unsigned int il = 0; il < _n_lambda; il += _block_size) //lambda blocks
+      {
+         const unsigned int nl = (il + _block_size < _n_lambda)?_block_size:_n_lambda - il;
+         Eigen::Map<ArrayState> tau_block(&tau[il],nl);
+
+         // species rows and lambda blocks start on aligned addresses
+         tau_block = sum_dens[_absorbing_species_id[0]] * 
+                     Eigen::Map<const ArrayCoeff,Eigen::Aligned>(&_packed_cs[il],nl).template cast<Scalar>();
+         for(unsigned int s = 1; s < _absorbing_species_cs.size(); s++) // neutrals
+         {
+             tau_block += sum_dens[_absorbing_species_id[s]] * //cm2 * cm-3.km
+                          Eigen::Map<const ArrayCoeff,Eigen::Aligned>(&_packed_cs[s * _lambda_stride + il],nl).template cast<Scalar>();
+         }
+         tau_block *= chap;
+      }
+
+      return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  template<typename StateType, typename VectorDensType, typename VectorFluxType, typename VectorStateType>
+  inline
+  void PhotonOpacity<CoeffType,VectorCoeffType>::compute_attenuated_flux(const StateType &a, const VectorDensType &sum_dens, 
+                                                                         const VectorFluxType &flux_top, VectorStateType &flux) const
+  {
+      this->attenuated_flux_kernel(a,sum_dens,flux_top,flux,static_cast<VectorStateType*>(NULL));
+      return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  template<typename StateType, typename VectorDensType, typename VectorFluxType, typename VectorStateType>
+  inline
+  void PhotonOpacity<CoeffType,VectorCoeffType>::compute_attenuated_flux(const StateType &a, const VectorDensType &sum_dens, 
+                                                                         const VectorFluxType &flux_top, VectorStateType &flux,
+                                                                         VectorStateType &tau) const
+  {
+      tau.resize(_n_lambda);
+      this->attenuated_flux_kernel(a,sum_dens,flux_top,flux,&tau);
+      return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  template<typename StateType, typename VectorDensType, typename VectorFluxType, typename VectorStateType>
+  inline
+  void PhotonOpacity<CoeffType,VectorCoeffType>::compute_averaged_attenuated_flux(const StateType &a, const VectorDensType &sum_dens, 
+                                                                                  const VectorFluxType &flux_top, VectorStateType &flux) const
+  {
+      antioch_assert(!_absorbing_species_cs.empty());
+      antioch_assert(!_zenith_chapman.empty());
+      antioch_assert_equal_to(_packed_cs.size(),_absorbing_species_cs.size() * _lambda_stride);
+      antioch_assert_equal_to(flux_top.size(),_n_lambda);
+
+      typedef typename Antioch::value_type<VectorStateType>::type Scalar;
+      typedef typename Antioch::value_type<VectorFluxType>::type  FluxScalar;
+      typedef Eigen::Array<Scalar,Eigen::Dynamic,1>     ArrayState;
+      typedef Eigen::Array<CoeffType,Eigen::Dynamic,1>  ArrayCoeff;
+      typedef Eigen::Array<FluxScalar,Eigen::Dynamic,1> ArrayFlux;
+      // fixed maximum size, the column opacity lives on the stack
+      typedef Eigen::Array<Scalar,Eigen::Dynamic,1,Eigen::ColMajor,_block_size,1> ArrayBlock;
+
+      flux.resize(_n_lambda);
+
+      ArrayBlock column_block;
+      for(unsigned int il = 0; il < _n_lambda; il += _block_size) //lambda blocks
+      {
+         const unsigned int nl = (il + _block_size < _n_lambda)?_block_size:_n_lambda - il;
+
+         // column opacity of the block, common to all the angles
+         column_block = Scalar(sum_dens[_absorbing_species_id[0]]) * 
+                        Eigen::Map<const ArrayCoeff,Eigen::Aligned>(&_packed_cs[il],nl).template cast<Scalar>();
+         for(unsigned int s = 1; s < _absorbing_species_cs.size(); s++) // neutrals
+         {
+             column_block += Scalar(sum_dens[_absorbing_species_id[s]]) * //cm2 * cm-3.km
+                             Eigen::Map<const ArrayCoeff,Eigen::Aligned>(&_packed_cs[s * _lambda_stride + il],nl).template cast<Scalar>();
+         }
+
+         Eigen::Map<ArrayState> flux_block(&flux[il],nl);
+         flux_block.setZero();
+         for(unsigned int k = 0; k < _zenith_chapman.size(); k++)
+         {
+            const Scalar chap = Scalar(this->zenith_chapman_factor(k,a));
+            flux_block += Scalar(_zenith_weights[k]) * (-chap * column_block).exp();
+         }
+         flux_block *= Eigen::Map<const ArrayFlux>(&flux_top[il],nl).template cast<Scalar>();
+      }
+
+      return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  template<typename StateType, typename VectorDensType, typename VectorFluxType, typename VectorStateType>
+  inline
+  void PhotonOpacity<CoeffType,VectorCoeffType>::attenuated_flux_kernel(const StateType &a, const VectorDensType &sum_dens, 
+                                                                        const VectorFluxType &flux_top, VectorStateType &flux,
+                                                                        VectorStateType *tau) const
+  {
+      antioch_assert(!_absorbing_species_cs.empty());
+      antioch_assert_equal_to(_packed_cs.size(),_absorbing_species_cs.size() * _lambda_stride);
+      antioch_assert_equal_to(flux_top.size(),_n_lambda);
+
+      typedef typename Antioch::value_type<VectorStateType>::type Scalar;
+      typedef typename Antioch::value_type<VectorFluxType>::type  FluxScalar;
+      typedef Eigen::Array<Scalar,Eigen::Dynamic,1>     ArrayState;
+      typedef Eigen::Array<CoeffType,Eigen::Dynamic,1>  ArrayCoeff;
+      typedef Eigen::Array<FluxScalar,Eigen::Dynamic,1> ArrayFlux;
+
+      flux.resize(_n_lambda);
+
+#ifdef PLANET_REFERENCE_OPACITY
+      // tau by the loop over the cross-sections, in flux if not wanted
+      VectorStateType & tau_lambda = (tau)?*tau:flux;
+      this->compute_tau_reference(a,sum_dens,tau_lambda);
+      for(unsigned int il = 0; il < _n_lambda; il++)
+      {
+         flux[il] = Scalar(flux_top[il]) * Antioch::ant_exp(-tau_lambda[il]);
+      }
+#else
+      const Scalar chap = Scalar(this->chapman_factor(a));
+
+      for(unsigned int il = 0; il < _n_lambda; il += _block_size) //lambda blocks
+      {
+         const unsigned int nl = (il + _block_size < _n_lambda)?_block_size:_n_lambda - il;
+
+         // tau of the block, the block stays in cache for the exponential
+         Eigen::Map<ArrayState> flux_block(&flux[il],nl);
+         flux_block = Scalar(sum_dens[_absorbing_species_id[0]]) * 
+                      Eigen::Map<const ArrayCoeff,Eigen::Aligned>(&_packed_cs[il],nl).template cast<Scalar>();
+         for(unsigned int s = 1; s < _absorbing_species_cs.size(); s++) // neutrals
+         {
+             flux_block += Scalar(sum_dens[_absorbing_species_id[s]]) * //cm2 * cm-3.km
+                           Eigen::Map<const ArrayCoeff,Eigen::Aligned>(&_packed_cs[s * _lambda_stride + il],nl).template cast<Scalar>();
+         }
+         flux_block *= chap;
+
+         if(tau)
+         {
+           Eigen::Map<ArrayState>(&(*tau)[il],nl) = flux_block;
+         }
+
+         flux_block = Eigen::Map<const ArrayFlux>(&flux_top[il],nl).template cast<Scalar>() * (-flux_block).exp();
+      }
+#endif
+
+      return;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType>
+  template<typename StateType, typename VectorDensType, typename VectorStateType>
+  inline
+  void PhotonOpacity<CoeffType,VectorCoeffType>::compute_tau_reference(const StateType &a, const VectorDensType &sum_dens, VectorStateType &tau) const
   {
       antioch_assert(!_absorbing_species_cs.empty());
 
-      tau.resize(_absorbing_species_cs[0].cross_section_on_custom_grid().size(),0.L);
+      tau.resize(_absorbing_species_cs[0].cross_section_on_custom_grid().size());
 
       for(unsigned int il = 0; il < _absorbing_species_cs[0].cross_section_on_custom_grid().size(); il++) //lambda
       {
+          tau[il] = 0.L;
           for(unsigned int s = 0; s < _absorbing_species_cs.size(); s++) // neutrals
           {
              tau[il] += _absorbing_species_cs[s].cross_section_on_custom_grid()[il] * sum_dens[_absorbing_species_id[s]]; //cm2 * cm-3.km
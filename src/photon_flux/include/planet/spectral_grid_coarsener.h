@@ -0,0 +1,449 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// Planet - An atmospheric code for planetary bodies, adapted to Titan
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+
+#ifndef PLANET_SPECTRAL_GRID_COARSENER_H
+#define PLANET_SPECTRAL_GRID_COARSENER_H
+
+//Antioch
+#include "antioch/antioch_asserts.h"
+#include "antioch/cmath_shims.h"
+#include "antioch/particle_flux.h"
+
+//Planet
+#include "planet/photon_opacity.h"
+#include "planet/photolysis_evaluator.h"
+
+//C++
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+namespace Planet
+{
+  /*!
+   * Merges the wavelength bins of the photon flux grid where the flux, the
+   * absorbers and the photolysis cross-sections can be averaged without
+   * changing the photolysis rates and the opacity at a reference profile
+   * beyond the tolerances.
+   *
+   * The coarse bin k gathers the fine bins [bin_starts[k],bin_starts[k+1]), its flux and
+   * cross-sections are the bin averages (left point rule, as the fine grid). Bins are merged
+   * from the short wavelengths while, at all the reference points:
+   *   - the photolysis rate contribution of the bin differs from the fine one by
+   *     less than \f$\epsilon_J J_r \Delta\lambda_k / (\lambda_\text{max} - \lambda_\text{min})\f$,
+   *     so the whole rate is within \f$\epsilon_J\f$,
+   *   - the optical depth of the bin differs from the effective optical depth of the fine bins,
+   *     \f$-\ln(\sum_l \phi_l \exp(-\tau_l) \Delta\lambda_l / \sum_l \phi_l \Delta\lambda_l)\f$,
+   *     by less than \f$\epsilon_\tau \max(1,\tau)\f$.
+   *
+   * The errors achieved on the whole grid are given by j_error() and tau_error().
+   */
+  template <typename CoeffType, typename VectorCoeffType>
+  class SpectralGridCoarsener
+  {
+        private:
+          SpectralGridCoarsener(){antioch_error();return;}
+
+          CoeffType _j_tolerance;
+          CoeffType _tau_tolerance;
+
+//reference profile, column densities and Chapman factor
+          std::vector<VectorCoeffType> _ref_sum_dens;
+          VectorCoeffType              _ref_chapman;
+
+//grids
+          VectorCoeffType           _fine_grid;
+          VectorCoeffType           _coarse_grid;
+          std::vector<unsigned int> _bin_starts;
+
+          CoeffType _j_error;
+          CoeffType _tau_error;
+
+          //! running sums of a coarse bin
+          struct BinSums
+          {
+             CoeffType              width;
+             CoeffType              flux;      // sum phi dlambda
+             VectorCoeffType        sigma;     // sum sigma_s dlambda
+             VectorCoeffType        weight;    // sum W_r
+             VectorCoeffType        fine_rate; // sum W_r phi exp(-tau), reference x channels
+             VectorCoeffType        fine_flux; // sum phi exp(-tau) dlambda, reference
+          };
+
+          //! errors of the bin, on the relative rates and on tau
+          void bin_errors(const BinSums &sums, const std::vector<unsigned int> &species_id, 
+                          const VectorCoeffType &fine_rates, CoeffType &j_error, CoeffType &tau_error) const;
+
+        public:
+          SpectralGridCoarsener(const CoeffType &j_tolerance, const CoeffType &tau_tolerance);
+          ~SpectralGridCoarsener();
+
+          //! adds a point of the reference profile, column densities of all the neutrals and Chap * 1e5
+          void add_reference_point(const VectorCoeffType &sum_dens, const CoeffType &chapman_factor);
+
+          //!\return number of reference points
+          unsigned int n_reference_points() const;
+
+          /*! builds the coarse grid from the fine grid the opacity and the photolysis
+           *  cross-sections are on, \p photolysis can be NULL
+           */
+          void build(const VectorCoeffType &fine_grid, const VectorCoeffType &flux_top,
+                     const PhotonOpacity<CoeffType,VectorCoeffType> &opacity,
+                     const PhotolysisEvaluator<CoeffType,VectorCoeffType> *photolysis = NULL);
+
+          //! flux on the coarse grid, bin averages
+          template<typename VectorStateType>
+          void coarsen_flux(const VectorStateType &fine_flux, VectorStateType &coarse_flux) const;
+
+          //! flux and abscissa on the coarse grid
+          void coarsen_flux(Antioch::ParticleFlux<VectorCoeffType> &flux) const;
+
+          //! brings the opacity and the photolysis cross-sections, still on the fine grid, on the coarse grid
+          void apply(PhotonOpacity<CoeffType,VectorCoeffType> &opacity,
+                     PhotolysisEvaluator<CoeffType,VectorCoeffType> *photolysis = NULL) const;
+
+          //!\return coarse grid
+          const VectorCoeffType &coarse_grid() const;
+
+          //!\return fine node of each coarse node
+          const std::vector<unsigned int> &bin_starts() const;
+
+          //!\return maximum relative error on the photolysis rates at the reference profile
+          CoeffType j_error() const;
+
+          //!\return maximum error on tau at the reference profile, relative above 1
+          CoeffType tau_error() const;
+  };
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  SpectralGridCoarsener<CoeffType,VectorCoeffType>::SpectralGridCoarsener(const CoeffType &j_tolerance, const CoeffType &tau_tolerance):
+     _j_tolerance(j_tolerance),
+     _tau_tolerance(tau_tolerance),
+     _j_error(0.L),
+     _tau_error(0.L)
+  {
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  SpectralGridCoarsener<CoeffType,VectorCoeffType>::~SpectralGridCoarsener()
+  {
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  void SpectralGridCoarsener<CoeffType,VectorCoeffType>::add_reference_point(const VectorCoeffType &sum_dens, const CoeffType &chapman_factor)
+  {
+     _ref_sum_dens.push_back(sum_dens);
+     _ref_chapman.push_back(chapman_factor);
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  unsigned int SpectralGridCoarsener<CoeffType,VectorCoeffType>::n_reference_points() const
+  {
+     return _ref_chapman.size();
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  void SpectralGridCoarsener<CoeffType,VectorCoeffType>::bin_errors(const BinSums &sums, const std::vector<unsigned int> &species_id,
+                                                                    const VectorCoeffType &fine_rates, CoeffType &j_error, CoeffType &tau_error) const
+  {
+     const unsigned int n_ref = _ref_chapman.size();
+     const unsigned int n_rates = sums.weight.size();
+     const CoeffType range = _fine_grid.back() - _fine_grid.front();
+
+     j_error   = 0.L;
+     tau_error = 0.L;
+     for(unsigned int p = 0; p < n_ref; p++)
+     {
+        CoeffType tau(0.L);
+        for(unsigned int s = 0; s < species_id.size(); s++)
+        {
+           tau += sums.sigma[s] * _ref_sum_dens[p][species_id[s]];
+        }
+        tau *= _ref_chapman[p] / sums.width;
+        const CoeffType transmission = Antioch::ant_exp(-tau);
+
+        // effective tau of the fine bins
+        if(sums.flux > CoeffType(0.L))
+        {
+           const CoeffType coarse_flux = sums.flux * transmission;
+           if(sums.fine_flux[p] > CoeffType(0.L) && coarse_flux > CoeffType(0.L))
+           {
+              const CoeffType tau_eff = - Antioch::ant_log(sums.fine_flux[p] / sums.flux);
+              tau_error = std::max(tau_error, Antioch::ant_abs(tau - tau_eff) / std::max(CoeffType(1.L),tau_eff));
+           }else if(sums.fine_flux[p] > CoeffType(0.L) || coarse_flux > CoeffType(0.L))
+           {
+              tau_error = std::numeric_limits<CoeffType>::max();
+           }
+        }
+
+        // rates contributions, against the budget of the bin
+        for(unsigned int r = 0; r < n_rates; r++)
+        {
+           const CoeffType J = fine_rates[p * n_rates + r];
+           if(!(J > CoeffType(0.L)))continue;
+           const CoeffType coarse_rate = sums.weight[r] * sums.flux / sums.width * transmission;
+           j_error = std::max(j_error, Antioch::ant_abs(coarse_rate - sums.fine_rate[p * n_rates + r]) / J * range / sums.width);
+        }
+     }
+
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  void SpectralGridCoarsener<CoeffType,VectorCoeffType>::build(const VectorCoeffType &fine_grid, const VectorCoeffType &flux_top,
+                                                               const PhotonOpacity<CoeffType,VectorCoeffType> &opacity,
+                                                               const PhotolysisEvaluator<CoeffType,VectorCoeffType> *photolysis)
+  {
+     antioch_assert_greater(fine_grid.size(),1);
+     antioch_assert_equal_to(fine_grid.size(),flux_top.size());
+     antioch_assert_equal_to(fine_grid.size(),opacity.n_lambda());
+     antioch_assert(!_ref_chapman.empty());
+
+     _fine_grid = fine_grid;
+
+     const unsigned int n_lambda  = fine_grid.size();
+     const unsigned int n_ref     = _ref_chapman.size();
+     const unsigned int n_species = opacity.absorbing_species_id().size();
+     const unsigned int n_rates   = (photolysis)?photolysis->n_photolysis():0;
+     const std::vector<unsigned int> &species_id = opacity.absorbing_species_id();
+     if(photolysis)antioch_assert_equal_to((unsigned int)photolysis->weights().cols(),n_lambda);
+
+     // fine optical depths, reference x lambda, and rates, reference x channels
+     VectorCoeffType fine_tau(n_ref * n_lambda,0.L);
+     VectorCoeffType fine_rates(n_ref * n_rates,0.L);
+     for(unsigned int p = 0; p < n_ref; p++)
+     {
+        for(unsigned int s = 0; s < n_species; s++)
+        {
+           const CoeffType column = _ref_sum_dens[p][species_id[s]] * _ref_chapman[p];
+           for(unsigned int l = 0; l < n_lambda; l++)
+           {
+              fine_tau[p * n_lambda + l] += column * opacity.packed_cross_sections()[s * opacity.lambda_stride() + l];
+           }
+        }
+        for(unsigned int r = 0; r < n_rates; r++)
+        {
+           for(unsigned int l = 0; l + 1 < n_lambda; l++)
+           {
+              fine_rates[p * n_rates + r] += photolysis->weights()(r,l) * flux_top[l] * Antioch::ant_exp(-fine_tau[p * n_lambda + l]);
+           }
+        }
+     }
+
+     BinSums empty;
+     empty.width = 0.L;
+     empty.flux  = 0.L;
+     empty.sigma.resize(n_species,0.L);
+     empty.weight.resize(n_rates,0.L);
+     empty.fine_rate.resize(n_ref * n_rates,0.L);
+     empty.fine_flux.resize(n_ref,0.L);
+
+     // greedy merging, a bin of one fine bin is exact
+     _bin_starts.clear();
+     _bin_starts.push_back(0);
+     BinSums trial(empty);
+     for(unsigned int l = 0; l + 1 < n_lambda; l++)
+     {
+        const CoeffType dl = fine_grid[l + 1] - fine_grid[l];
+        trial.width += dl;
+        trial.flux  += flux_top[l] * dl;
+        for(unsigned int s = 0; s < n_species; s++)
+        {
+           trial.sigma[s] += opacity.packed_cross_sections()[s * opacity.lambda_stride() + l] * dl;
+        }
+        for(unsigned int p = 0; p < n_ref; p++)
+        {
+           const CoeffType transmitted = flux_top[l] * Antioch::ant_exp(-fine_tau[p * n_lambda + l]);
+           trial.fine_flux[p] += transmitted * dl;
+           for(unsigned int r = 0; r < n_rates; r++)
+           {
+              trial.fine_rate[p * n_rates + r] += photolysis->weights()(r,l) * transmitted;
+           }
+        }
+        for(unsigned int r = 0; r < n_rates; r++)
+        {
+           trial.weight[r] += photolysis->weights()(r,l);
+        }
+
+        CoeffType j_err, tau_err;
+        this->bin_errors(trial,species_id,fine_rates,j_err,tau_err);
+        if(l > _bin_starts.back() && (j_err > _j_tolerance || tau_err > _tau_tolerance))
+        {
+           // bin closed before l, l starts the next one
+           _bin_starts.push_back(l);
+           l--;
+           trial = empty;
+           continue;
+        }
+     }
+     _bin_starts.push_back(n_lambda - 1);
+
+     _coarse_grid.resize(_bin_starts.size());
+     for(unsigned int k = 0; k < _bin_starts.size(); k++)
+     {
+        _coarse_grid[k] = fine_grid[_bin_starts[k]];
+     }
+
+     // achieved errors on the whole grid
+     _j_error   = 0.L;
+     _tau_error = 0.L;
+     VectorCoeffType coarse_rates(n_ref * n_rates,0.L);
+     for(unsigned int k = 0; k + 1 < _bin_starts.size(); k++)
+     {
+        BinSums bin(empty);
+        for(unsigned int l = _bin_starts[k]; l < _bin_starts[k + 1]; l++)
+        {
+           const CoeffType dl = fine_grid[l + 1] - fine_grid[l];
+           bin.width += dl;
+           bin.flux  += flux_top[l] * dl;
+           for(unsigned int s = 0; s < n_species; s++)
+           {
+              bin.sigma[s] += opacity.packed_cross_sections()[s * opacity.lambda_stride() + l] * dl;
+           }
+           for(unsigned int p = 0; p < n_ref; p++)
+           {
+              bin.fine_flux[p] += flux_top[l] * Antioch::ant_exp(-fine_tau[p * n_lambda + l]) * dl;
+           }
+           for(unsigned int r = 0; r < n_rates; r++)
+           {
+              bin.weight[r] += photolysis->weights()(r,l);
+           }
+        }
+        CoeffType j_err, tau_err;
+        this->bin_errors(bin,species_id,fine_rates,j_err,tau_err);
+        _tau_error = std::max(_tau_error,tau_err);
+
+        for(unsigned int p = 0; p < n_ref; p++)
+        {
+           CoeffType tau(0.L);
+           for(unsigned int s = 0; s < n_species; s++)
+           {
+              tau += bin.sigma[s] * _ref_sum_dens[p][species_id[s]];
+           }
+           tau *= _ref_chapman[p] / bin.width;
+           for(unsigned int r = 0; r < n_rates; r++)
+           {
+              coarse_rates[p * n_rates + r] += bin.weight[r] * bin.flux / bin.width * Antioch::ant_exp(-tau);
+           }
+        }
+     }
+     for(unsigned int i = 0; i < coarse_rates.size(); i++)
+     {
+        if(!(fine_rates[i] > CoeffType(0.L)))continue;
+        _j_error = std::max(_j_error,Antioch::ant_abs(coarse_rates[i] - fine_rates[i]) / fine_rates[i]);
+     }
+
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  template <typename VectorStateType>
+  inline
+  void SpectralGridCoarsener<CoeffType,VectorCoeffType>::coarsen_flux(const VectorStateType &fine_flux, VectorStateType &coarse_flux) const
+  {
+     antioch_assert_equal_to(fine_flux.size(),_fine_grid.size());
+     antioch_assert(!_bin_starts.empty());
+
+     typedef typename Antioch::value_type<VectorStateType>::type Scalar;
+
+     coarse_flux.resize(_bin_starts.size());
+     for(unsigned int k = 0; k + 1 < _bin_starts.size(); k++)
+     {
+        Scalar integral(0.L);
+        for(unsigned int l = _bin_starts[k]; l < _bin_starts[k + 1]; l++)
+        {
+           integral += fine_flux[l] * Scalar(_fine_grid[l + 1] - _fine_grid[l]);
+        }
+        coarse_flux[k] = integral / Scalar(_fine_grid[_bin_starts[k + 1]] - _fine_grid[_bin_starts[k]]);
+     }
+     coarse_flux[_bin_starts.size() - 1] = fine_flux[_bin_starts.back()];
+
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  void SpectralGridCoarsener<CoeffType,VectorCoeffType>::coarsen_flux(Antioch::ParticleFlux<VectorCoeffType> &flux) const
+  {
+     antioch_assert_equal_to(flux.abscissa().size(),_fine_grid.size());
+
+     VectorCoeffType coarse_flux;
+     this->coarsen_flux(flux.flux(),coarse_flux);
+     flux.set_abscissa(_coarse_grid);
+     flux.set_flux(coarse_flux);
+
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  void SpectralGridCoarsener<CoeffType,VectorCoeffType>::apply(PhotonOpacity<CoeffType,VectorCoeffType> &opacity,
+                                                               PhotolysisEvaluator<CoeffType,VectorCoeffType> *photolysis) const
+  {
+     antioch_assert(!_bin_starts.empty());
+
+     opacity.coarsen_cross_section(_bin_starts,_fine_grid);
+     if(photolysis)photolysis->coarsen_cross_section(_bin_starts,_fine_grid);
+
+     return;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  const VectorCoeffType &SpectralGridCoarsener<CoeffType,VectorCoeffType>::coarse_grid() const
+  {
+     return _coarse_grid;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  const std::vector<unsigned int> &SpectralGridCoarsener<CoeffType,VectorCoeffType>::bin_starts() const
+  {
+     return _bin_starts;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  CoeffType SpectralGridCoarsener<CoeffType,VectorCoeffType>::j_error() const
+  {
+     return _j_error;
+  }
+
+  template <typename CoeffType, typename VectorCoeffType>
+  inline
+  CoeffType SpectralGridCoarsener<CoeffType,VectorCoeffType>::tau_error() const
+  {
+     return _tau_error;
+  }
+
+}
+
+#endif
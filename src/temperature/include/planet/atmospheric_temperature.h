@@ -69,6 +69,9 @@ namespace Planet
 
         Spliner spline;
 
+        //! incremented at each change of the neutral profile
+        unsigned int _revision;
+
       public:
         AtmosphericTemperature(const VectorCoeffType &alt_neu, const VectorCoeffType &T_neu);
         ~AtmosphericTemperature();
@@ -118,6 +121,9 @@ namespace Planet
         //! reset neutral temperature
         void set_neutral_temperature(const VectorCoeffType & alt, const VectorCoeffType &neu);
 
+        //!\return number of changes of the neutral profile, what is tabulated on it is stale when it changes
+        unsigned int revision() const;
+
         //!
         void initialize();
 
@@ -134,7 +140,8 @@ namespace Planet
   inline
   AtmosphericTemperature<CoeffType,VectorCoeffType,Spliner>::AtmosphericTemperature(const VectorCoeffType &alt_neu, 
                                                                             const VectorCoeffType &T_neu)
-        :spline(alt_neu,T_neu)
+        :spline(alt_neu,T_neu),
+         _revision(0)
   {
     return;
   }
@@ -152,7 +159,15 @@ namespace Planet
   void AtmosphericTemperature<CoeffType,VectorCoeffType,Spliner>::set_neutral_temperature(const VectorCoeffType & alt_neu, const VectorCoeffType & T_neu)
   {
     spline.spline_delete();
-    spline.init(alt_neu,T_neu);
+    spline.spline_init(alt_neu,T_neu);
+    _revision++;
+  }
+
+  template<typename CoeffType, typename VectorCoeffType, typename Spliner>
+  inline
+  unsigned int AtmosphericTemperature<CoeffType,VectorCoeffType,Spliner>::revision() const
+  {
+    return _revision;
   }
 
 }
@@ -0,0 +1,93 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// Planet - An atmospheric code for planetary bodies, adapted to Titan
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+
+#ifndef PLANET_ALLOCATION_COUNTER_H
+#define PLANET_ALLOCATION_COUNTER_H
+
+//C++
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace Planet
+{
+  /*! Counts the calls to the global operator new of an executable, to
+   *  check that a code path does not allocate. The counting operator new
+   *  is defined by the translation unit that defines PLANET_COUNT_ALLOCATIONS
+   *  before including this header, in one translation unit of the
+   *  executable only; otherwise the count stays at zero.
+   */
+  class AllocationCounter
+  {
+      public:
+        //!\return allocations since the last reset
+        static unsigned long count();
+
+        //! restarts the count
+        static void reset();
+
+        //! incremented by operator new
+        static unsigned long & counter();
+
+      private:
+        //don't use it
+        AllocationCounter();
+  };
+
+  inline
+  unsigned long & AllocationCounter::counter()
+  {
+     static unsigned long n_allocations(0);
+     return n_allocations;
+  }
+
+  inline
+  unsigned long AllocationCounter::count()
+  {
+     return counter();
+  }
+
+  inline
+  void AllocationCounter::reset()
+  {
+     counter() = 0;
+     return;
+  }
+}
+
+#ifdef PLANET_COUNT_ALLOCATIONS
+void * operator new(std::size_t size)
+{
+  Planet::AllocationCounter::counter()++;
+  void * p = std::malloc(size == 0?1:size);
+  if(!p)throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void * p) noexcept
+{
+  std::free(p);
+}
+#endif
+
+#endif
@@ -0,0 +1,230 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// Planet - An atmospheric code for planetary bodies, adapted to Titan
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+#ifndef PLANET_ALTITUDE_STORE_H
+#define PLANET_ALTITUDE_STORE_H
+
+//Antioch
+#include "antioch/antioch_asserts.h"
+#include "antioch/cmath_shims.h"
+
+//C++
+#include <map>
+#include <list>
+#include <algorithm>
+
+namespace Planet
+{
+  /*! Values stored by altitude, at most capacity() of them: the least
+   *  recently used altitude is dropped when a new one comes in. The
+   *  quadrature points of a mesh are visited at each Newton iteration,
+   *  the values of points that are not visited anymore (refined or moved
+   *  mesh) are dropped in turn.
+   *
+   *  The storage of a dropped value is handed to the new altitude, a
+   *  value keeps its buffers from one altitude to the next.
+   */
+  template <typename CoeffType, typename ValueType>
+  class AltitudeStore
+  {
+      public:
+
+        AltitudeStore(unsigned int capacity = default_capacity());
+        ~AltitudeStore();
+
+        //!\return value stored at \p z, NULL if none
+        ValueType * find(const CoeffType &z);
+
+        //!\return value stored closest to \p z within \p dz, NULL if none
+        ValueType * find_near(const CoeffType &z, const CoeffType &dz);
+
+        //!\return value at \p z, created if needed: a new value holds the storage of a dropped one, if any
+        ValueType & insert(const CoeffType &z);
+
+        //! forgets everything
+        void clear();
+
+        //!\return number of altitudes stored
+        unsigned int size() const;
+
+        //!\return maximum number of altitudes stored
+        unsigned int capacity() const;
+
+        //! maximum number of altitudes stored, the least recently used are dropped if needed
+        void set_capacity(unsigned int capacity);
+
+        //! 4096 altitudes
+        static unsigned int default_capacity();
+
+      private:
+
+        struct Node
+        {
+           ValueType                                  value;
+           typename std::list<CoeffType>::iterator    use;
+        };
+
+        typedef typename std::map<CoeffType,Node>::iterator iterator;
+
+        //! most recently used first
+        void touch(Node & node);
+
+        //! drops the least recently used until \p n altitudes are left, the last value dropped in \p spare
+        void shrink(unsigned int n, ValueType * spare = NULL);
+
+        std::map<CoeffType,Node> _nodes;
+        std::list<CoeffType>     _uses;
+        unsigned int             _capacity;
+  };
+
+  template <typename CoeffType, typename ValueType>
+  inline
+  AltitudeStore<CoeffType,ValueType>::AltitudeStore(unsigned int capacity):
+      _capacity(capacity)
+  {
+     antioch_assert_greater(_capacity,0);
+     return;
+  }
+
+  template <typename CoeffType, typename ValueType>
+  inline
+  AltitudeStore<CoeffType,ValueType>::~AltitudeStore()
+  {
+     return;
+  }
+
+  template <typename CoeffType, typename ValueType>
+  inline
+  unsigned int AltitudeStore<CoeffType,ValueType>::default_capacity()
+  {
+     return 4096;
+  }
+
+  template <typename CoeffType, typename ValueType>
+  inline
+  void AltitudeStore<CoeffType,ValueType>::touch(Node & node)
+  {
+     _uses.splice(_uses.begin(),_uses,node.use);
+     return;
+  }
+
+  template <typename CoeffType, typename ValueType>
+  inline
+  void AltitudeStore<CoeffType,ValueType>::shrink(unsigned int n, ValueType * spare)
+  {
+     while(_nodes.size() > n)
+     {
+        iterator it = _nodes.find(_uses.back());
+        antioch_assert(it != _nodes.end());
+        if(spare)std::swap(*spare,it->second.value);
+        _nodes.erase(it);
+        _uses.pop_back();
+     }
+     return;
+  }
+
+  template <typename CoeffType, typename ValueType>
+  inline
+  ValueType * AltitudeStore<CoeffType,ValueType>::find(const CoeffType &z)
+  {
+     iterator it = _nodes.find(z);
+     if(it == _nodes.end())return NULL;
+
+     this->touch(it->second);
+     return &(it->second.value);
+  }
+
+  template <typename CoeffType, typename ValueType>
+  inline
+  ValueType * AltitudeStore<CoeffType,ValueType>::find_near(const CoeffType &z, const CoeffType &dz)
+  {
+     iterator it = _nodes.lower_bound(z - dz);
+     if(it == _nodes.end() || it->first > z + dz)return NULL;
+
+     // closest of the stored altitudes within the tolerance
+     iterator next = it;
+     ++next;
+     if(next != _nodes.end() && next->first <= z + dz &&
+        Antioch::ant_abs(next->first - z) < Antioch::ant_abs(it->first - z))it = next;
+
+     this->touch(it->second);
+     return &(it->second.value);
+  }
+
+  template <typename CoeffType, typename ValueType>
+  inline
+  ValueType & AltitudeStore<CoeffType,ValueType>::insert(const CoeffType &z)
+  {
+     iterator it = _nodes.find(z);
+     if(it != _nodes.end())
+     {
+        this->touch(it->second);
+        return it->second.value;
+     }
+
+     ValueType spare;
+     this->shrink(_capacity - 1, &spare);
+
+     _uses.push_front(z);
+     Node & node = _nodes[z];
+     node.use = _uses.begin();
+     std::swap(node.value,spare);
+
+     return node.value;
+  }
+
+  template <typename CoeffType, typename ValueType>
+  inline
+  void AltitudeStore<CoeffType,ValueType>::clear()
+  {
+     _nodes.clear();
+     _uses.clear();
+     return;
+  }
+
+  template <typename CoeffType, typename ValueType>
+  inline
+  unsigned int AltitudeStore<CoeffType,ValueType>::size() const
+  {
+     return _nodes.size();
+  }
+
+  template <typename CoeffType, typename ValueType>
+  inline
+  unsigned int AltitudeStore<CoeffType,ValueType>::capacity() const
+  {
+     return _capacity;
+  }
+
+  template <typename CoeffType, typename ValueType>
+  inline
+  void AltitudeStore<CoeffType,ValueType>::set_capacity(unsigned int capacity)
+  {
+     antioch_assert_greater(capacity,0);
+     _capacity = capacity;
+     this->shrink(_capacity);
+     return;
+  }
+
+}
+
+#endif
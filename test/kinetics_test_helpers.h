@@ -0,0 +1,134 @@
+//-----------------------------------------------------------------------bl-
+//--------------------------------------------------------------------------
+//
+// Planet - An atmospheric code for planetary bodies, adapted to Titan
+//
+// Copyright (C) 2013 The PECOS Development Team
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the Version 2.1 GNU Lesser General
+// Public License as published by the Free Software Foundation.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc. 51 Franklin Street, Fifth Floor,
+// Boston, MA  02110-1301  USA
+//
+//-----------------------------------------------------------------------el-
+
+#ifndef PLANET_KINETICS_TEST_HELPERS_H
+#define PLANET_KINETICS_TEST_HELPERS_H
+
+//Antioch
+#include "antioch/vector_utils_decl.h"
+#include "antioch/vector_utils.h"
+#include "antioch/physical_constants.h"
+#include "antioch/sigma_bin_converter.h"
+#include "antioch/gsl_spliner.h"
+#include "antioch/kinetics_parsing.h"
+#include "antioch/reaction_parsing.h"
+#include "antioch/kinetics_evaluator.h"
+#include "antioch/particle_flux.h"
+
+//Planet
+#include "planet/atmospheric_kinetics.h"
+
+//C++
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cmath>
+
+// shared by the unit tests of the kinetics built on AtmosphericKinetics
+
+// elementary reaction of constant rate constant
+template <typename Scalar>
+void add_reaction(Antioch::ReactionSet<Scalar> &reaction_set, const std::string &equation,
+                  const std::vector<std::string> &reactants, const std::vector<unsigned int> &stoi_reac,
+                  const std::vector<std::string> &products,  const std::vector<unsigned int> &stoi_prod,
+                  const Scalar &rate_constant)
+{
+  const Antioch::ChemicalMixture<Scalar> & chem_mixture = reaction_set.chemical_mixture();
+  Antioch::Reaction<Scalar> * reaction = Antioch::build_reaction<Scalar>(chem_mixture.n_species(), equation, false,
+                                                                        Antioch::ReactionType::ELEMENTARY, Antioch::KineticsModel::KOOIJ);
+  std::vector<Scalar> data;
+  data.push_back(rate_constant);
+  data.push_back(0.L); //beta
+  data.push_back(0.L); //Ea
+  data.push_back(1.L); //Tref
+  data.push_back(1.L); //Ea_R
+  reaction->add_forward_rate(Antioch::build_rate<Scalar,std::vector<Scalar> >(data,Antioch::KineticsModel::KOOIJ));
+  for(unsigned int ir = 0; ir < reactants.size(); ir++)
+  {
+    reaction->add_reactant(reactants[ir],chem_mixture.species_name_map().at(reactants[ir]),stoi_reac[ir]);
+  }
+  for(unsigned int ip = 0; ip < products.size(); ip++)
+  {
+    reaction->add_product(products[ip],chem_mixture.species_name_map().at(products[ip]),stoi_prod[ip]);
+  }
+  reaction_set.add_reaction(reaction);
+}
+
+template <typename Scalar>
+int check_test(Scalar theory, Scalar cal, Scalar tol, const std::string &words)
+{
+  if(std::abs(theory - cal) <= tol * std::abs(theory))return 0;
+  std::cout << std::scientific << std::setprecision(20)
+            << "\nfailed test: " << words << "\n"
+            << "theory: " << theory
+            << "\ncalculated: " << cal
+            << "\ndifference: " << std::abs(theory - cal) / std::abs(theory)
+            << "\ntolerance: " << tol << std::endl;
+  return 1;
+}
+
+// kinetics of the reaction sets at 150 K, no photon flux, every object its own
+template <typename Scalar>
+struct IsothermalKinetics
+{
+  typedef std::vector<Scalar>               VectorScalar;
+  typedef std::vector<std::vector<Scalar> > MatrixScalar;
+
+  IsothermalKinetics(const Antioch::ReactionSet<Scalar> &neutral_reactions, const Antioch::ReactionSet<Scalar> &ionic_reactions,
+                     Antioch::ChemicalMixture<Scalar> &neutral_species, Antioch::ChemicalMixture<Scalar> &ionic_species):
+    neutral_kinetics(neutral_reactions,0),
+    ionic_kinetics(ionic_reactions,0),
+    T_alt(altitudes()),
+    T(T_alt.size(),150.L),
+    temperature(T_alt,T),
+    composition(neutral_species,ionic_species,temperature),
+    chapman(0.),
+    opacity(chapman),
+    photon(flux,opacity,composition),
+    kinetics(neutral_kinetics,ionic_kinetics,temperature,photon,composition)
+  {
+    return;
+  }
+
+  static VectorScalar altitudes()
+  {
+    VectorScalar z;
+    for(unsigned int i = 0; i < 4; i++)z.push_back(Scalar(500.L) * Scalar(i));
+    return z;
+  }
+
+  Antioch::KineticsEvaluator<Scalar>                            neutral_kinetics;
+  Antioch::KineticsEvaluator<Scalar>                            ionic_kinetics;
+  VectorScalar                                                  T_alt;
+  VectorScalar                                                  T;
+  Planet::AtmosphericTemperature<Scalar,VectorScalar>           temperature;
+  Planet::AtmosphericMixture<Scalar,VectorScalar,MatrixScalar>  composition;
+  Planet::Chapman<Scalar>                                       chapman;
+  Planet::PhotonOpacity<Scalar,VectorScalar>                    opacity;
+  Antioch::ParticleFlux<VectorScalar>                           flux;
+  Planet::PhotonEvaluator<Scalar,VectorScalar,MatrixScalar>     photon;
+  Planet::AtmosphericKinetics<Scalar,VectorScalar,MatrixScalar> kinetics;
+};
+
+#endif